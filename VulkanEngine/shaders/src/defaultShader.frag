@@ -1,15 +1,26 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) out vec4 fragColor;
 
-
-
 layout(location = 0) in vec3 v_VertColor;
 layout(location = 1) in vec2 v_TextureCoord;
+layout(location = 2) flat in uint v_TextureIndex;
 
-layout(binding = 1) uniform sampler2D textureSampler;
+// Bindless texture table shared by every pipeline, see BindlessRegistry. The index varies per instance, hence nonuniformEXT
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+// Variant toggles, set per pipeline through specialization constants
+layout(constant_id = 0) const bool USE_TEXTURE = true;
+layout(constant_id = 1) const bool USE_VERTEX_COLOR = true;
 
 void main()
 {
-   fragColor = vec4(vec3(texture(textureSampler, v_TextureCoord) *  vec4(v_VertColor, 1.0f)),1.0f);
-}
\ No newline at end of file
+   vec3 color = vec3(1.0f);
+   if (USE_TEXTURE)
+      color *= texture(textures[nonuniformEXT(v_TextureIndex)], v_TextureCoord).rgb;
+   if (USE_VERTEX_COLOR)
+      color *= v_VertColor;
+
+   fragColor = vec4(color, 1.0f);
+}
@@ -6,16 +6,32 @@ layout(location = 2) in vec2 a_TextureCoord;
 
 layout(location = 0) out vec3 v_VertColor;
 layout(location = 1) out vec2 v_TextureCoord;
+layout(location = 2) flat out uint v_TextureIndex;
 
 layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
-    mat4 view;
-    mat4 proj;
+    mat4 viewProj;
 } ubo;
 
+struct InstanceData {
+    mat4 model;
+    uint textureIndex;
+};
+
+// Per instance transforms and texture indices, see InstanceBuffer
+layout(std430, binding = 1) readonly buffer InstanceBuffer {
+    InstanceData data[];
+} instances;
+
+// Instances surviving culling, gl_InstanceIndex walks the draw's compacted range, see InstanceCuller
+layout(std430, binding = 2) readonly buffer VisibleInstanceBuffer {
+    uint data[];
+} visibleInstances;
+
 void main()
 {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(a_Position, 1.0);
+    InstanceData instance = instances.data[visibleInstances.data[gl_InstanceIndex]];
+    gl_Position = ubo.viewProj * instance.model * vec4(a_Position, 1.0);
     v_VertColor = a_Color;
     v_TextureCoord = a_TextureCoord;
+    v_TextureIndex = instance.textureIndex;
 }
@@ -0,0 +1,57 @@
+#version 450
+#extension GL_EXT_buffer_reference : require
+
+layout(location = 0) out vec3 v_VertColor;
+layout(location = 1) out vec2 v_TextureCoord;
+layout(location = 2) flat out uint v_TextureIndex;
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 viewProj;
+} ubo;
+
+struct InstanceData {
+    mat4 model;
+    uint textureIndex;
+};
+
+// Per instance transforms and texture indices, see InstanceBuffer
+layout(std430, binding = 1) readonly buffer InstanceBuffer {
+    InstanceData data[];
+} instances;
+
+// Instances surviving culling, gl_InstanceIndex walks the draw's compacted range, see InstanceCuller
+layout(std430, binding = 2) readonly buffer VisibleInstanceBuffer {
+    uint data[];
+} visibleInstances;
+
+// Vertex on the host is position, color and texture coordinate packed as 8 floats, see GeometryPool
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer VertexData {
+    float values[];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer IndexData {
+    uint values[];
+};
+
+// Base addresses of the geometry pool. Indices are already rebased onto the pool's vertices and
+// the draw's firstVertex is the mesh's first index, so gl_VertexIndex addresses the index buffer directly
+layout(push_constant) uniform DrawPushConstants {
+    VertexData vertices;
+    IndexData indices;
+} draw;
+
+const uint VERTEX_FLOATS = 8;
+
+void main()
+{
+    uint base = draw.indices.values[gl_VertexIndex] * VERTEX_FLOATS;
+    vec3 position = vec3(draw.vertices.values[base + 0], draw.vertices.values[base + 1], draw.vertices.values[base + 2]);
+    vec3 color = vec3(draw.vertices.values[base + 3], draw.vertices.values[base + 4], draw.vertices.values[base + 5]);
+    vec2 textureCoord = vec2(draw.vertices.values[base + 6], draw.vertices.values[base + 7]);
+
+    InstanceData instance = instances.data[visibleInstances.data[gl_InstanceIndex]];
+    gl_Position = ubo.viewProj * instance.model * vec4(position, 1.0);
+    v_VertColor = color;
+    v_TextureCoord = textureCoord;
+    v_TextureIndex = instance.textureIndex;
+}
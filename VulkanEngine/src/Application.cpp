@@ -5,10 +5,11 @@
 namespace vkEngine
 {
 
-	Application::Application(bool enableLayers, uint32_t width, uint32_t height, const std::string& appName)
+	Application::Application(bool enableLayers, uint32_t width, uint32_t height, const std::string& appName, const EngineOptions& options)
 		:
 		m_AppName(appName),
-		m_ValidationLayersEnabled(enableLayers)
+		m_ValidationLayersEnabled(enableLayers),
+		m_Options(options)
 	{
 		m_Window = CreateShared<Window>(width, height, m_AppName);
 	}
@@ -15,7 +15,7 @@ namespace vkEngine
 
 	{
 	public:
-		Application(bool enableLayers, uint32_t width, uint32_t height, const std::string & appName);
+		Application(bool enableLayers, uint32_t width, uint32_t height, const std::string & appName, const EngineOptions& options = {});
 		~Application();
 		void run();
 
@@ -23,6 +23,7 @@ namespace vkEngine
 		const std::string& getAppName() const { return m_AppName; };
 		const bool isValidationLayersEnabled() const { return m_ValidationLayersEnabled; };
 		const std::vector<const char*>& getValidationLayers() const { return validationLayers; };
+		const EngineOptions& getOptions() const { return m_Options; };
 
 	private:
 		void prepareEngine();
@@ -32,6 +33,7 @@ namespace vkEngine
 		Shared<Window> m_Window = nullptr;
 		const std::string m_AppName{};
 		const bool m_ValidationLayersEnabled = false;
+		const EngineOptions m_Options{};
 
 	};
 }
@@ -21,12 +21,12 @@ namespace vkEngine {
 		vkUnmapMemory(VulkanContext::getDevice(), m_Memory);
 	}
 
-	void Buffer::copyBuffer(VkBuffer srcBuffer, VkDeviceSize size) const {
+	void Buffer::copyBuffer(VkBuffer srcBuffer, VkDeviceSize size, VkDeviceSize dstOffset) const {
 		VkCommandBuffer commandBuffer = VulkanContext::getCommandHandler()->beginSingleTimeCommands();
 
 		VkBufferCopy copyRegion{};
 		copyRegion.srcOffset = 0;
-		copyRegion.dstOffset = 0;
+		copyRegion.dstOffset = dstOffset;
 		copyRegion.size = size;
 
 		vkCmdCopyBuffer(commandBuffer, srcBuffer, m_Buffer, 1, &copyRegion);
@@ -34,6 +34,14 @@ namespace vkEngine {
 		VulkanContext::getCommandHandler()->endSingleTimeCommands(commandBuffer);
 	}
 
+	VkDeviceAddress Buffer::getDeviceAddress() const
+	{
+		VkBufferDeviceAddressInfo addressInfo{};
+		addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+		addressInfo.buffer = m_Buffer;
+		return vkGetBufferDeviceAddress(VulkanContext::getDevice(), &addressInfo);
+	}
+
 	Buffer::Buffer(Buffer&& other) noexcept
 		: m_Buffer(other.m_Buffer), m_Memory(other.m_Memory) 
 	{
@@ -57,6 +65,10 @@ namespace vkEngine {
 
 	void Buffer::initBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
 	{
+		// Descriptor buffers describe uniform and storage buffers by device address
+		if ((usage & (VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) && VulkanContext::getDescriptorBuffer())
+			usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
 		VkBufferCreateInfo bufferInfo{};
 		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 		bufferInfo.size = size;
@@ -73,6 +85,12 @@ namespace vkEngine {
 		allocInfo.allocationSize = memRequirements.size;
 		allocInfo.memoryTypeIndex = VulkanUtils::findMemoryType(memRequirements.memoryTypeBits, properties);
 
+		VkMemoryAllocateFlagsInfo allocFlagsInfo{};
+		allocFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+		allocFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+		if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
+			allocInfo.pNext = &allocFlagsInfo;
+
 		ENGINE_ASSERT(vkAllocateMemory(VulkanContext::getDevice(), &allocInfo, nullptr, &m_Memory) == VK_SUCCESS, "Memory allocation failed");
 
 		vkBindBufferMemory(VulkanContext::getDevice(), m_Buffer, m_Memory, 0);
@@ -7,6 +7,7 @@ namespace vkEngine {
 	class Buffer
 	{
 	public:
+		// Uniform and storage buffers get VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT with the descriptor buffer backend
 		Buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
 		virtual ~Buffer();
 
@@ -16,10 +17,12 @@ namespace vkEngine {
 		Buffer& operator=(Buffer&& other) noexcept;
 
 		void copyData(void* data, VkDeviceSize size) const;
-		void copyBuffer(VkBuffer srcBuffer, VkDeviceSize size) const;
+		void copyBuffer(VkBuffer srcBuffer, VkDeviceSize size, VkDeviceSize dstOffset = 0) const;
 
 		VkBuffer getBuffer() const { return m_Buffer; }
 		VkDeviceMemory getMemory() const { return m_Memory; }
+		// Requires VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+		VkDeviceAddress getDeviceAddress() const;
 
 	private:
 		void initBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
@@ -0,0 +1,102 @@
+#include "pch.h"
+#include "GeometryPool.h"
+
+#include <numeric>
+#include <tuple>
+
+namespace vkEngine
+{
+	namespace
+	{
+		constexpr VkBufferUsageFlags GEOMETRY_USAGE = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+		void upload(const Buffer& buffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset)
+		{
+			Buffer stagingBufferObj(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			stagingBufferObj.copyData(const_cast<void*>(data), size);
+
+			buffer.copyBuffer(stagingBufferObj.getBuffer(), size, dstOffset);
+		}
+	}
+
+	GeometryPool::GeometryPool(uint32_t vertexCapacity, uint32_t indexCapacity)
+		: m_VertexBuffer(sizeof(Vertex) * static_cast<VkDeviceSize>(vertexCapacity), GEOMETRY_USAGE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+		m_IndexBuffer(sizeof(uint32_t) * static_cast<VkDeviceSize>(indexCapacity), GEOMETRY_USAGE, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+		m_VertexCapacity(vertexCapacity),
+		m_IndexCapacity(indexCapacity)
+	{
+		ENGINE_ASSERT(VulkanContext::getPhysicalDevice()->getCapabilities().bufferDeviceAddress, "Geometry pool requires buffer device address support");
+
+		m_VertexAddress = m_VertexBuffer.getDeviceAddress();
+		m_IndexAddress = m_IndexBuffer.getDeviceAddress();
+	}
+
+	MeshAllocation GeometryPool::addMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	{
+		MeshAllocation mesh{};
+		mesh.vertexCount = static_cast<uint32_t>(vertices.size());
+		mesh.indexCount = static_cast<uint32_t>(indices.size());
+		mesh.boundingSphere = computeBoundingSphere(vertices);
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			ENGINE_ASSERT(m_VertexCount + mesh.vertexCount <= m_VertexCapacity && m_IndexCount + mesh.indexCount <= m_IndexCapacity,
+				"Geometry pool is full, %u vertices and %u indices requested", mesh.vertexCount, mesh.indexCount);
+
+			mesh.firstVertex = m_VertexCount;
+			mesh.firstIndex = m_IndexCount;
+			m_VertexCount += mesh.vertexCount;
+			m_IndexCount += mesh.indexCount;
+		}
+
+		std::vector<uint32_t> rebasedIndices(indices.size());
+		std::transform(indices.begin(), indices.end(), rebasedIndices.begin(), [&mesh](uint32_t index) { return index + mesh.firstVertex; });
+
+		upload(m_VertexBuffer, vertices.data(), sizeof(Vertex) * vertices.size(), sizeof(Vertex) * static_cast<VkDeviceSize>(mesh.firstVertex));
+		upload(m_IndexBuffer, rebasedIndices.data(), sizeof(uint32_t) * rebasedIndices.size(), sizeof(uint32_t) * static_cast<VkDeviceSize>(mesh.firstIndex));
+		return mesh;
+	}
+
+	glm::vec4 GeometryPool::computeBoundingSphere(const std::vector<Vertex>& vertices)
+	{
+		if (vertices.empty())
+			return glm::vec4{ 0.0f };
+
+		glm::vec3 min = vertices.front().position;
+		glm::vec3 max = min;
+		for (const Vertex& vertex : vertices)
+		{
+			min = glm::min(min, vertex.position);
+			max = glm::max(max, vertex.position);
+		}
+
+		glm::vec3 center = (min + max) * 0.5f;
+		float radiusSquared = 0.0f;
+		for (const Vertex& vertex : vertices)
+		{
+			glm::vec3 offset = vertex.position - center;
+			radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+		}
+		return glm::vec4{ center, std::sqrt(radiusSquared) };
+	}
+
+	std::vector<uint32_t> GeometryPool::weldPositions(const std::vector<Vertex>& vertices)
+	{
+		std::vector<uint32_t> order(vertices.size());
+		std::iota(order.begin(), order.end(), 0);
+		auto less = [&vertices](uint32_t a, uint32_t b)
+			{
+				const glm::vec3& p = vertices[a].position;
+				const glm::vec3& q = vertices[b].position;
+				return std::tie(p.x, p.y, p.z, a) < std::tie(q.x, q.y, q.z, b);
+			};
+		std::sort(order.begin(), order.end(), less);
+
+		std::vector<uint32_t> welded(vertices.size());
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			bool samePosition = i > 0 && vertices[order[i]].position == vertices[order[i - 1]].position;
+			welded[order[i]] = samePosition ? welded[order[i - 1]] : order[i];
+		}
+		return welded;
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cfloat>
+#include <mutex>
+#include "Buffer.h"
+
+namespace vkEngine
+{
+	// Placement of one mesh inside the pool
+	struct MeshAllocation
+	{
+		uint32_t firstVertex = 0;
+		uint32_t vertexCount = 0;
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		glm::vec4 boundingSphere{ 0.0f }; // Mesh space center in xyz and radius in w, used for culling
+		// Mesh space cone around the triangle normals, axis in xyz and the sine of its half angle in w. Every triangle faces
+		// away from viewers with dot(center - viewer, axis) >= w * length(center - viewer) + radius, a w of 1 never does
+		glm::vec4 normalCone{ 0.0f, 0.0f, 0.0f, 1.0f };
+		// Level of detail the allocation belongs to, see MeshLodChain. The level is picked by the distance to lodSphere,
+		// the whole mesh's bounds so that every part of an instance picks the same one. lodErrors holds the mesh space error
+		// of the level and of the next coarser one, the allocation is drawn where the first is small enough on screen and
+		// the second is not. The defaults always draw
+		glm::vec4 lodSphere{ 0.0f };
+		glm::vec2 lodErrors{ 0.0f, FLT_MAX };
+	};
+
+	// Vertices and indices of every mesh in two large storage buffers read through buffer device addresses.
+	// Indices are stored rebased onto the pool's vertex buffer, so the two base addresses reach every mesh and
+	// a draw selects its mesh with firstVertex = firstIndex alone. Meshes are appended and live as long as the pool.
+	class GeometryPool
+	{
+	public:
+		static constexpr uint32_t s_DefaultVertexCapacity = 1u << 20;
+		static constexpr uint32_t s_DefaultIndexCapacity = 1u << 22;
+
+		GeometryPool(uint32_t vertexCapacity = s_DefaultVertexCapacity, uint32_t indexCapacity = s_DefaultIndexCapacity);
+
+		GeometryPool(const GeometryPool&) = delete;
+		GeometryPool& operator=(const GeometryPool&) = delete;
+
+		MeshAllocation addMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+		// Sphere around the center of the vertices' bounding box, not minimal but cheap and stable
+		static glm::vec4 computeBoundingSphere(const std::vector<Vertex>& vertices);
+		// Maps every vertex to the first one at the same position, vertices split by texture seams then share an index
+		static std::vector<uint32_t> weldPositions(const std::vector<Vertex>& vertices);
+
+		VkDeviceAddress getVertexAddress() const { return m_VertexAddress; }
+		VkDeviceAddress getIndexAddress() const { return m_IndexAddress; }
+
+	private:
+		Buffer m_VertexBuffer;
+		Buffer m_IndexBuffer;
+		VkDeviceAddress m_VertexAddress = 0;
+		VkDeviceAddress m_IndexAddress = 0;
+		uint32_t m_VertexCapacity = 0;
+		uint32_t m_IndexCapacity = 0;
+
+		std::mutex m_Mutex;
+		uint32_t m_VertexCount = 0;
+		uint32_t m_IndexCount = 0;
+	};
+}
@@ -0,0 +1,30 @@
+#include "pch.h"
+#include "IndirectBuffer.h"
+
+namespace vkEngine
+{
+	IndirectBuffer::IndirectBuffer(VkDeviceSize size)
+		: Buffer(size, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT),
+		m_Size(size)
+	{
+		void* mappedMemory = nullptr;
+		vkMapMemory(VulkanContext::getDevice(), m_Memory, 0, VK_WHOLE_SIZE, 0, &mappedMemory);
+		m_MappedMemory = static_cast<uint8_t*>(mappedMemory);
+	}
+
+	IndirectBuffer::~IndirectBuffer()
+	{
+		vkUnmapMemory(VulkanContext::getDevice(), m_Memory);
+	}
+
+	VkDeviceSize IndirectBuffer::push(const void* commands, VkDeviceSize size)
+	{
+		// Indirect offsets must be a multiple of 4
+		VkDeviceSize offset = (m_Head + 3) & ~VkDeviceSize(3);
+		ENGINE_ASSERT(offset + size <= m_Size, "Indirect buffer is full, %llu bytes requested", static_cast<unsigned long long>(size));
+
+		memcpy(m_MappedMemory + offset, commands, static_cast<size_t>(size));
+		m_Head = offset + size;
+		return offset;
+	}
+}
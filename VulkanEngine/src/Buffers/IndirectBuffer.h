@@ -0,0 +1,30 @@
+#pragma once
+#include "Buffer.h"
+
+namespace vkEngine
+{
+	// Host visible buffer of indirect draw commands, persistently mapped and filled front to back.
+	// One per frame in flight, reset() rewinds once the frame has completed.
+	// Also a storage buffer the cull shader writes instance counts into, so with the descriptor buffer backend it is created
+	// with device address usage like every other descriptor-bound buffer, see Buffer.
+	class IndirectBuffer : public Buffer
+	{
+	public:
+		IndirectBuffer(VkDeviceSize size);
+		~IndirectBuffer();
+
+		IndirectBuffer(const IndirectBuffer&) = delete;
+		IndirectBuffer& operator=(const IndirectBuffer&) = delete;
+
+		// Copies the commands in and returns their offset, the offset is aligned for any indirect command
+		VkDeviceSize push(const void* commands, VkDeviceSize size);
+		void reset() { m_Head = 0; }
+
+		VkDeviceSize getSize() const { return m_Size; }
+
+	private:
+		uint8_t* m_MappedMemory = nullptr;
+		VkDeviceSize m_Size = 0;
+		VkDeviceSize m_Head = 0;
+	};
+}
@@ -0,0 +1,29 @@
+#include "pch.h"
+#include "InstanceBuffer.h"
+
+namespace vkEngine
+{
+	InstanceBuffer::InstanceBuffer(uint32_t capacity)
+		: Buffer(sizeof(InstanceData) * static_cast<VkDeviceSize>(capacity), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT),
+		m_Capacity(capacity)
+	{
+		void* mappedMemory = nullptr;
+		vkMapMemory(VulkanContext::getDevice(), m_Memory, 0, VK_WHOLE_SIZE, 0, &mappedMemory);
+		m_MappedInstances = static_cast<InstanceData*>(mappedMemory);
+	}
+
+	InstanceBuffer::~InstanceBuffer()
+	{
+		vkUnmapMemory(VulkanContext::getDevice(), m_Memory);
+	}
+
+	uint32_t InstanceBuffer::push(const std::vector<InstanceData>& instances)
+	{
+		ENGINE_ASSERT(m_Count + instances.size() <= m_Capacity, "Instance buffer is full, %zu instances requested", instances.size());
+
+		uint32_t firstInstance = m_Count;
+		memcpy(m_MappedInstances + firstInstance, instances.data(), sizeof(InstanceData) * instances.size());
+		m_Count += static_cast<uint32_t>(instances.size());
+		return firstInstance;
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "Buffer.h"
+
+namespace vkEngine
+{
+	// Per instance data read by the vertex shader, std430 layout of InstanceData in the shaders
+	struct InstanceData
+	{
+		glm::mat4 modelMat;
+		uint32_t textureIndex;
+		uint32_t padding[3];
+	};
+	static_assert(sizeof(InstanceData) == 80, "InstanceData must match the std430 struct stride");
+
+	// Host visible storage buffer the instances of one frame are appended to. Every instanced draw takes a
+	// contiguous range and passes its start as firstInstance, reset() rewinds once the frame has completed.
+	class InstanceBuffer : public Buffer
+	{
+	public:
+		static constexpr uint32_t s_DefaultCapacity = 1024;
+
+		InstanceBuffer(uint32_t capacity = s_DefaultCapacity);
+		~InstanceBuffer();
+
+		InstanceBuffer(const InstanceBuffer&) = delete;
+		InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+		// Copies the instances in and returns the index of the first one
+		uint32_t push(const std::vector<InstanceData>& instances);
+		void reset() { m_Count = 0; }
+
+		uint32_t getCapacity() const { return m_Capacity; }
+		VkDeviceSize getSize() const { return sizeof(InstanceData) * static_cast<VkDeviceSize>(m_Capacity); }
+
+	private:
+		InstanceData* m_MappedInstances = nullptr;
+		uint32_t m_Capacity = 0;
+		uint32_t m_Count = 0;
+	};
+}
@@ -5,7 +5,8 @@
 namespace vkEngine
 {
 	UniformBuffer::UniformBuffer(VkDeviceSize size)
-		: Buffer(size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT),
+		: Buffer(size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | (VulkanContext::getPhysicalDevice()->getCapabilities().bufferDeviceAddress ? VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT : 0),
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT),
 		m_MappedMemoryPtr(nullptr)
 	{
 	}
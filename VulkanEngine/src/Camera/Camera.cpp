@@ -41,6 +41,27 @@ namespace vkEngine
 
 	}
 
+	Ray Camera::ScreenPointToRay(const glm::vec2& screenPosition) const
+	{
+		auto [width, height] = m_Window->getWindowSize();
+		glm::vec2 ndc{ 2.0f * screenPosition.x / width - 1.0f, 1.0f - 2.0f * screenPosition.y / height };
+
+		// Unprojected onto the near and far planes, the projection uses OpenGL clip depth
+		glm::mat4 inverseProjectionView = glm::inverse(m_ProjectionViewMatrix);
+		glm::vec4 nearPoint = inverseProjectionView * glm::vec4(ndc, -1.0f, 1.0f);
+		glm::vec4 farPoint = inverseProjectionView * glm::vec4(ndc, 1.0f, 1.0f);
+		nearPoint /= nearPoint.w;
+		farPoint /= farPoint.w;
+
+		return Ray{ glm::vec3(nearPoint), glm::normalize(glm::vec3(farPoint - nearPoint)) };
+	}
+
+	Ray Camera::GetCursorRay() const
+	{
+		auto [mouseX, mouseY] = m_Window->getCursorPosition();
+		return ScreenPointToRay({ mouseX, mouseY });
+	}
+
 	void Camera::UpdateCameraOrientation(Timestep dt)
 	{
 		static bool firstClick = true;
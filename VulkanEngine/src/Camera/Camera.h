@@ -1,6 +1,8 @@
 #pragma once
 #include "../TimeHelper.h"
 #include "../Window/Window.h"
+#include "Frustum.h"
+#include "../Culling/BoundingBox.h"
 
 #include <glm/glm.hpp>
 
@@ -17,8 +19,16 @@ namespace vkEngine
 		const inline glm::mat4& GetProjectionViewMatrix() const { return m_ProjectionViewMatrix; }
 		const inline glm::mat4& GetProjectionMatrix() const { return m_ProjectionMatrix; }
 		const inline glm::mat4& GetViewMatrix() const { return m_ViewMatrix; }
+		inline Frustum GetFrustum() const { return Frustum::fromViewProjection(m_ProjectionViewMatrix); }
+
+		// World space ray through a window position in pixels, starting on the near plane
+		Ray ScreenPointToRay(const glm::vec2& screenPosition) const;
+		Ray GetCursorRay() const;
 
 		inline const glm::vec3& GetPosition() const { return m_Position; }
+		// Vertical, in radians
+		inline float GetFieldOfView() const { return glm::radians(m_FOVdeg); }
+		inline const glm::vec2& GetNearFar() const { return m_NearFar; }
 
 	private:
 		void UpdateCameraOrientation(Timestep dt);
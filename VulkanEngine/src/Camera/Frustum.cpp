@@ -0,0 +1,35 @@
+#include "pch.h"
+#include "Frustum.h"
+
+namespace vkEngine
+{
+	Frustum Frustum::fromViewProjection(const glm::mat4& viewProjection)
+	{
+		// glm is column major, row i of the matrix is the i-th component of every column
+		auto row = [&viewProjection](int i) { return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]); };
+
+		Frustum frustum{};
+		frustum.planes[Left] = row(3) + row(0);
+		frustum.planes[Right] = row(3) - row(0);
+		frustum.planes[Bottom] = row(3) + row(1);
+		frustum.planes[Top] = row(3) - row(1);
+		frustum.planes[Near] = row(3) + row(2); // OpenGL clip depth of glm, conservative for a [0, 1] depth range
+		frustum.planes[Far] = row(3) - row(2);
+
+		for (glm::vec4& plane : frustum.planes)
+		{
+			plane /= glm::length(glm::vec3(plane));
+		}
+		return frustum;
+	}
+
+	bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const
+	{
+		for (const glm::vec4& plane : planes)
+		{
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+				return false;
+		}
+		return true;
+	}
+}
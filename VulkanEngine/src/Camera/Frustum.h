@@ -0,0 +1,21 @@
+#pragma once
+
+#include <array>
+#include <glm/glm.hpp>
+
+namespace vkEngine
+{
+	// View frustum as six world space planes, normals point inwards and are normalized so
+	// dot(plane.xyz, point) + plane.w is the signed distance of the point to the plane
+	struct Frustum
+	{
+		enum Plane : uint32_t { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+
+		std::array<glm::vec4, PlaneCount> planes{};
+
+		// Extracts the planes from the rows of a combined projection and view matrix
+		static Frustum fromViewProjection(const glm::mat4& viewProjection);
+
+		bool intersectsSphere(const glm::vec3& center, float radius) const;
+	};
+}
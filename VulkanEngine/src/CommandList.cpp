@@ -0,0 +1,173 @@
+#include "pch.h"
+#include "CommandList.h"
+#include "VulkanContext.h"
+#include "Descriptors/DescriptorBinding.h"
+#include "Pipeline/GraphicsPipeline.h"
+
+#include <cstring>
+
+namespace vkEngine
+{
+	CommandList::CommandList(VkCommandBuffer commandBuffer)
+		: m_CommandBuffer(commandBuffer)
+	{
+	}
+
+	void CommandList::invalidate()
+	{
+		m_Graphics = {};
+		m_Compute = {};
+		m_RasterState = {};
+		m_VertexBuffers.fill(VK_NULL_HANDLE);
+		m_IndexBuffer = VK_NULL_HANDLE;
+		m_ViewportSet = false;
+		m_ScissorSet = false;
+		m_PushConstantLayout = VK_NULL_HANDLE;
+		m_PushConstantsSet.fill(false);
+	}
+
+	void CommandList::bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline)
+	{
+		BindPointState& state = bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE ? m_Compute : m_Graphics;
+		if (!filter(state.pipeline == pipeline))
+			return;
+
+		vkCmdBindPipeline(m_CommandBuffer, bindPoint, pipeline);
+		state.pipeline = pipeline;
+	}
+
+	void CommandList::setRasterState(const GraphicsPipelineConfig& config)
+	{
+		const DeviceCapabilities& capabilities = VulkanContext::getPhysicalDevice()->getCapabilities();
+		const DeviceExtensionFunctions& functions = VulkanContext::getLogicalDevice()->getExtensionFunctions();
+		RasterState& state = m_RasterState;
+
+		if (capabilities.extendedDynamicState)
+		{
+			VkBool32 depthTestEnable = config.depthTestEnable ? VK_TRUE : VK_FALSE;
+			VkBool32 depthWriteEnable = config.depthWriteEnable ? VK_TRUE : VK_FALSE;
+
+			if (filter(state.valid && state.cullMode == config.cullMode))
+				functions.cmdSetCullMode(m_CommandBuffer, config.cullMode);
+			if (filter(state.valid && state.frontFace == config.frontFace))
+				functions.cmdSetFrontFace(m_CommandBuffer, config.frontFace);
+			if (filter(state.valid && state.topology == config.topology))
+				functions.cmdSetPrimitiveTopology(m_CommandBuffer, config.topology);
+			if (filter(state.valid && state.depthTestEnable == depthTestEnable))
+				functions.cmdSetDepthTestEnable(m_CommandBuffer, depthTestEnable);
+			if (filter(state.valid && state.depthWriteEnable == depthWriteEnable))
+				functions.cmdSetDepthWriteEnable(m_CommandBuffer, depthWriteEnable);
+			if (filter(state.valid && state.depthCompareOp == config.depthCompareOp))
+				functions.cmdSetDepthCompareOp(m_CommandBuffer, config.depthCompareOp);
+
+			state.cullMode = config.cullMode;
+			state.frontFace = config.frontFace;
+			state.topology = config.topology;
+			state.depthTestEnable = depthTestEnable;
+			state.depthWriteEnable = depthWriteEnable;
+			state.depthCompareOp = config.depthCompareOp;
+		}
+
+		if (capabilities.dynamicPolygonMode)
+		{
+			if (filter(state.valid && state.polygonMode == config.polygonMode))
+				functions.cmdSetPolygonMode(m_CommandBuffer, config.polygonMode);
+			state.polygonMode = config.polygonMode;
+		}
+
+		state.valid = true;
+	}
+
+	void CommandList::bindDescriptorSet(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set, const DescriptorHandle& handle)
+	{
+		ENGINE_ASSERT(set < s_MaxDescriptorSets, "Descriptor set %u is beyond the %u sets a command list tracks", set, s_MaxDescriptorSets);
+
+		BindPointState& state = bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE ? m_Compute : m_Graphics;
+		DescriptorSetBinding& binding = state.descriptorSets[set];
+		if (!filter(binding.layout == layout && binding.handle.set == handle.set && binding.handle.bufferOffset == handle.bufferOffset))
+			return;
+
+		DescriptorBinding::bindSet(m_CommandBuffer, bindPoint, layout, set, handle);
+
+		// A set bound with another layout may disturb the others, they are only trusted while sharing its layout
+		for (DescriptorSetBinding& other : state.descriptorSets)
+		{
+			if (other.layout != layout)
+				other = {};
+		}
+		binding = { layout, handle };
+	}
+
+	void CommandList::bindVertexBuffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset)
+	{
+		ENGINE_ASSERT(binding < s_MaxVertexBuffers, "Vertex binding %u is beyond the %u bindings a command list tracks", binding, s_MaxVertexBuffers);
+		if (!filter(m_VertexBuffers[binding] == buffer && m_VertexBufferOffsets[binding] == offset))
+			return;
+
+		vkCmdBindVertexBuffers(m_CommandBuffer, binding, 1, &buffer, &offset);
+		m_VertexBuffers[binding] = buffer;
+		m_VertexBufferOffsets[binding] = offset;
+	}
+
+	void CommandList::bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType)
+	{
+		if (!filter(m_IndexBuffer == buffer && m_IndexBufferOffset == offset && m_IndexType == indexType))
+			return;
+
+		vkCmdBindIndexBuffer(m_CommandBuffer, buffer, offset, indexType);
+		m_IndexBuffer = buffer;
+		m_IndexBufferOffset = offset;
+		m_IndexType = indexType;
+	}
+
+	void CommandList::setViewport(const VkViewport& viewport)
+	{
+		if (!filter(m_ViewportSet && std::memcmp(&m_Viewport, &viewport, sizeof(VkViewport)) == 0))
+			return;
+
+		vkCmdSetViewport(m_CommandBuffer, 0, 1, &viewport);
+		m_Viewport = viewport;
+		m_ViewportSet = true;
+	}
+
+	void CommandList::setScissor(const VkRect2D& scissor)
+	{
+		if (!filter(m_ScissorSet && std::memcmp(&m_Scissor, &scissor, sizeof(VkRect2D)) == 0))
+			return;
+
+		vkCmdSetScissor(m_CommandBuffer, 0, 1, &scissor);
+		m_Scissor = scissor;
+		m_ScissorSet = true;
+	}
+
+	void CommandList::pushConstants(VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* data)
+	{
+		ENGINE_ASSERT(offset + size <= s_MaxPushConstantSize, "Push constants end at byte %u, beyond the %u bytes a command list tracks", offset + size, s_MaxPushConstantSize);
+
+		if (m_PushConstantLayout != layout)
+		{
+			m_PushConstantsSet.fill(false);
+			m_PushConstantLayout = layout;
+		}
+
+		bool known = std::all_of(m_PushConstantsSet.begin() + offset, m_PushConstantsSet.begin() + offset + size, [](bool set) { return set; });
+		if (!filter(known && std::memcmp(m_PushConstants.data() + offset, data, size) == 0))
+			return;
+
+		vkCmdPushConstants(m_CommandBuffer, layout, stages, offset, size, data);
+		std::memcpy(m_PushConstants.data() + offset, data, size);
+		std::fill(m_PushConstantsSet.begin() + offset, m_PushConstantsSet.begin() + offset + size, true);
+	}
+
+	bool CommandList::filter(bool redundant)
+	{
+		if (redundant)
+		{
+			m_Stats.skipped++;
+			return false;
+		}
+
+		m_Stats.issued++;
+		return true;
+	}
+}
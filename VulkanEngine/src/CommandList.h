@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+#include "Descriptors/DescriptorBuffer.h"
+
+namespace vkEngine
+{
+	struct GraphicsPipelineConfig;
+
+	// Calls a CommandList passed on to the command buffer and calls it dropped because the state was already set
+	struct CommandListStats
+	{
+		uint32_t issued = 0;
+		uint32_t skipped = 0;
+	};
+
+	// Records into a command buffer while remembering the state it bound, and drops calls that would bind or set it again.
+	// Only the state set through the list is known to it, call invalidate after recording the same state around it.
+	// Bindings persist across render pass instances of a command buffer, so one list serves the whole frame.
+	class CommandList
+	{
+	public:
+		static constexpr uint32_t s_MaxDescriptorSets = 4;
+		static constexpr uint32_t s_MaxVertexBuffers = 4;
+		static constexpr uint32_t s_MaxPushConstantSize = 128; // The smallest maxPushConstantsSize the spec allows
+
+		CommandList(VkCommandBuffer commandBuffer);
+
+		CommandList(const CommandList&) = delete;
+		CommandList& operator=(const CommandList&) = delete;
+
+		VkCommandBuffer getCommandBuffer() const { return m_CommandBuffer; }
+		const CommandListStats& getStats() const { return m_Stats; }
+
+		// Forgets every binding, the next call of each kind is issued
+		void invalidate();
+
+		void bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline);
+		// Sets the raster state of config that is dynamic on this device, see GraphicsPipeline::getPipelineKey
+		void setRasterState(const GraphicsPipelineConfig& config);
+		// Binds through DescriptorBinding, so it serves both descriptor backends
+		void bindDescriptorSet(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set, const DescriptorHandle& handle);
+		void bindVertexBuffer(uint32_t binding, VkBuffer buffer, VkDeviceSize offset);
+		void bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+		void setViewport(const VkViewport& viewport);
+		void setScissor(const VkRect2D& scissor);
+		void pushConstants(VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* data);
+
+	private:
+		// Counts the call and tells whether it changes anything
+		bool filter(bool redundant);
+
+	private:
+		struct DescriptorSetBinding
+		{
+			VkPipelineLayout layout = VK_NULL_HANDLE;
+			DescriptorHandle handle{};
+		};
+
+		struct BindPointState
+		{
+			VkPipeline pipeline = VK_NULL_HANDLE;
+			std::array<DescriptorSetBinding, s_MaxDescriptorSets> descriptorSets{};
+		};
+
+		struct RasterState
+		{
+			bool valid = false;
+			VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+			VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+			VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+			VkBool32 depthTestEnable = VK_FALSE;
+			VkBool32 depthWriteEnable = VK_FALSE;
+			VkCompareOp depthCompareOp = VK_COMPARE_OP_NEVER;
+			VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+		};
+
+		VkCommandBuffer m_CommandBuffer = VK_NULL_HANDLE;
+		CommandListStats m_Stats{};
+
+		BindPointState m_Graphics{};
+		BindPointState m_Compute{};
+		RasterState m_RasterState{};
+		std::array<VkBuffer, s_MaxVertexBuffers> m_VertexBuffers{};
+		std::array<VkDeviceSize, s_MaxVertexBuffers> m_VertexBufferOffsets{};
+		VkBuffer m_IndexBuffer = VK_NULL_HANDLE;
+		VkDeviceSize m_IndexBufferOffset = 0;
+		VkIndexType m_IndexType = VK_INDEX_TYPE_UINT32;
+		bool m_ViewportSet = false;
+		VkViewport m_Viewport{};
+		bool m_ScissorSet = false;
+		VkRect2D m_Scissor{};
+		// Push constants are kept per layout, pushing with another layout forgets the previous bytes
+		VkPipelineLayout m_PushConstantLayout = VK_NULL_HANDLE;
+		std::array<uint8_t, s_MaxPushConstantSize> m_PushConstants{};
+		std::array<bool, s_MaxPushConstantSize> m_PushConstantsSet{};
+	};
+}
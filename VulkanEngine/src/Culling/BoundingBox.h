@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <glm/glm.hpp>
+
+namespace vkEngine
+{
+	// Axis aligned box, empty when default constructed so growing it by the first point yields that point
+	struct BoundingBox
+	{
+		glm::vec3 min{ std::numeric_limits<float>::max() };
+		glm::vec3 max{ -std::numeric_limits<float>::max() };
+
+		static BoundingBox fromSphere(const glm::vec3& center, float radius) { return { center - glm::vec3(radius), center + glm::vec3(radius) }; }
+
+		void grow(const glm::vec3& point) { min = glm::min(min, point); max = glm::max(max, point); }
+		void grow(const BoundingBox& box) { min = glm::min(min, box.min); max = glm::max(max, box.max); }
+
+		bool isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+		glm::vec3 getCenter() const { return (min + max) * 0.5f; }
+		glm::vec3 getExtent() const { return max - min; }
+
+		// Half the surface area, the constant factor cancels out in SAH costs
+		float getHalfArea() const
+		{
+			if (isEmpty())
+				return 0.0f;
+			glm::vec3 extent = getExtent();
+			return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+		}
+
+		bool overlaps(const BoundingBox& other) const
+		{
+			return min.x <= other.max.x && max.x >= other.min.x && min.y <= other.max.y && max.y >= other.min.y && min.z <= other.max.z && max.z >= other.min.z;
+		}
+
+		bool contains(const BoundingBox& other) const
+		{
+			return min.x <= other.min.x && max.x >= other.max.x && min.y <= other.min.y && max.y >= other.max.y && min.z <= other.min.z && max.z >= other.max.z;
+		}
+	};
+
+	// Half line from origin along a normalized direction
+	struct Ray
+	{
+		glm::vec3 origin{ 0.0f };
+		glm::vec3 direction{ 0.0f, 0.0f, -1.0f };
+
+		glm::vec3 getPoint(float distance) const { return origin + direction * distance; }
+	};
+}
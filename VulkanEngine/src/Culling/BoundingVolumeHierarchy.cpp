@@ -0,0 +1,523 @@
+#include "pch.h"
+#include "BoundingVolumeHierarchy.h"
+
+#include <mutex>
+#include <numeric>
+
+namespace vkEngine
+{
+	namespace
+	{
+		constexpr size_t PARALLEL_CHUNK_SIZE = 8192;
+		constexpr float TRAVERSAL_COST = 1.0f; // Relative to testing one object
+		constexpr uint32_t STACK_SIZE = 2 * BoundingVolumeHierarchy::s_MaxSahDepth; // Median splits below the SAH depth add at most 32 levels
+
+		enum class Containment { Outside, Intersecting, Inside };
+
+		Containment classify(const Frustum& frustum, const BoundingBox& box)
+		{
+			Containment result = Containment::Inside;
+			for (const glm::vec4& plane : frustum.planes)
+			{
+				glm::vec3 normal{ plane };
+				// Corners furthest along and against the normal
+				glm::vec3 positive = glm::mix(box.min, box.max, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+				glm::vec3 negative = glm::mix(box.max, box.min, glm::greaterThanEqual(normal, glm::vec3(0.0f)));
+
+				if (glm::dot(normal, positive) + plane.w < 0.0f)
+					return Containment::Outside;
+				if (glm::dot(normal, negative) + plane.w < 0.0f)
+					result = Containment::Intersecting;
+			}
+			return result;
+		}
+
+		// Entry distance of the ray into the box, FLT_MAX when it misses or enters beyond maxDistance
+		float intersectRay(const Ray& ray, const glm::vec3& inverseDirection, const BoundingBox& box, float maxDistance)
+		{
+			glm::vec3 t0 = (box.min - ray.origin) * inverseDirection;
+			glm::vec3 t1 = (box.max - ray.origin) * inverseDirection;
+			glm::vec3 near = glm::min(t0, t1);
+			glm::vec3 far = glm::max(t0, t1);
+
+			float entry = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+			float exit = std::min(std::min(far.x, far.y), std::min(far.z, maxDistance));
+			return entry <= exit ? entry : FLT_MAX;
+		}
+
+		uint32_t getBin(const glm::vec3& centroid, const BoundingBox& centroidBounds, const glm::vec3& binScale, uint32_t axis)
+		{
+			float position = (centroid[axis] - centroidBounds.min[axis]) * binScale[axis];
+			return std::min(static_cast<uint32_t>(std::max(position, 0.0f)), BoundingVolumeHierarchy::s_BinCount - 1);
+		}
+	}
+
+	void BvhNode::setBounds(const BoundingBox& bounds)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			boundsMin[axis] = bounds.min[axis];
+			boundsMax[axis] = bounds.max[axis];
+		}
+	}
+
+	BoundingVolumeHierarchy::BoundingVolumeHierarchy(ThreadPool* threadPool)
+		: m_ThreadPool(threadPool)
+	{
+	}
+
+	void BoundingVolumeHierarchy::build(const std::vector<BoundingBox>& objectBounds)
+	{
+		m_ObjectBounds = objectBounds;
+		m_Nodes.clear();
+		m_BuildInfo.clear();
+		m_OrphanedNodes = 0;
+		if (m_ObjectBounds.empty())
+			return;
+
+		uint32_t objectCount = getObjectCount();
+		m_ObjectIndices.resize(objectCount);
+		std::iota(m_ObjectIndices.begin(), m_ObjectIndices.end(), 0);
+
+		m_Centroids.resize(objectCount);
+		for (uint32_t i = 0; i < objectCount; i++)
+		{
+			m_Centroids[i] = m_ObjectBounds[i].getCenter();
+		}
+
+		// A binary tree with a leaf per object at worst
+		m_Nodes.reserve(2 * static_cast<size_t>(objectCount) - 1);
+		m_Nodes.emplace_back();
+		m_BuildInfo.emplace_back();
+		buildNode(0, 0, objectCount, 0);
+	}
+
+	void BoundingVolumeHierarchy::refit(const std::vector<BoundingBox>& objectBounds)
+	{
+		ENGINE_ASSERT(objectBounds.size() == m_ObjectBounds.size(), "BVH refit with %zu objects, built with %zu", objectBounds.size(), m_ObjectBounds.size());
+		m_ObjectBounds = objectBounds;
+
+		// Children always follow their parent, so a reverse sweep sees them first
+		for (size_t i = m_Nodes.size(); i-- > 0;)
+		{
+			BvhNode& node = m_Nodes[i];
+			BoundingBox bounds{};
+			if (node.isLeaf())
+			{
+				for (uint32_t j = 0; j < node.objectCount; j++)
+				{
+					bounds.grow(m_ObjectBounds[m_ObjectIndices[node.childOrFirstObject + j]]);
+				}
+			}
+			else
+			{
+				bounds.grow(m_Nodes[node.childOrFirstObject].getBounds());
+				bounds.grow(m_Nodes[node.childOrFirstObject + 1].getBounds());
+			}
+			node.setBounds(bounds);
+		}
+	}
+
+	uint32_t BoundingVolumeHierarchy::update(const std::vector<BoundingBox>& objectBounds, float rebuildThreshold)
+	{
+		refit(objectBounds);
+		if (m_Nodes.empty())
+			return 0;
+
+		// Rebuilds start from the top, a rebuilt subtree is not visited further
+		std::vector<uint32_t> degradedNodes;
+		std::vector<uint32_t> stack{ 0 };
+		while (!stack.empty())
+		{
+			uint32_t nodeIndex = stack.back();
+			stack.pop_back();
+
+			const BvhNode& node = m_Nodes[nodeIndex];
+			if (node.isLeaf())
+				continue;
+
+			if (node.getBounds().getHalfArea() > m_BuildInfo[nodeIndex].area * rebuildThreshold)
+			{
+				degradedNodes.push_back(nodeIndex);
+				continue;
+			}
+			stack.push_back(node.childOrFirstObject);
+			stack.push_back(node.childOrFirstObject + 1);
+		}
+
+		for (uint32_t i = 0; i < degradedNodes.size(); i++)
+		{
+			rebuildSubtree(degradedNodes[i]);
+			// A full rebuild renumbers the nodes and already covered the remaining ones
+			if (m_OrphanedNodes == 0)
+				return i + 1;
+		}
+		return static_cast<uint32_t>(degradedNodes.size());
+	}
+
+	void BoundingVolumeHierarchy::rebuildSubtree(uint32_t nodeIndex)
+	{
+		// Too many unreachable nodes, start over with a compact tree
+		if (nodeIndex == 0 || m_OrphanedNodes > m_Nodes.size() / 2)
+		{
+			build(m_ObjectBounds);
+			return;
+		}
+
+		// The subtree owns a contiguous range of the object list, found from its leftmost and rightmost leaves
+		uint32_t first = nodeIndex, last = nodeIndex;
+		while (!m_Nodes[first].isLeaf())
+		{
+			first = m_Nodes[first].childOrFirstObject;
+		}
+		while (!m_Nodes[last].isLeaf())
+		{
+			last = m_Nodes[last].childOrFirstObject + 1;
+		}
+		uint32_t firstObject = m_Nodes[first].childOrFirstObject;
+		uint32_t objectCount = m_Nodes[last].childOrFirstObject + m_Nodes[last].objectCount - firstObject;
+
+		m_OrphanedNodes += countSubtreeNodes(nodeIndex) - 1;
+		for (uint32_t i = firstObject; i < firstObject + objectCount; i++)
+		{
+			m_Centroids[m_ObjectIndices[i]] = m_ObjectBounds[m_ObjectIndices[i]].getCenter();
+		}
+		buildNode(nodeIndex, firstObject, objectCount, m_BuildInfo[nodeIndex].depth);
+	}
+
+	void BoundingVolumeHierarchy::cullFrustum(const Frustum& frustum, std::vector<uint32_t>& objects) const
+	{
+		if (m_Nodes.empty())
+			return;
+
+		uint32_t stack[STACK_SIZE];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0)
+		{
+			const BvhNode& node = m_Nodes[stack[--stackSize]];
+			Containment containment = classify(frustum, node.getBounds());
+			if (containment == Containment::Outside)
+				continue;
+
+			// Everything below a node inside the frustum is visible without further tests
+			if (containment == Containment::Inside)
+			{
+				appendSubtree(static_cast<uint32_t>(&node - m_Nodes.data()), objects);
+				continue;
+			}
+
+			if (node.isLeaf())
+			{
+				for (uint32_t i = 0; i < node.objectCount; i++)
+				{
+					uint32_t object = m_ObjectIndices[node.childOrFirstObject + i];
+					if (classify(frustum, m_ObjectBounds[object]) != Containment::Outside)
+						objects.push_back(object);
+				}
+				continue;
+			}
+
+			ENGINE_ASSERT(stackSize + 2 <= STACK_SIZE, "BVH is deeper than the traversal stack");
+			stack[stackSize++] = node.childOrFirstObject + 1;
+			stack[stackSize++] = node.childOrFirstObject;
+		}
+	}
+
+	void BoundingVolumeHierarchy::queryRange(const BoundingBox& range, std::vector<uint32_t>& objects) const
+	{
+		if (m_Nodes.empty())
+			return;
+
+		uint32_t stack[STACK_SIZE];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0)
+		{
+			uint32_t nodeIndex = stack[--stackSize];
+			const BvhNode& node = m_Nodes[nodeIndex];
+			BoundingBox bounds = node.getBounds();
+			if (!range.overlaps(bounds))
+				continue;
+
+			if (range.contains(bounds))
+			{
+				appendSubtree(nodeIndex, objects);
+				continue;
+			}
+
+			if (node.isLeaf())
+			{
+				for (uint32_t i = 0; i < node.objectCount; i++)
+				{
+					uint32_t object = m_ObjectIndices[node.childOrFirstObject + i];
+					if (range.overlaps(m_ObjectBounds[object]))
+						objects.push_back(object);
+				}
+				continue;
+			}
+
+			ENGINE_ASSERT(stackSize + 2 <= STACK_SIZE, "BVH is deeper than the traversal stack");
+			stack[stackSize++] = node.childOrFirstObject + 1;
+			stack[stackSize++] = node.childOrFirstObject;
+		}
+	}
+
+	std::optional<RayHit> BoundingVolumeHierarchy::raycast(const Ray& ray, float maxDistance, const ObjectIntersector& intersectObject) const
+	{
+		if (m_Nodes.empty())
+			return std::nullopt;
+
+		glm::vec3 inverseDirection = 1.0f / ray.direction;
+		std::optional<RayHit> closestHit;
+		float closestDistance = maxDistance;
+
+		// Nodes are visited front to back and skipped once a closer hit is known
+		struct StackEntry { uint32_t node; float entry; };
+		StackEntry stack[STACK_SIZE];
+		uint32_t stackSize = 0;
+
+		float rootEntry = intersectRay(ray, inverseDirection, m_Nodes[0].getBounds(), closestDistance);
+		if (rootEntry != FLT_MAX)
+			stack[stackSize++] = { 0, rootEntry };
+
+		while (stackSize > 0)
+		{
+			StackEntry entry = stack[--stackSize];
+			if (entry.entry > closestDistance)
+				continue;
+
+			const BvhNode& node = m_Nodes[entry.node];
+			if (node.isLeaf())
+			{
+				for (uint32_t i = 0; i < node.objectCount; i++)
+				{
+					uint32_t object = m_ObjectIndices[node.childOrFirstObject + i];
+					float distance = intersectRay(ray, inverseDirection, m_ObjectBounds[object], closestDistance);
+					if (distance == FLT_MAX)
+						continue;
+
+					if (intersectObject)
+					{
+						std::optional<float> objectDistance = intersectObject(object, ray);
+						if (!objectDistance || *objectDistance > closestDistance)
+							continue;
+						distance = *objectDistance;
+					}
+
+					closestDistance = distance;
+					closestHit = RayHit{ object, distance };
+				}
+				continue;
+			}
+
+			uint32_t nearChild = node.childOrFirstObject, farChild = node.childOrFirstObject + 1;
+			float nearEntry = intersectRay(ray, inverseDirection, m_Nodes[nearChild].getBounds(), closestDistance);
+			float farEntry = intersectRay(ray, inverseDirection, m_Nodes[farChild].getBounds(), closestDistance);
+			if (farEntry < nearEntry)
+			{
+				std::swap(nearChild, farChild);
+				std::swap(nearEntry, farEntry);
+			}
+
+			ENGINE_ASSERT(stackSize + 2 <= STACK_SIZE, "BVH is deeper than the traversal stack");
+			if (farEntry != FLT_MAX)
+				stack[stackSize++] = { farChild, farEntry };
+			if (nearEntry != FLT_MAX)
+				stack[stackSize++] = { nearChild, nearEntry };
+		}
+		return closestHit;
+	}
+
+	uint32_t BoundingVolumeHierarchy::allocateChildren()
+	{
+		uint32_t index = static_cast<uint32_t>(m_Nodes.size());
+		m_Nodes.resize(m_Nodes.size() + 2);
+		m_BuildInfo.resize(m_Nodes.size());
+		return index;
+	}
+
+	void BoundingVolumeHierarchy::buildNode(uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth)
+	{
+		BoundingBox bounds{}, centroidBounds{};
+		computeBounds(first, count, bounds, centroidBounds);
+		m_Nodes[nodeIndex].setBounds(bounds);
+		m_BuildInfo[nodeIndex] = { bounds.getHalfArea(), depth };
+
+		auto makeLeaf = [this, nodeIndex, first, count]()
+			{
+				m_Nodes[nodeIndex].childOrFirstObject = first;
+				m_Nodes[nodeIndex].objectCount = count;
+			};
+
+		if (count <= 2)
+		{
+			makeLeaf();
+			return;
+		}
+
+		// Splitting must beat testing every object of the node
+		Split split = depth < s_MaxSahDepth ? findSplit(first, count, centroidBounds) : Split{};
+		float area = bounds.getHalfArea();
+		float splitCost = area > 0.0f ? TRAVERSAL_COST + split.cost / area : FLT_MAX;
+		if (count <= s_MaxLeafObjects && splitCost >= static_cast<float>(count))
+		{
+			makeLeaf();
+			return;
+		}
+
+		auto middle = m_ObjectIndices.begin() + first + count / 2;
+		if (split.cost != FLT_MAX)
+		{
+			glm::vec3 binScale = glm::vec3(static_cast<float>(s_BinCount)) / glm::max(centroidBounds.getExtent(), glm::vec3(FLT_MIN));
+			middle = std::partition(m_ObjectIndices.begin() + first, m_ObjectIndices.begin() + first + count, [&](uint32_t object)
+				{
+					return getBin(m_Centroids[object], centroidBounds, binScale, split.axis) <= split.bin;
+				});
+		}
+
+		// Coincident centroids cannot be binned apart and deep nodes skip SAH, both are split in half by index instead
+		uint32_t leftCount = static_cast<uint32_t>(middle - (m_ObjectIndices.begin() + first));
+		if (leftCount == 0 || leftCount == count)
+			leftCount = count / 2;
+
+		uint32_t children = allocateChildren();
+		m_Nodes[nodeIndex].childOrFirstObject = children;
+		m_Nodes[nodeIndex].objectCount = 0;
+
+		buildNode(children, first, leftCount, depth + 1);
+		buildNode(children + 1, first + leftCount, count - leftCount, depth + 1);
+	}
+
+	void BoundingVolumeHierarchy::computeBounds(uint32_t first, uint32_t count, BoundingBox& bounds, BoundingBox& centroidBounds) const
+	{
+		auto accumulate = [this, first](size_t begin, size_t end, BoundingBox& rangeBounds, BoundingBox& rangeCentroids)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					uint32_t object = m_ObjectIndices[first + i];
+					rangeBounds.grow(m_ObjectBounds[object]);
+					rangeCentroids.grow(m_Centroids[object]);
+				}
+			};
+
+		if (!m_ThreadPool || count < s_ParallelBinningThreshold)
+		{
+			accumulate(0, count, bounds, centroidBounds);
+			return;
+		}
+
+		std::mutex mutex;
+		m_ThreadPool->parallelFor(count, PARALLEL_CHUNK_SIZE, [&](size_t begin, size_t end)
+			{
+				BoundingBox chunkBounds{}, chunkCentroids{};
+				accumulate(begin, end, chunkBounds, chunkCentroids);
+
+				std::lock_guard<std::mutex> lock(mutex);
+				bounds.grow(chunkBounds);
+				centroidBounds.grow(chunkCentroids);
+			});
+	}
+
+	BoundingVolumeHierarchy::Split BoundingVolumeHierarchy::findSplit(uint32_t first, uint32_t count, const BoundingBox& centroidBounds) const
+	{
+		glm::vec3 extent = centroidBounds.getExtent();
+		glm::vec3 binScale = glm::vec3(static_cast<float>(s_BinCount)) / glm::max(extent, glm::vec3(FLT_MIN));
+
+		auto binRange = [&](size_t begin, size_t end, AxisBins& bins)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					uint32_t object = m_ObjectIndices[first + i];
+					for (uint32_t axis = 0; axis < 3; axis++)
+					{
+						Bin& bin = bins[axis][getBin(m_Centroids[object], centroidBounds, binScale, axis)];
+						bin.bounds.grow(m_ObjectBounds[object]);
+						bin.count++;
+					}
+				}
+			};
+
+		AxisBins bins{};
+		if (!m_ThreadPool || count < s_ParallelBinningThreshold)
+		{
+			binRange(0, count, bins);
+		}
+		else
+		{
+			std::mutex mutex;
+			m_ThreadPool->parallelFor(count, PARALLEL_CHUNK_SIZE, [&](size_t begin, size_t end)
+				{
+					AxisBins chunkBins{};
+					binRange(begin, end, chunkBins);
+
+					std::lock_guard<std::mutex> lock(mutex);
+					for (uint32_t axis = 0; axis < 3; axis++)
+					{
+						for (uint32_t b = 0; b < s_BinCount; b++)
+						{
+							bins[axis][b].bounds.grow(chunkBins[axis][b].bounds);
+							bins[axis][b].count += chunkBins[axis][b].count;
+						}
+					}
+				});
+		}
+
+		// Sweeping from both ends gives the area and count on each side of every bin boundary
+		Split best{};
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			if (extent[axis] <= 0.0f)
+				continue;
+
+			std::array<float, s_BinCount - 1> leftCost{};
+			BoundingBox leftBounds{};
+			uint32_t leftCount = 0;
+			for (uint32_t b = 0; b < s_BinCount - 1; b++)
+			{
+				leftBounds.grow(bins[axis][b].bounds);
+				leftCount += bins[axis][b].count;
+				leftCost[b] = leftBounds.getHalfArea() * leftCount;
+			}
+
+			BoundingBox rightBounds{};
+			uint32_t rightCount = 0;
+			for (uint32_t b = s_BinCount - 1; b > 0; b--)
+			{
+				rightBounds.grow(bins[axis][b].bounds);
+				rightCount += bins[axis][b].count;
+
+				float cost = leftCost[b - 1] + rightBounds.getHalfArea() * rightCount;
+				if (rightCount > 0 && rightCount < count && cost < best.cost)
+					best = { axis, b - 1, cost };
+			}
+		}
+		return best;
+	}
+
+	uint32_t BoundingVolumeHierarchy::countSubtreeNodes(uint32_t nodeIndex) const
+	{
+		const BvhNode& node = m_Nodes[nodeIndex];
+		if (node.isLeaf())
+			return 1;
+		return 1 + countSubtreeNodes(node.childOrFirstObject) + countSubtreeNodes(node.childOrFirstObject + 1);
+	}
+
+	// Every object of a subtree sits in one contiguous range of the object list
+	void BoundingVolumeHierarchy::appendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& objects) const
+	{
+		uint32_t first = nodeIndex, last = nodeIndex;
+		while (!m_Nodes[first].isLeaf())
+		{
+			first = m_Nodes[first].childOrFirstObject;
+		}
+		while (!m_Nodes[last].isLeaf())
+		{
+			last = m_Nodes[last].childOrFirstObject + 1;
+		}
+
+		auto begin = m_ObjectIndices.begin() + m_Nodes[first].childOrFirstObject;
+		auto end = m_ObjectIndices.begin() + m_Nodes[last].childOrFirstObject + m_Nodes[last].objectCount;
+		objects.insert(objects.end(), begin, end);
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cfloat>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "Camera/Frustum.h"
+#include "Culling/BoundingBox.h"
+#include "Utility/ThreadPool.h"
+
+namespace vkEngine
+{
+	// Flattened node, 32 bytes so two share a cache line. Inner nodes keep their two children next to each other
+	// at childOrFirstObject, leaves list objectCount entries of the object index list starting at childOrFirstObject
+	struct BvhNode
+	{
+		float boundsMin[3];
+		uint32_t childOrFirstObject;
+		float boundsMax[3];
+		uint32_t objectCount; // 0 for inner nodes
+
+		bool isLeaf() const { return objectCount > 0; }
+		BoundingBox getBounds() const { return { { boundsMin[0], boundsMin[1], boundsMin[2] }, { boundsMax[0], boundsMax[1], boundsMax[2] } }; }
+		void setBounds(const BoundingBox& bounds);
+	};
+	static_assert(sizeof(BvhNode) == 32, "BvhNode is expected to stay 32 bytes");
+
+	struct RayHit
+	{
+		uint32_t object = 0;
+		float distance = 0.0f;
+	};
+
+	// Spatial index over object bounding boxes for culling, picking and range queries. Built top down with binned SAH,
+	// binning of large nodes runs on the thread pool. Moving objects are handled by refitting the bounds, subtrees whose
+	// quality degraded too far are rebuilt in isolation, their old nodes are reclaimed by the next full build.
+	class BoundingVolumeHierarchy
+	{
+	public:
+		// Distance along the ray to the object's own shape, empty when the ray misses it
+		using ObjectIntersector = std::function<std::optional<float>(uint32_t object, const Ray& ray)>;
+
+		static constexpr uint32_t s_BinCount = 16;
+		static constexpr uint32_t s_MaxLeafObjects = 8; // Larger nodes are always split
+		static constexpr uint32_t s_ParallelBinningThreshold = 1u << 15; // Nodes with at least this many objects are binned on the thread pool
+		static constexpr uint32_t s_MaxSahDepth = 64; // Deeper nodes are split in half, which bounds the traversal stacks
+		static constexpr float s_DefaultRebuildThreshold = 2.0f;
+
+		// threadPool may be null, the build then runs on the calling thread
+		BoundingVolumeHierarchy(ThreadPool* threadPool = nullptr);
+
+		// Builds from scratch, object i is bounded by objectBounds[i]
+		void build(const std::vector<BoundingBox>& objectBounds);
+		// Moves the bounds of every node to the objects' new bounds, the topology is kept
+		void refit(const std::vector<BoundingBox>& objectBounds);
+		// Refits, then rebuilds the highest subtrees whose surface grew by more than rebuildThreshold since they were built.
+		// Returns the number of rebuilt subtrees
+		uint32_t update(const std::vector<BoundingBox>& objectBounds, float rebuildThreshold = s_DefaultRebuildThreshold);
+		// Rebuilds the subtree below nodeIndex from the current object bounds, the node itself keeps its index and bounds
+		void rebuildSubtree(uint32_t nodeIndex);
+
+		// Appends the objects whose bounds intersect the frustum
+		void cullFrustum(const Frustum& frustum, std::vector<uint32_t>& objects) const;
+		// Appends the objects whose bounds overlap range
+		void queryRange(const BoundingBox& range, std::vector<uint32_t>& objects) const;
+		// Closest object along the ray, object boxes are the hit shapes unless intersectObject refines them
+		std::optional<RayHit> raycast(const Ray& ray, float maxDistance = FLT_MAX, const ObjectIntersector& intersectObject = {}) const;
+
+		const std::vector<BvhNode>& getNodes() const { return m_Nodes; }
+		uint32_t getObjectCount() const { return static_cast<uint32_t>(m_ObjectBounds.size()); }
+		bool isEmpty() const { return m_ObjectBounds.empty(); }
+
+	private:
+		struct Bin
+		{
+			BoundingBox bounds{};
+			uint32_t count = 0;
+		};
+		using AxisBins = std::array<std::array<Bin, s_BinCount>, 3>;
+
+		struct Split
+		{
+			uint32_t axis = 0;
+			uint32_t bin = 0; // Objects in bins up to and including this one go left
+			float cost = FLT_MAX;
+		};
+
+		uint32_t allocateChildren();
+		void buildNode(uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth);
+		void computeBounds(uint32_t first, uint32_t count, BoundingBox& bounds, BoundingBox& centroidBounds) const;
+		Split findSplit(uint32_t first, uint32_t count, const BoundingBox& centroidBounds) const;
+		uint32_t countSubtreeNodes(uint32_t nodeIndex) const;
+		void appendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& objects) const;
+
+	private:
+		ThreadPool* m_ThreadPool = nullptr;
+
+		std::vector<BvhNode> m_Nodes{}; // Root at 0, children always come after their parent
+		struct NodeBuildInfo
+		{
+			float area = 0.0f; // Surface when the node was built, refits are measured against it
+			uint32_t depth = 0;
+		};
+		std::vector<NodeBuildInfo> m_BuildInfo{};
+		std::vector<uint32_t> m_ObjectIndices{}; // Leaves reference ranges of this list, every subtree owns a contiguous range
+		std::vector<BoundingBox> m_ObjectBounds{};
+		std::vector<glm::vec3> m_Centroids{};
+		uint32_t m_OrphanedNodes = 0; // Left behind by subtree rebuilds
+	};
+}
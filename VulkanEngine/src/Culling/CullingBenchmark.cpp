@@ -0,0 +1,255 @@
+#include "pch.h"
+#include "CullingBenchmark.h"
+#include "FrustumCuller.h"
+#include "BoundingVolumeHierarchy.h"
+#include "OcclusionRasterizer.h"
+
+#include <random>
+
+namespace vkEngine
+{
+	namespace
+	{
+		const uint32_t WARMUP_ITERATIONS = 3, MEASURED_ITERATIONS = 20;
+		const uint32_t QUERY_COUNT = 10000;
+		const float SCENE_EXTENT = 1000.0f, RANGE_QUERY_EXTENT = 50.0f, MOVE_DISTANCE = 2.0f;
+		const uint32_t OCCLUSION_TEST_BOXES = 100000;
+		const float OCCLUSION_SCENE_WIDTH = 60.0f, OCCLUSION_SCENE_NEAR = 5.0f, OCCLUSION_SCENE_FAR = 200.0f;
+
+		// Average time of one cull over the measured iterations
+		float measure(const std::function<size_t()>& cull, size_t& visibleCount)
+		{
+			for (uint32_t i = 0; i < WARMUP_ITERATIONS; i++)
+			{
+				visibleCount = cull();
+			}
+
+			Timer timer("CullingBenchmark");
+			timer.Start();
+			for (uint32_t i = 0; i < MEASURED_ITERATIONS; i++)
+			{
+				visibleCount = cull();
+			}
+			timer.Stop();
+			return timer.GetTimeMilliseconds() / MEASURED_ITERATIONS;
+		}
+
+		// Unit cube around the origin
+		OccluderMesh createBoxOccluder()
+		{
+			OccluderMesh mesh;
+			for (uint32_t corner = 0; corner < 8; corner++)
+			{
+				mesh.vertices.push_back({ corner & 1 ? 0.5f : -0.5f, corner & 2 ? 0.5f : -0.5f, corner & 4 ? 0.5f : -0.5f });
+			}
+			mesh.indices = { 0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4, 2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5 };
+			return mesh;
+		}
+
+		// A screen filling wall must hide a box behind it but not one in front of it
+		bool checkWall(OcclusionRasterizer& rasterizer, const glm::mat4& viewProjection)
+		{
+			OccluderMesh wall{ { { -1.0f, -1.0f, 0.0f }, { 1.0f, -1.0f, 0.0f }, { 1.0f, 1.0f, 0.0f }, { -1.0f, 1.0f, 0.0f } }, { 0, 1, 2, 0, 2, 3 } };
+			rasterizer.begin(viewProjection);
+			rasterizer.addOccluder(wall, glm::translate(glm::vec3(0.0f, 0.0f, -20.0f)) * glm::scale(glm::vec3(100.0f)));
+			rasterizer.rasterize();
+
+			bool hidesBehind = !rasterizer.isVisible({ glm::vec3(-1.0f, -1.0f, -41.0f), glm::vec3(1.0f, 1.0f, -39.0f) });
+			bool keepsFront = rasterizer.isVisible({ glm::vec3(-1.0f, -1.0f, -11.0f), glm::vec3(1.0f, 1.0f, -9.0f) });
+			return hidesBehind && keepsFront;
+		}
+	}
+
+	void runCullingBenchmark(uint32_t objectCount)
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> position(-SCENE_EXTENT, SCENE_EXTENT);
+		std::uniform_real_distribution<float> size(0.5f, 5.0f);
+
+		BoundingSpheres spheres;
+		BoundingBoxes boxes;
+		std::vector<BoundingBox> objectBounds;
+		objectBounds.reserve(objectCount);
+		for (uint32_t i = 0; i < objectCount; i++)
+		{
+			glm::vec3 center{ position(random), position(random), position(random) };
+			float radius = size(random);
+			spheres.add(center, radius);
+			boxes.add(center - glm::vec3(radius), center + glm::vec3(radius));
+			objectBounds.push_back(BoundingBox::fromSphere(center, radius));
+		}
+
+		glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, SCENE_EXTENT);
+		glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		Frustum frustum = Frustum::fromViewProjection(projection * view);
+
+		ThreadPool threadPool;
+		ENGINE_INFO("Culling benchmark: %u objects, %u worker threads, best SIMD level %s", objectCount, threadPool.getWorkerCount(),
+			FrustumCuller::getSimdLevelName(FrustumCuller::getSupportedSimdLevel()));
+
+		std::vector<uint8_t> visibility;
+		size_t referenceSpheres = SIZE_MAX, referenceBoxes = SIZE_MAX;
+		for (ThreadPool* pool : { static_cast<ThreadPool*>(nullptr), &threadPool })
+		{
+			for (uint32_t level = 0; level <= static_cast<uint32_t>(FrustumCuller::getSupportedSimdLevel()); level++)
+			{
+				FrustumCuller culler(pool);
+				culler.setSimdLevel(static_cast<FrustumCuller::SimdLevel>(level));
+
+				size_t visibleSpheres = 0, visibleBoxes = 0;
+				float sphereTime = measure([&]() { return culler.cullSpheres(frustum, spheres, visibility); }, visibleSpheres);
+				float boxTime = measure([&]() { return culler.cullBoxes(frustum, boxes, visibility); }, visibleBoxes);
+
+				ENGINE_INFO("  %-6s %-8s spheres %.0f objects/ms (%zu visible), boxes %.0f objects/ms (%zu visible)",
+					FrustumCuller::getSimdLevelName(culler.getSimdLevel()), pool ? "threaded" : "single",
+					objectCount / sphereTime, visibleSpheres, objectCount / boxTime, visibleBoxes);
+
+				// Every path must agree with the scalar single threaded one
+				if (referenceSpheres == SIZE_MAX)
+				{
+					referenceSpheres = visibleSpheres;
+					referenceBoxes = visibleBoxes;
+				}
+				else if (visibleSpheres != referenceSpheres || visibleBoxes != referenceBoxes)
+				{
+					ENGINE_WARN("Culling benchmark: %s results differ from the scalar path", FrustumCuller::getSimdLevelName(culler.getSimdLevel()));
+				}
+			}
+		}
+
+		// The BVH visits only the nodes touching the query, so its cost follows the result size rather than the scene size
+		BoundingVolumeHierarchy bvh(&threadPool);
+		Timer timer("BvhBuild");
+		timer.Start();
+		bvh.build(objectBounds);
+		timer.Stop();
+		ENGINE_INFO("  BVH    build %.1f ms, %zu nodes", timer.GetTimeMilliseconds(), bvh.getNodes().size());
+
+		std::vector<uint32_t> objects;
+		size_t visibleObjects = 0;
+		float cullTime = measure([&]() { objects.clear(); bvh.cullFrustum(frustum, objects); return objects.size(); }, visibleObjects);
+		ENGINE_INFO("  BVH    frustum %.0f objects/ms (%zu visible)", objectCount / cullTime, visibleObjects);
+
+		std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+		size_t hits = 0;
+		float rayTime = measure([&]()
+			{
+				size_t rayHits = 0;
+				std::mt19937 rayRandom(42);
+				for (uint32_t i = 0; i < QUERY_COUNT; i++)
+				{
+					Ray ray{ glm::vec3(0.0f), glm::normalize(glm::vec3(direction(rayRandom), direction(rayRandom), direction(rayRandom)) + glm::vec3(0.0f, 0.0f, 0.001f)) };
+					rayHits += bvh.raycast(ray).has_value() ? 1 : 0;
+				}
+				return rayHits;
+			}, hits);
+		ENGINE_INFO("  BVH    raycast %.2f us/ray (%zu of %u hit)", rayTime * 1000.0f / QUERY_COUNT, hits, QUERY_COUNT);
+
+		size_t rangeObjects = 0;
+		float rangeTime = measure([&]()
+			{
+				std::mt19937 rangeRandom(7);
+				objects.clear();
+				for (uint32_t i = 0; i < QUERY_COUNT; i++)
+				{
+					glm::vec3 center{ position(rangeRandom), position(rangeRandom), position(rangeRandom) };
+					bvh.queryRange({ center - glm::vec3(RANGE_QUERY_EXTENT), center + glm::vec3(RANGE_QUERY_EXTENT) }, objects);
+				}
+				return objects.size();
+			}, rangeObjects);
+		ENGINE_INFO("  BVH    range %.2f us/query (%zu objects found)", rangeTime * 1000.0f / QUERY_COUNT, rangeObjects);
+
+		// Every object drifts a little, the update refits and rebuilds only the subtrees that degraded
+		std::uniform_real_distribution<float> offset(-MOVE_DISTANCE, MOVE_DISTANCE);
+		for (BoundingBox& bounds : objectBounds)
+		{
+			glm::vec3 move{ offset(random), offset(random), offset(random) };
+			bounds.min += move;
+			bounds.max += move;
+		}
+		timer.Start();
+		uint32_t rebuiltSubtrees = bvh.update(objectBounds);
+		timer.Stop();
+		ENGINE_INFO("  BVH    update %.1f ms, %u subtrees rebuilt", timer.GetTimeMilliseconds(), rebuiltSubtrees);
+	}
+
+	void runOcclusionBenchmark(uint32_t occluderCount)
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> lateral(-OCCLUSION_SCENE_WIDTH, OCCLUSION_SCENE_WIDTH);
+		std::uniform_real_distribution<float> depth(-OCCLUSION_SCENE_FAR, -OCCLUSION_SCENE_NEAR);
+		std::uniform_real_distribution<float> occluderSize(1.0f, 6.0f);
+		std::uniform_real_distribution<float> boxSize(0.5f, 3.0f);
+		std::uniform_real_distribution<float> angle(0.0f, glm::two_pi<float>());
+
+		OccluderMesh boxOccluder = createBoxOccluder();
+		std::vector<glm::mat4> occluderModels;
+		occluderModels.reserve(occluderCount);
+		for (uint32_t i = 0; i < occluderCount; i++)
+		{
+			glm::vec3 position{ lateral(random), lateral(random), depth(random) };
+			glm::vec3 axis = glm::normalize(glm::vec3(lateral(random), lateral(random), lateral(random)) + glm::vec3(0.0f, 0.001f, 0.0f));
+			occluderModels.push_back(glm::translate(position) * glm::rotate(angle(random), axis) * glm::scale(glm::vec3(occluderSize(random))));
+		}
+
+		std::vector<BoundingBox> boxes;
+		boxes.reserve(OCCLUSION_TEST_BOXES);
+		for (uint32_t i = 0; i < OCCLUSION_TEST_BOXES; i++)
+		{
+			glm::vec3 center{ lateral(random), lateral(random), depth(random) };
+			boxes.push_back(BoundingBox::fromSphere(center, boxSize(random)));
+		}
+
+		glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, SCENE_EXTENT);
+		projection[1][1] *= -1;
+		glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 viewProjection = projection * view;
+
+		ThreadPool threadPool;
+		ENGINE_INFO("Occlusion benchmark: %u occluders (%u triangles), %u boxes, %ux%u buffer, %u worker threads", occluderCount,
+			occluderCount * boxOccluder.getTriangleCount(), OCCLUSION_TEST_BOXES, OcclusionRasterizer::s_DefaultWidth, OcclusionRasterizer::s_DefaultHeight,
+			threadPool.getWorkerCount());
+
+		std::vector<float> referenceDepth;
+		std::vector<uint8_t> visibility;
+		size_t referenceVisible = SIZE_MAX;
+		for (ThreadPool* pool : { static_cast<ThreadPool*>(nullptr), &threadPool })
+		{
+			for (uint32_t level = 0; level <= static_cast<uint32_t>(FrustumCuller::getSupportedSimdLevel()); level++)
+			{
+				OcclusionRasterizer rasterizer(pool);
+				rasterizer.setSimdLevel(static_cast<OcclusionRasterizer::SimdLevel>(level));
+				const char* levelName = FrustumCuller::getSimdLevelName(rasterizer.getSimdLevel());
+
+				if (!checkWall(rasterizer, viewProjection))
+					ENGINE_WARN("Occlusion benchmark: %s wall test failed", levelName);
+
+				size_t rasterizedTriangles = 0, visibleBoxes = 0;
+				float rasterTime = measure([&]()
+					{
+						rasterizer.begin(viewProjection);
+						for (const glm::mat4& model : occluderModels)
+						{
+							rasterizer.addOccluder(boxOccluder, model);
+						}
+						return rasterizer.rasterize();
+					}, rasterizedTriangles);
+				float testTime = measure([&]() { return rasterizer.testBoxes(boxes, visibility); }, visibleBoxes);
+
+				ENGINE_INFO("  %-6s %-8s occluders %.0f triangles/ms (%zu rasterized), boxes %.0f boxes/ms (%zu visible)", levelName, pool ? "threaded" : "single",
+					rasterizedTriangles / rasterTime, rasterizedTriangles, OCCLUSION_TEST_BOXES / testTime, visibleBoxes);
+
+				// Every path must write the same depths as the scalar single threaded one
+				if (referenceVisible == SIZE_MAX)
+				{
+					referenceDepth = rasterizer.getDepthBuffer();
+					referenceVisible = visibleBoxes;
+				}
+				else if (rasterizer.getDepthBuffer() != referenceDepth || visibleBoxes != referenceVisible)
+				{
+					ENGINE_WARN("Occlusion benchmark: %s results differ from the scalar path", levelName);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+namespace vkEngine
+{
+	// Culls objectCount random spheres and boxes with every SIMD level the CPU supports, on the calling thread and
+	// on a thread pool, and logs the throughput in objects per millisecond
+	void runCullingBenchmark(uint32_t objectCount);
+
+	// Rasterizes occluderCount random boxes into the CPU occlusion buffer and tests random bounding boxes against it with
+	// every SIMD level, on the calling thread and on a thread pool. Logs occluder triangles and boxes per millisecond and
+	// warns when a path disagrees with the scalar one or a plain wall fails to hide what is behind it
+	void runOcclusionBenchmark(uint32_t occluderCount);
+}
@@ -0,0 +1,378 @@
+#include "pch.h"
+#include "FrustumCuller.h"
+
+#include <atomic>
+#include <bit>
+
+#if defined(_M_X64) || defined(__x86_64__)
+	#define ENGINE_CULL_X86 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define ENGINE_TARGET_AVX2
+	#else
+		#define ENGINE_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#else
+	#define ENGINE_CULL_X86 0
+#endif
+
+namespace vkEngine
+{
+	namespace
+	{
+		// Plane components split like the bounding volumes, so each one is splatted into a register once per range
+		struct PlaneSet
+		{
+			float normalX[Frustum::PlaneCount];
+			float normalY[Frustum::PlaneCount];
+			float normalZ[Frustum::PlaneCount];
+			float distance[Frustum::PlaneCount];
+		};
+
+		// Corner of each box furthest along a plane's normal, picked per plane since the normal is the same for every box
+		struct BoxCorners
+		{
+			const float* x[Frustum::PlaneCount];
+			const float* y[Frustum::PlaneCount];
+			const float* z[Frustum::PlaneCount];
+		};
+
+		using SphereKernel = size_t(*)(const PlaneSet&, const BoundingSpheres&, uint8_t*, size_t, size_t);
+		using BoxKernel = size_t(*)(const PlaneSet&, const BoxCorners&, uint8_t*, size_t, size_t);
+
+		PlaneSet toPlaneSet(const Frustum& frustum)
+		{
+			PlaneSet planes{};
+			for (uint32_t p = 0; p < Frustum::PlaneCount; p++)
+			{
+				planes.normalX[p] = frustum.planes[p].x;
+				planes.normalY[p] = frustum.planes[p].y;
+				planes.normalZ[p] = frustum.planes[p].z;
+				planes.distance[p] = frustum.planes[p].w;
+			}
+			return planes;
+		}
+
+		BoxCorners toBoxCorners(const PlaneSet& planes, const BoundingBoxes& boxes)
+		{
+			BoxCorners corners{};
+			for (uint32_t p = 0; p < Frustum::PlaneCount; p++)
+			{
+				corners.x[p] = planes.normalX[p] >= 0.0f ? boxes.maxX.data() : boxes.minX.data();
+				corners.y[p] = planes.normalY[p] >= 0.0f ? boxes.maxY.data() : boxes.minY.data();
+				corners.z[p] = planes.normalZ[p] >= 0.0f ? boxes.maxZ.data() : boxes.minZ.data();
+			}
+			return corners;
+		}
+
+		// Expands a movemask into one byte per object
+		size_t storeMask(uint8_t* visibility, uint32_t mask, uint32_t width)
+		{
+			for (uint32_t k = 0; k < width; k++)
+			{
+				visibility[k] = static_cast<uint8_t>((mask >> k) & 1);
+			}
+			return static_cast<size_t>(std::popcount(mask));
+		}
+
+		// Every path sums the plane terms in the same order, so all of them give identical results
+		size_t cullSpheresScalar(const PlaneSet& planes, const BoundingSpheres& spheres, uint8_t* visibility, size_t begin, size_t end)
+		{
+			size_t visibleCount = 0;
+			for (size_t i = begin; i < end; i++)
+			{
+				bool visible = true;
+				for (uint32_t p = 0; p < Frustum::PlaneCount && visible; p++)
+				{
+					float distance = (planes.normalX[p] * spheres.centerX[i] + planes.normalY[p] * spheres.centerY[i]) + (planes.normalZ[p] * spheres.centerZ[i] + planes.distance[p]);
+					visible = distance >= -spheres.radius[i];
+				}
+				visibility[i] = visible ? 1 : 0;
+				visibleCount += visible ? 1 : 0;
+			}
+			return visibleCount;
+		}
+
+		size_t cullBoxesScalar(const PlaneSet& planes, const BoxCorners& corners, uint8_t* visibility, size_t begin, size_t end)
+		{
+			size_t visibleCount = 0;
+			for (size_t i = begin; i < end; i++)
+			{
+				bool visible = true;
+				for (uint32_t p = 0; p < Frustum::PlaneCount && visible; p++)
+				{
+					float distance = (planes.normalX[p] * corners.x[p][i] + planes.normalY[p] * corners.y[p][i]) + (planes.normalZ[p] * corners.z[p][i] + planes.distance[p]);
+					visible = distance >= 0.0f;
+				}
+				visibility[i] = visible ? 1 : 0;
+				visibleCount += visible ? 1 : 0;
+			}
+			return visibleCount;
+		}
+
+#if ENGINE_CULL_X86
+		size_t cullSpheresSSE(const PlaneSet& planes, const BoundingSpheres& spheres, uint8_t* visibility, size_t begin, size_t end)
+		{
+			__m128 normalX[Frustum::PlaneCount], normalY[Frustum::PlaneCount], normalZ[Frustum::PlaneCount], distance[Frustum::PlaneCount];
+			for (uint32_t p = 0; p < Frustum::PlaneCount; p++)
+			{
+				normalX[p] = _mm_set1_ps(planes.normalX[p]);
+				normalY[p] = _mm_set1_ps(planes.normalY[p]);
+				normalZ[p] = _mm_set1_ps(planes.normalZ[p]);
+				distance[p] = _mm_set1_ps(planes.distance[p]);
+			}
+
+			size_t visibleCount = 0;
+			size_t i = begin;
+			for (; i + 4 <= end; i += 4)
+			{
+				__m128 centerX = _mm_loadu_ps(spheres.centerX.data() + i);
+				__m128 centerY = _mm_loadu_ps(spheres.centerY.data() + i);
+				__m128 centerZ = _mm_loadu_ps(spheres.centerZ.data() + i);
+				__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radius.data() + i));
+
+				__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (uint32_t p = 0; p < Frustum::PlaneCount; p++)
+				{
+					__m128 planeDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX[p], centerX), _mm_mul_ps(normalY[p], centerY)),
+						_mm_add_ps(_mm_mul_ps(normalZ[p], centerZ), distance[p]));
+					visible = _mm_and_ps(visible, _mm_cmpge_ps(planeDistance, negativeRadius));
+				}
+				visibleCount += storeMask(visibility + i, static_cast<uint32_t>(_mm_movemask_ps(visible)), 4);
+			}
+			return visibleCount + cullSpheresScalar(planes, spheres, visibility, i, end);
+		}
+
+		size_t cullBoxesSSE(const PlaneSet& planes, const BoxCorners& corners, uint8_t* visibility, size_t begin, size_t end)
+		{
+			__m128 normalX[Frustum::PlaneCount], normalY[Frustum::PlaneCount], normalZ[Frustum::PlaneCount], distance[Frustum::PlaneCount];
+			for (uint32_t p = 0; p < Frustum::PlaneCount; p++)
+			{
+				normalX[p] = _mm_set1_ps(planes.normalX[p]);
+				normalY[p] = _mm_set1_ps(planes.normalY[p]);
+				normalZ[p] = _mm_set1_ps(planes.normalZ[p]);
+				distance[p] = _mm_set1_ps(planes.distance[p]);
+			}
+
+			size_t visibleCount = 0;
+			size_t i = begin;
+			for (; i + 4 <= end; i += 4)
+			{
+				__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (uint32_t p = 0; p < Frustum::PlaneCount; p++)
+				{
+					__m128 planeDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX[p], _mm_loadu_ps(corners.x[p] + i)), _mm_mul_ps(normalY[p], _mm_loadu_ps(corners.y[p] + i))),
+						_mm_add_ps(_mm_mul_ps(normalZ[p], _mm_loadu_ps(corners.z[p] + i)), distance[p]));
+					visible = _mm_and_ps(visible, _mm_cmpge_ps(planeDistance, _mm_setzero_ps()));
+				}
+				visibleCount += storeMask(visibility + i, static_cast<uint32_t>(_mm_movemask_ps(visible)), 4);
+			}
+			return visibleCount + cullBoxesScalar(planes, corners, visibility, i, end);
+		}
+
+		ENGINE_TARGET_AVX2 size_t cullSpheresAVX2(const PlaneSet& planes, const BoundingSpheres& spheres, uint8_t* visibility, size_t begin, size_t end)
+		{
+			__m256 normalX[Frustum::PlaneCount], normalY[Frustum::PlaneCount], normalZ[Frustum::PlaneCount], distance[Frustum::PlaneCount];
+			for (uint32_t p = 0; p < Frustum::PlaneCount; p++)
+			{
+				normalX[p] = _mm256_set1_ps(planes.normalX[p]);
+				normalY[p] = _mm256_set1_ps(planes.normalY[p]);
+				normalZ[p] = _mm256_set1_ps(planes.normalZ[p]);
+				distance[p] = _mm256_set1_ps(planes.distance[p]);
+			}
+
+			size_t visibleCount = 0;
+			size_t i = begin;
+			for (; i + 8 <= end; i += 8)
+			{
+				__m256 centerX = _mm256_loadu_ps(spheres.centerX.data() + i);
+				__m256 centerY = _mm256_loadu_ps(spheres.centerY.data() + i);
+				__m256 centerZ = _mm256_loadu_ps(spheres.centerZ.data() + i);
+				__m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(spheres.radius.data() + i));
+
+				__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+				for (uint32_t p = 0; p < Frustum::PlaneCount; p++)
+				{
+					__m256 planeDistance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(normalX[p], centerX), _mm256_mul_ps(normalY[p], centerY)),
+						_mm256_add_ps(_mm256_mul_ps(normalZ[p], centerZ), distance[p]));
+					visible = _mm256_and_ps(visible, _mm256_cmp_ps(planeDistance, negativeRadius, _CMP_GE_OQ));
+				}
+				visibleCount += storeMask(visibility + i, static_cast<uint32_t>(_mm256_movemask_ps(visible)), 8);
+			}
+			return visibleCount + cullSpheresScalar(planes, spheres, visibility, i, end);
+		}
+
+		ENGINE_TARGET_AVX2 size_t cullBoxesAVX2(const PlaneSet& planes, const BoxCorners& corners, uint8_t* visibility, size_t begin, size_t end)
+		{
+			__m256 normalX[Frustum::PlaneCount], normalY[Frustum::PlaneCount], normalZ[Frustum::PlaneCount], distance[Frustum::PlaneCount];
+			for (uint32_t p = 0; p < Frustum::PlaneCount; p++)
+			{
+				normalX[p] = _mm256_set1_ps(planes.normalX[p]);
+				normalY[p] = _mm256_set1_ps(planes.normalY[p]);
+				normalZ[p] = _mm256_set1_ps(planes.normalZ[p]);
+				distance[p] = _mm256_set1_ps(planes.distance[p]);
+			}
+
+			size_t visibleCount = 0;
+			size_t i = begin;
+			for (; i + 8 <= end; i += 8)
+			{
+				__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+				for (uint32_t p = 0; p < Frustum::PlaneCount; p++)
+				{
+					__m256 planeDistance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(normalX[p], _mm256_loadu_ps(corners.x[p] + i)), _mm256_mul_ps(normalY[p], _mm256_loadu_ps(corners.y[p] + i))),
+						_mm256_add_ps(_mm256_mul_ps(normalZ[p], _mm256_loadu_ps(corners.z[p] + i)), distance[p]));
+					visible = _mm256_and_ps(visible, _mm256_cmp_ps(planeDistance, _mm256_setzero_ps(), _CMP_GE_OQ));
+				}
+				visibleCount += storeMask(visibility + i, static_cast<uint32_t>(_mm256_movemask_ps(visible)), 8);
+			}
+			return visibleCount + cullBoxesScalar(planes, corners, visibility, i, end);
+		}
+#endif
+
+		SphereKernel getSphereKernel(FrustumCuller::SimdLevel level)
+		{
+#if ENGINE_CULL_X86
+			switch (level)
+			{
+			case FrustumCuller::SimdLevel::AVX2: return cullSpheresAVX2;
+			case FrustumCuller::SimdLevel::SSE: return cullSpheresSSE;
+			default: break;
+			}
+#endif
+			return cullSpheresScalar;
+		}
+
+		BoxKernel getBoxKernel(FrustumCuller::SimdLevel level)
+		{
+#if ENGINE_CULL_X86
+			switch (level)
+			{
+			case FrustumCuller::SimdLevel::AVX2: return cullBoxesAVX2;
+			case FrustumCuller::SimdLevel::SSE: return cullBoxesSSE;
+			default: break;
+			}
+#endif
+			return cullBoxesScalar;
+		}
+
+		FrustumCuller::SimdLevel detectSimdLevel()
+		{
+#if ENGINE_CULL_X86
+	#if defined(_MSC_VER)
+			// AVX2 needs the CPU bits and the OS saving the YMM registers
+			int info[4];
+			__cpuid(info, 1);
+			bool osxsave = info[2] & (1 << 27);
+			bool avx = info[2] & (1 << 28);
+			if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+				return FrustumCuller::SimdLevel::SSE;
+
+			__cpuidex(info, 7, 0);
+			return info[1] & (1 << 5) ? FrustumCuller::SimdLevel::AVX2 : FrustumCuller::SimdLevel::SSE;
+	#else
+			return __builtin_cpu_supports("avx2") ? FrustumCuller::SimdLevel::AVX2 : FrustumCuller::SimdLevel::SSE;
+	#endif
+#else
+			return FrustumCuller::SimdLevel::Scalar;
+#endif
+		}
+	}
+
+	void BoundingSpheres::add(const glm::vec3& center, float sphereRadius)
+	{
+		centerX.push_back(center.x);
+		centerY.push_back(center.y);
+		centerZ.push_back(center.z);
+		radius.push_back(sphereRadius);
+	}
+
+	void BoundingSpheres::clear()
+	{
+		centerX.clear();
+		centerY.clear();
+		centerZ.clear();
+		radius.clear();
+	}
+
+	void BoundingBoxes::add(const glm::vec3& min, const glm::vec3& max)
+	{
+		minX.push_back(min.x);
+		minY.push_back(min.y);
+		minZ.push_back(min.z);
+		maxX.push_back(max.x);
+		maxY.push_back(max.y);
+		maxZ.push_back(max.z);
+	}
+
+	void BoundingBoxes::clear()
+	{
+		minX.clear();
+		minY.clear();
+		minZ.clear();
+		maxX.clear();
+		maxY.clear();
+		maxZ.clear();
+	}
+
+	FrustumCuller::FrustumCuller(ThreadPool* threadPool, size_t chunkSize)
+		: m_ThreadPool(threadPool),
+		m_ChunkSize(chunkSize),
+		m_SimdLevel(getSupportedSimdLevel())
+	{
+		ENGINE_ASSERT(chunkSize > 0 && chunkSize % 8 == 0, "Culling chunk size must be a multiple of the widest SIMD width");
+	}
+
+	size_t FrustumCuller::cullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint8_t>& visibility) const
+	{
+		visibility.resize(spheres.size());
+
+		PlaneSet planes = toPlaneSet(frustum);
+		SphereKernel kernel = getSphereKernel(m_SimdLevel);
+		uint8_t* output = visibility.data();
+		return run(spheres.size(), [&](size_t begin, size_t end) { return kernel(planes, spheres, output, begin, end); });
+	}
+
+	size_t FrustumCuller::cullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<uint8_t>& visibility) const
+	{
+		visibility.resize(boxes.size());
+
+		PlaneSet planes = toPlaneSet(frustum);
+		BoxCorners corners = toBoxCorners(planes, boxes);
+		BoxKernel kernel = getBoxKernel(m_SimdLevel);
+		uint8_t* output = visibility.data();
+		return run(boxes.size(), [&](size_t begin, size_t end) { return kernel(planes, corners, output, begin, end); });
+	}
+
+	void FrustumCuller::setSimdLevel(SimdLevel level)
+	{
+		m_SimdLevel = std::min(level, getSupportedSimdLevel());
+	}
+
+	FrustumCuller::SimdLevel FrustumCuller::getSupportedSimdLevel()
+	{
+		static const SimdLevel supportedLevel = detectSimdLevel();
+		return supportedLevel;
+	}
+
+	const char* FrustumCuller::getSimdLevelName(SimdLevel level)
+	{
+		switch (level)
+		{
+		case SimdLevel::AVX2: return "AVX2";
+		case SimdLevel::SSE: return "SSE";
+		default: return "Scalar";
+		}
+	}
+
+	size_t FrustumCuller::run(size_t count, const std::function<size_t(size_t begin, size_t end)>& cullRange) const
+	{
+		if (!m_ThreadPool)
+			return cullRange(0, count);
+
+		std::atomic<size_t> visibleCount{ 0 };
+		m_ThreadPool->parallelFor(count, m_ChunkSize, [&](size_t begin, size_t end) { visibleCount += cullRange(begin, end); });
+		return visibleCount;
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Camera/Frustum.h"
+#include "Utility/ThreadPool.h"
+
+namespace vkEngine
+{
+	// World space bounding spheres in structure of arrays form, so a SIMD register loads the same component of consecutive objects
+	struct BoundingSpheres
+	{
+		std::vector<float> centerX{}, centerY{}, centerZ{}, radius{};
+
+		void add(const glm::vec3& center, float sphereRadius);
+		void clear();
+		size_t size() const { return radius.size(); }
+	};
+
+	// World space axis aligned boxes in structure of arrays form
+	struct BoundingBoxes
+	{
+		std::vector<float> minX{}, minY{}, minZ{}, maxX{}, maxY{}, maxZ{};
+
+		void add(const glm::vec3& min, const glm::vec3& max);
+		void clear();
+		size_t size() const { return minX.size(); }
+	};
+
+	// Tests bounding volumes against a frustum 8 (AVX2) or 4 (SSE) objects at a time, with a scalar path for other CPUs.
+	// Large sets are split into chunks run on the thread pool. Results are one byte per object, 1 when it intersects the frustum.
+	class FrustumCuller
+	{
+	public:
+		enum class SimdLevel : uint32_t { Scalar, SSE, AVX2 };
+
+		static constexpr size_t s_DefaultChunkSize = 16384; // Objects per task, a multiple of every SIMD width
+
+		// threadPool may be null, the tests then run on the calling thread
+		FrustumCuller(ThreadPool* threadPool = nullptr, size_t chunkSize = s_DefaultChunkSize);
+
+		// Returns the number of visible objects, visibility is resized to the object count
+		size_t cullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint8_t>& visibility) const;
+		size_t cullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<uint8_t>& visibility) const;
+
+		// Defaults to the best level of the CPU, lower levels can be forced for comparison
+		void setSimdLevel(SimdLevel level);
+		SimdLevel getSimdLevel() const { return m_SimdLevel; }
+
+		static SimdLevel getSupportedSimdLevel();
+		static const char* getSimdLevelName(SimdLevel level);
+
+	private:
+		size_t run(size_t count, const std::function<size_t(size_t begin, size_t end)>& cullRange) const;
+
+	private:
+		ThreadPool* m_ThreadPool = nullptr;
+		size_t m_ChunkSize = s_DefaultChunkSize;
+		SimdLevel m_SimdLevel = SimdLevel::Scalar;
+	};
+}
@@ -0,0 +1,406 @@
+#include "pch.h"
+#include "OcclusionRasterizer.h"
+
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__)
+	#define ENGINE_OCCLUSION_X86 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#define ENGINE_TARGET_AVX2
+	#else
+		#define ENGINE_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#else
+	#define ENGINE_OCCLUSION_X86 0
+#endif
+
+namespace vkEngine
+{
+	namespace
+	{
+		constexpr uint32_t TILE_PIXELS = OcclusionRasterizer::s_TileWidth * OcclusionRasterizer::s_TileHeight;
+		constexpr float CLEAR_DEPTH = 1.0f;
+		constexpr float MIN_CLIP_W = 1e-5f; // Vertices closer to the camera plane are treated as crossing the near plane
+		constexpr float MIN_TRIANGLE_AREA = 1e-6f; // In pixels, smaller triangles cover no pixel center
+
+		// Part of a triangle's pixel bounds inside one tile
+		struct PixelRect
+		{
+			int32_t minX, minY, maxX, maxY;
+		};
+
+		// Draws a triangle into one tile, tileDepth points at the tile's first pixel at (tileX, tileY)
+		using TriangleKernel = void(*)(const OcclusionTriangle&, float*, int32_t, int32_t, const PixelRect&);
+
+		// Every path evaluates the planes as a * x + (b * y + c) without FMA, so all of them write identical depths
+		void rasterizeScalar(const OcclusionTriangle& triangle, float* tileDepth, int32_t tileX, int32_t tileY, const PixelRect& rect)
+		{
+			for (int32_t y = rect.minY; y <= rect.maxY; y++)
+			{
+				float pixelY = static_cast<float>(y) + 0.5f;
+				float row0 = triangle.edgeB[0] * pixelY + triangle.edgeC[0];
+				float row1 = triangle.edgeB[1] * pixelY + triangle.edgeC[1];
+				float row2 = triangle.edgeB[2] * pixelY + triangle.edgeC[2];
+				float rowDepth = triangle.depthB * pixelY + triangle.depthC;
+				float* depthRow = tileDepth + (y - tileY) * static_cast<int32_t>(OcclusionRasterizer::s_TileWidth) - tileX;
+
+				for (int32_t x = rect.minX; x <= rect.maxX; x++)
+				{
+					float pixelX = static_cast<float>(x) + 0.5f;
+					bool inside = triangle.edgeA[0] * pixelX + row0 >= 0.0f && triangle.edgeA[1] * pixelX + row1 >= 0.0f && triangle.edgeA[2] * pixelX + row2 >= 0.0f;
+					float depth = triangle.depthA * pixelX + rowDepth;
+					if (inside && !(depthRow[x] < depth))
+						depthRow[x] = depth;
+				}
+			}
+		}
+
+#if ENGINE_OCCLUSION_X86
+		void rasterizeSSE(const OcclusionTriangle& triangle, float* tileDepth, int32_t tileX, int32_t tileY, const PixelRect& rect)
+		{
+			__m128 laneOffset = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+			__m128 edgeA0 = _mm_set1_ps(triangle.edgeA[0]), edgeA1 = _mm_set1_ps(triangle.edgeA[1]), edgeA2 = _mm_set1_ps(triangle.edgeA[2]);
+			__m128 depthA = _mm_set1_ps(triangle.depthA);
+			__m128 rectMinX = _mm_set1_ps(static_cast<float>(rect.minX) + 0.5f), rectMaxX = _mm_set1_ps(static_cast<float>(rect.maxX) + 0.5f);
+			__m128 zero = _mm_setzero_ps();
+
+			// Rows start at a SIMD aligned pixel, lanes left of the rectangle are masked out
+			int32_t startX = rect.minX & ~3;
+			for (int32_t y = rect.minY; y <= rect.maxY; y++)
+			{
+				float pixelY = static_cast<float>(y) + 0.5f;
+				__m128 row0 = _mm_set1_ps(triangle.edgeB[0] * pixelY + triangle.edgeC[0]);
+				__m128 row1 = _mm_set1_ps(triangle.edgeB[1] * pixelY + triangle.edgeC[1]);
+				__m128 row2 = _mm_set1_ps(triangle.edgeB[2] * pixelY + triangle.edgeC[2]);
+				__m128 rowDepth = _mm_set1_ps(triangle.depthB * pixelY + triangle.depthC);
+				float* depthRow = tileDepth + (y - tileY) * static_cast<int32_t>(OcclusionRasterizer::s_TileWidth) - tileX;
+
+				for (int32_t x = startX; x <= rect.maxX; x += 4)
+				{
+					__m128 pixelX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffset);
+					__m128 inside = _mm_and_ps(_mm_cmpge_ps(pixelX, rectMinX), _mm_cmple_ps(pixelX, rectMaxX));
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA0, pixelX), row0), zero));
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA1, pixelX), row1), zero));
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA2, pixelX), row2), zero));
+
+					__m128 depth = _mm_add_ps(_mm_mul_ps(depthA, pixelX), rowDepth);
+					__m128 previous = _mm_loadu_ps(depthRow + x);
+					__m128 nearest = _mm_min_ps(previous, depth);
+					_mm_storeu_ps(depthRow + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, previous)));
+				}
+			}
+		}
+
+		ENGINE_TARGET_AVX2 void rasterizeAVX2(const OcclusionTriangle& triangle, float* tileDepth, int32_t tileX, int32_t tileY, const PixelRect& rect)
+		{
+			__m256 laneOffset = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+			__m256 edgeA0 = _mm256_set1_ps(triangle.edgeA[0]), edgeA1 = _mm256_set1_ps(triangle.edgeA[1]), edgeA2 = _mm256_set1_ps(triangle.edgeA[2]);
+			__m256 depthA = _mm256_set1_ps(triangle.depthA);
+			__m256 rectMinX = _mm256_set1_ps(static_cast<float>(rect.minX) + 0.5f), rectMaxX = _mm256_set1_ps(static_cast<float>(rect.maxX) + 0.5f);
+			__m256 zero = _mm256_setzero_ps();
+
+			int32_t startX = rect.minX & ~7;
+			for (int32_t y = rect.minY; y <= rect.maxY; y++)
+			{
+				float pixelY = static_cast<float>(y) + 0.5f;
+				__m256 row0 = _mm256_set1_ps(triangle.edgeB[0] * pixelY + triangle.edgeC[0]);
+				__m256 row1 = _mm256_set1_ps(triangle.edgeB[1] * pixelY + triangle.edgeC[1]);
+				__m256 row2 = _mm256_set1_ps(triangle.edgeB[2] * pixelY + triangle.edgeC[2]);
+				__m256 rowDepth = _mm256_set1_ps(triangle.depthB * pixelY + triangle.depthC);
+				float* depthRow = tileDepth + (y - tileY) * static_cast<int32_t>(OcclusionRasterizer::s_TileWidth) - tileX;
+
+				for (int32_t x = startX; x <= rect.maxX; x += 8)
+				{
+					__m256 pixelX = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), laneOffset);
+					__m256 inside = _mm256_and_ps(_mm256_cmp_ps(pixelX, rectMinX, _CMP_GE_OQ), _mm256_cmp_ps(pixelX, rectMaxX, _CMP_LE_OQ));
+					inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(edgeA0, pixelX), row0), zero, _CMP_GE_OQ));
+					inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(edgeA1, pixelX), row1), zero, _CMP_GE_OQ));
+					inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(edgeA2, pixelX), row2), zero, _CMP_GE_OQ));
+
+					__m256 depth = _mm256_add_ps(_mm256_mul_ps(depthA, pixelX), rowDepth);
+					__m256 previous = _mm256_loadu_ps(depthRow + x);
+					_mm256_storeu_ps(depthRow + x, _mm256_blendv_ps(previous, _mm256_min_ps(previous, depth), inside));
+				}
+			}
+		}
+#endif
+
+		TriangleKernel getTriangleKernel(OcclusionRasterizer::SimdLevel level)
+		{
+#if ENGINE_OCCLUSION_X86
+			switch (level)
+			{
+			case OcclusionRasterizer::SimdLevel::AVX2: return rasterizeAVX2;
+			case OcclusionRasterizer::SimdLevel::SSE: return rasterizeSSE;
+			default: break;
+			}
+#endif
+			return rasterizeScalar;
+		}
+
+		// Pixel coordinates with y growing downwards like the framebuffer, depth as the GPU writes it
+		glm::vec3 toScreen(const glm::vec4& clip, float width, float height)
+		{
+			return { (clip.x / clip.w * 0.5f + 0.5f) * width, (clip.y / clip.w * 0.5f + 0.5f) * height, clip.z / clip.w };
+		}
+	}
+
+	OcclusionRasterizer::OcclusionRasterizer(ThreadPool* threadPool, uint32_t width, uint32_t height)
+		: m_ThreadPool(threadPool),
+		m_SimdLevel(FrustumCuller::getSupportedSimdLevel())
+	{
+		ENGINE_ASSERT(width > 0 && height > 0, "Occlusion buffer size must not be zero");
+
+		m_TilesX = (width + s_TileWidth - 1) / s_TileWidth;
+		m_TilesY = (height + s_TileHeight - 1) / s_TileHeight;
+		m_Width = m_TilesX * s_TileWidth;
+		m_Height = m_TilesY * s_TileHeight;
+
+		uint32_t tileCount = m_TilesX * m_TilesY;
+		m_Bins.resize(tileCount);
+		m_Depth.assign(static_cast<size_t>(tileCount) * TILE_PIXELS, CLEAR_DEPTH);
+		m_TileMaxDepth.assign(tileCount, CLEAR_DEPTH);
+	}
+
+	void OcclusionRasterizer::begin(const glm::mat4& viewProjection)
+	{
+		m_ViewProjection = viewProjection;
+		m_Occluders.clear();
+		m_TriangleCount = 0;
+	}
+
+	void OcclusionRasterizer::addOccluder(const OccluderMesh& mesh, const glm::mat4& model)
+	{
+		m_Occluders.push_back({ &mesh, model, m_TriangleCount });
+		m_TriangleCount += mesh.getTriangleCount();
+	}
+
+	size_t OcclusionRasterizer::rasterize()
+	{
+		// Occluders fill disjoint ranges of the triangle list and tiles disjoint parts of the buffer, neither needs locking
+		m_Triangles.resize(m_TriangleCount);
+		run(m_Occluders.size(), 1, [this](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					setupTriangles(m_Occluders[i]);
+				}
+			});
+
+		size_t binnedCount = binTriangles();
+
+		run(m_Bins.size(), 1, [this](size_t begin, size_t end)
+			{
+				for (size_t tile = begin; tile < end; tile++)
+				{
+					rasterizeTile(static_cast<uint32_t>(tile));
+				}
+			});
+
+		return binnedCount;
+	}
+
+	void OcclusionRasterizer::setupTriangles(const Occluder& occluder)
+	{
+		const OccluderMesh& mesh = *occluder.mesh;
+		glm::mat4 transform = m_ViewProjection * occluder.model;
+		float width = static_cast<float>(m_Width), height = static_cast<float>(m_Height);
+
+		for (uint32_t t = 0; t < mesh.getTriangleCount(); t++)
+		{
+			OcclusionTriangle& triangle = m_Triangles[occluder.firstTriangle + t];
+			triangle.minX = triangle.minY = 0;
+			triangle.maxX = triangle.maxY = -1;
+
+			glm::vec3 screen[3];
+			bool crossesNear = false;
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				glm::vec4 clip = transform * glm::vec4(mesh.vertices[mesh.indices[t * 3 + k]], 1.0f);
+				crossesNear |= clip.w < MIN_CLIP_W || clip.z < 0.0f;
+				screen[k] = toScreen(clip, width, height);
+			}
+			if (crossesNear)
+				continue;
+
+			// Both facings are drawn, the vertices are ordered so the inside is where every edge function is positive
+			float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+			if (std::abs(area) < MIN_TRIANGLE_AREA)
+				continue;
+			if (area < 0.0f)
+			{
+				std::swap(screen[1], screen[2]);
+				area = -area;
+			}
+
+			// Pixels whose centers fall within the triangle's bounds
+			float minX = std::min({ screen[0].x, screen[1].x, screen[2].x }), maxX = std::max({ screen[0].x, screen[1].x, screen[2].x });
+			float minY = std::min({ screen[0].y, screen[1].y, screen[2].y }), maxY = std::max({ screen[0].y, screen[1].y, screen[2].y });
+			triangle.minX = std::max(static_cast<int32_t>(std::ceil(minX - 0.5f)), 0);
+			triangle.minY = std::max(static_cast<int32_t>(std::ceil(minY - 0.5f)), 0);
+			triangle.maxX = std::min(static_cast<int32_t>(std::floor(maxX - 0.5f)), static_cast<int32_t>(m_Width) - 1);
+			triangle.maxY = std::min(static_cast<int32_t>(std::floor(maxY - 0.5f)), static_cast<int32_t>(m_Height) - 1);
+
+			for (uint32_t edge = 0; edge < 3; edge++)
+			{
+				const glm::vec3& from = screen[edge];
+				const glm::vec3& to = screen[(edge + 1) % 3];
+				triangle.edgeA[edge] = from.y - to.y;
+				triangle.edgeB[edge] = to.x - from.x;
+				triangle.edgeC[edge] = from.x * to.y - to.x * from.y;
+			}
+
+			// Depth is affine in screen space after the perspective divide
+			glm::vec3 edge1 = screen[1] - screen[0], edge2 = screen[2] - screen[0];
+			triangle.depthA = (edge1.z * edge2.y - edge2.z * edge1.y) / area;
+			triangle.depthB = (edge1.x * edge2.z - edge2.x * edge1.z) / area;
+			triangle.depthC = screen[0].z - triangle.depthA * screen[0].x - triangle.depthB * screen[0].y;
+		}
+	}
+
+	size_t OcclusionRasterizer::binTriangles()
+	{
+		for (std::vector<uint32_t>& bin : m_Bins)
+		{
+			bin.clear();
+		}
+
+		size_t binnedCount = 0;
+		for (uint32_t t = 0; t < static_cast<uint32_t>(m_Triangles.size()); t++)
+		{
+			const OcclusionTriangle& triangle = m_Triangles[t];
+			if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+				continue;
+
+			for (uint32_t tileY = triangle.minY / s_TileHeight; tileY <= triangle.maxY / s_TileHeight; tileY++)
+			{
+				for (uint32_t tileX = triangle.minX / s_TileWidth; tileX <= triangle.maxX / s_TileWidth; tileX++)
+				{
+					m_Bins[tileY * m_TilesX + tileX].push_back(t);
+				}
+			}
+			binnedCount++;
+		}
+		return binnedCount;
+	}
+
+	void OcclusionRasterizer::rasterizeTile(uint32_t tile)
+	{
+		float* tileDepth = m_Depth.data() + static_cast<size_t>(tile) * TILE_PIXELS;
+		std::fill(tileDepth, tileDepth + TILE_PIXELS, CLEAR_DEPTH);
+
+		int32_t tileX = static_cast<int32_t>((tile % m_TilesX) * s_TileWidth);
+		int32_t tileY = static_cast<int32_t>((tile / m_TilesX) * s_TileHeight);
+		TriangleKernel kernel = getTriangleKernel(m_SimdLevel);
+		for (uint32_t t : m_Bins[tile])
+		{
+			const OcclusionTriangle& triangle = m_Triangles[t];
+			PixelRect rect{
+				std::max(triangle.minX, tileX), std::max(triangle.minY, tileY),
+				std::min(triangle.maxX, tileX + static_cast<int32_t>(s_TileWidth) - 1), std::min(triangle.maxY, tileY + static_cast<int32_t>(s_TileHeight) - 1) };
+			kernel(triangle, tileDepth, tileX, tileY, rect);
+		}
+
+		m_TileMaxDepth[tile] = *std::max_element(tileDepth, tileDepth + TILE_PIXELS);
+	}
+
+	bool OcclusionRasterizer::isVisible(const BoundingBox& box) const
+	{
+		float width = static_cast<float>(m_Width), height = static_cast<float>(m_Height);
+		glm::vec2 minPixel{ FLT_MAX }, maxPixel{ -FLT_MAX };
+		float nearestDepth = FLT_MAX;
+		for (uint32_t corner = 0; corner < 8; corner++)
+		{
+			glm::vec3 point{ corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y, corner & 4 ? box.max.z : box.min.z };
+			glm::vec4 clip = m_ViewProjection * glm::vec4(point, 1.0f);
+			if (clip.w < MIN_CLIP_W || clip.z < 0.0f)
+				return true;
+
+			glm::vec3 screen = toScreen(clip, width, height);
+			minPixel = glm::min(minPixel, glm::vec2(screen));
+			maxPixel = glm::max(maxPixel, glm::vec2(screen));
+			nearestDepth = std::min(nearestDepth, screen.z);
+		}
+
+		// Every pixel the box's rectangle touches, not only those whose centers it covers
+		int32_t minX = std::max(static_cast<int32_t>(std::floor(minPixel.x)), 0);
+		int32_t minY = std::max(static_cast<int32_t>(std::floor(minPixel.y)), 0);
+		int32_t maxX = std::min(static_cast<int32_t>(std::floor(maxPixel.x)), static_cast<int32_t>(m_Width) - 1);
+		int32_t maxY = std::min(static_cast<int32_t>(std::floor(maxPixel.y)), static_cast<int32_t>(m_Height) - 1);
+		if (minX > maxX || minY > maxY)
+			return false;
+
+		return isRectVisible(minX, minY, maxX, maxY, nearestDepth);
+	}
+
+	bool OcclusionRasterizer::isRectVisible(int32_t minX, int32_t minY, int32_t maxX, int32_t maxY, float nearestDepth) const
+	{
+		for (int32_t tileRow = minY / static_cast<int32_t>(s_TileHeight); tileRow <= maxY / static_cast<int32_t>(s_TileHeight); tileRow++)
+		{
+			for (int32_t tileColumn = minX / static_cast<int32_t>(s_TileWidth); tileColumn <= maxX / static_cast<int32_t>(s_TileWidth); tileColumn++)
+			{
+				// Tiles whose farthest depth is nearer than the box hide their part of it without looking at pixels
+				uint32_t tile = static_cast<uint32_t>(tileRow) * m_TilesX + static_cast<uint32_t>(tileColumn);
+				if (m_TileMaxDepth[tile] < nearestDepth)
+					continue;
+
+				int32_t tileX = tileColumn * static_cast<int32_t>(s_TileWidth), tileY = tileRow * static_cast<int32_t>(s_TileHeight);
+				const float* tileDepth = m_Depth.data() + static_cast<size_t>(tile) * TILE_PIXELS;
+				for (int32_t y = std::max(minY, tileY); y <= std::min(maxY, tileY + static_cast<int32_t>(s_TileHeight) - 1); y++)
+				{
+					const float* depthRow = tileDepth + (y - tileY) * static_cast<int32_t>(s_TileWidth) - tileX;
+					for (int32_t x = std::max(minX, tileX); x <= std::min(maxX, tileX + static_cast<int32_t>(s_TileWidth) - 1); x++)
+					{
+						if (depthRow[x] >= nearestDepth)
+							return true;
+					}
+				}
+			}
+		}
+		return false;
+	}
+
+	size_t OcclusionRasterizer::testBoxes(const std::vector<BoundingBox>& boxes, std::vector<uint8_t>& visibility) const
+	{
+		visibility.resize(boxes.size());
+
+		std::atomic<size_t> visibleCount{ 0 };
+		run(boxes.size(), s_TestChunkSize, [&](size_t begin, size_t end)
+			{
+				size_t rangeVisible = 0;
+				for (size_t i = begin; i < end; i++)
+				{
+					bool visible = isVisible(boxes[i]);
+					visibility[i] = visible ? 1 : 0;
+					rangeVisible += visible ? 1 : 0;
+				}
+				visibleCount += rangeVisible;
+			});
+		return visibleCount;
+	}
+
+	void OcclusionRasterizer::setSimdLevel(SimdLevel level)
+	{
+		m_SimdLevel = std::min(level, FrustumCuller::getSupportedSimdLevel());
+	}
+
+	float OcclusionRasterizer::getDepth(uint32_t x, uint32_t y) const
+	{
+		ENGINE_ASSERT(x < m_Width && y < m_Height, "Occlusion buffer pixel (%u, %u) is out of bounds", x, y);
+		uint32_t tile = (y / s_TileHeight) * m_TilesX + x / s_TileWidth;
+		return m_Depth[static_cast<size_t>(tile) * TILE_PIXELS + (y % s_TileHeight) * s_TileWidth + x % s_TileWidth];
+	}
+
+	void OcclusionRasterizer::run(size_t count, size_t chunkSize, const ThreadPool::ChunkTask& task) const
+	{
+		if (count == 0)
+			return;
+		if (!m_ThreadPool)
+			task(0, count);
+		else
+			m_ThreadPool->parallelFor(count, chunkSize, task);
+	}
+}
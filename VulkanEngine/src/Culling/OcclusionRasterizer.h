@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Culling/BoundingBox.h"
+#include "Culling/FrustumCuller.h"
+#include "Utility/ThreadPool.h"
+
+namespace vkEngine
+{
+	// Low polygon stand in for the geometry of an occluder, mesh space positions and triangle list indices
+	struct OccluderMesh
+	{
+		std::vector<glm::vec3> vertices{};
+		std::vector<uint32_t> indices{};
+
+		uint32_t getTriangleCount() const { return static_cast<uint32_t>(indices.size() / 3); }
+	};
+
+	// Triangle ready for rasterization, edge and depth planes are evaluated at pixel centers as a * x + (b * y + c)
+	struct OcclusionTriangle
+	{
+		float edgeA[3], edgeB[3], edgeC[3];
+		float depthA, depthB, depthC;
+		int32_t minX, minY, maxX, maxY; // Inclusive pixel bounds, clamped to the buffer
+	};
+
+	// CPU depth buffer for occlusion culling where GPU driven culling is unavailable. Occluders are rasterized into a small
+	// buffer split into tiles, one thread pool task per tile, rows of 8 (AVX2) or 4 (SSE) pixels at a time. Bounding boxes are
+	// then tested against the farthest depth of every tile and, where that is not enough, against the pixels they cover.
+	// Depth follows the GPU, 0 at the near plane and nearer wins. Triangles crossing the near plane are dropped, which only
+	// ever hides less. Like any low resolution occlusion buffer, objects peeking past an occluder's silhouette by less than
+	// one of its pixels may be reported hidden.
+	class OcclusionRasterizer
+	{
+	public:
+		using SimdLevel = FrustumCuller::SimdLevel;
+
+		static constexpr uint32_t s_TileWidth = 32; // A multiple of every SIMD width
+		static constexpr uint32_t s_TileHeight = 8;
+		static constexpr uint32_t s_DefaultWidth = 320;
+		static constexpr uint32_t s_DefaultHeight = 192;
+		static constexpr size_t s_TestChunkSize = 1024; // Boxes per task
+
+		// threadPool may be null, everything then runs on the calling thread. The size is rounded up to whole tiles
+		OcclusionRasterizer(ThreadPool* threadPool = nullptr, uint32_t width = s_DefaultWidth, uint32_t height = s_DefaultHeight);
+
+		// Starts a frame, the occluders of the previous one are forgotten
+		void begin(const glm::mat4& viewProjection);
+		// The mesh is only referenced and must stay alive until rasterize
+		void addOccluder(const OccluderMesh& mesh, const glm::mat4& model);
+		// Clears the buffer and draws every added occluder. Returns the number of triangles that reached the tiles
+		size_t rasterize();
+
+		// Whether any part of the box may be visible, boxes crossing the near plane always are
+		bool isVisible(const BoundingBox& box) const;
+		// Returns the number of possibly visible boxes, visibility is resized to the box count and holds 1 for those
+		size_t testBoxes(const std::vector<BoundingBox>& boxes, std::vector<uint8_t>& visibility) const;
+
+		// Defaults to the best level of the CPU, lower levels can be forced for comparison
+		void setSimdLevel(SimdLevel level);
+		SimdLevel getSimdLevel() const { return m_SimdLevel; }
+
+		uint32_t getWidth() const { return m_Width; }
+		uint32_t getHeight() const { return m_Height; }
+		float getDepth(uint32_t x, uint32_t y) const;
+		// Tile after tile, every tile row by row
+		const std::vector<float>& getDepthBuffer() const { return m_Depth; }
+
+	private:
+		struct Occluder
+		{
+			const OccluderMesh* mesh;
+			glm::mat4 model;
+			size_t firstTriangle;
+		};
+
+		void setupTriangles(const Occluder& occluder);
+		size_t binTriangles(); // Returns the number of triangles covering any pixel
+		void rasterizeTile(uint32_t tile);
+		bool isRectVisible(int32_t minX, int32_t minY, int32_t maxX, int32_t maxY, float nearestDepth) const;
+		void run(size_t count, size_t chunkSize, const ThreadPool::ChunkTask& task) const;
+
+	private:
+		ThreadPool* m_ThreadPool = nullptr;
+		SimdLevel m_SimdLevel = SimdLevel::Scalar;
+		uint32_t m_Width = 0, m_Height = 0;
+		uint32_t m_TilesX = 0, m_TilesY = 0;
+
+		glm::mat4 m_ViewProjection{ 1.0f };
+		std::vector<Occluder> m_Occluders{};
+		size_t m_TriangleCount = 0;
+
+		std::vector<OcclusionTriangle> m_Triangles{}; // Per occluder triangle, culled ones have an empty rectangle
+		std::vector<std::vector<uint32_t>> m_Bins{}; // Per tile, the triangles overlapping it
+		std::vector<float> m_Depth{};
+		std::vector<float> m_TileMaxDepth{}; // Farthest depth of every tile
+	};
+}
@@ -0,0 +1,109 @@
+#include "pch.h"
+#include "BindlessRegistry.h"
+#include "VulkanContext.h"
+#include "CommandList.h"
+
+namespace vkEngine
+{
+	BindlessRegistry::BindlessRegistry(VkDevice device)
+		: m_Device(device)
+	{
+		ENGINE_ASSERT(VulkanContext::getPhysicalDevice()->getCapabilities().descriptorIndexing, "Bindless textures require descriptor indexing support");
+
+		// Same binding as the shader reflection produces, so the cache hands out the layout pipelines use
+		ReflectedBinding textures{};
+		textures.name = "textures";
+		textures.set = s_TextureSet;
+		textures.binding = s_TextureBinding;
+		textures.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		textures.count = 0;
+		textures.stageFlags = VK_SHADER_STAGE_ALL;
+
+		m_SetLayout = VulkanContext::getPipelineLayoutCache()->getSetLayout({ textures });
+
+		if (const Shared<DescriptorBuffer>& descriptorBuffer = VulkanContext::getDescriptorBuffer())
+		{
+			m_Handle.bufferOffset = descriptorBuffer->allocate(m_SetLayout);
+			return;
+		}
+
+		VkDescriptorPoolSize poolSize{};
+		poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		poolSize.descriptorCount = PipelineLayoutCache::s_RuntimeArrayCapacity;
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		poolInfo.maxSets = 1;
+
+		ENGINE_ASSERT(vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &m_DescriptorPool) == VK_SUCCESS, "Bindless descriptor pool creation failed");
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = m_DescriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &m_SetLayout;
+
+		ENGINE_ASSERT(vkAllocateDescriptorSets(m_Device, &allocInfo, &m_Handle.set) == VK_SUCCESS, "Bindless descriptor set allocation failed");
+	}
+
+	BindlessRegistry::~BindlessRegistry()
+	{
+		vkDestroyDescriptorPool(m_Device, m_DescriptorPool, nullptr);
+	}
+
+	uint32_t BindlessRegistry::registerTexture(const VkDescriptorImageInfo& imageInfo)
+	{
+		uint32_t index;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (!m_FreeIndices.empty())
+			{
+				index = m_FreeIndices.back();
+				m_FreeIndices.pop_back();
+			}
+			else
+			{
+				ENGINE_ASSERT(m_NextIndex < PipelineLayoutCache::s_RuntimeArrayCapacity, "Bindless texture table is full");
+				index = m_NextIndex++;
+			}
+		}
+
+		if (const Shared<DescriptorBuffer>& descriptorBuffer = VulkanContext::getDescriptorBuffer())
+		{
+			DescriptorData data{};
+			data.image = imageInfo;
+			descriptorBuffer->write(m_Handle.bufferOffset, m_SetLayout, s_TextureBinding, index, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, data);
+			return index;
+		}
+
+		VkWriteDescriptorSet descriptorWrite{};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = m_Handle.set;
+		descriptorWrite.dstBinding = s_TextureBinding;
+		descriptorWrite.dstArrayElement = index;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets(m_Device, 1, &descriptorWrite, 0, nullptr);
+		return index;
+	}
+
+	void BindlessRegistry::unregisterTexture(uint32_t index)
+	{
+		if (index == s_InvalidIndex)
+			return;
+
+		// The slot keeps its stale descriptor, partially bound arrays allow it as long as no shader reads it
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_FreeIndices.push_back(index);
+	}
+
+	void BindlessRegistry::bind(CommandList& commandList, VkPipelineBindPoint bindPoint, VkPipelineLayout layout) const
+	{
+		commandList.bindDescriptorSet(bindPoint, layout, s_TextureSet, m_Handle);
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "DescriptorBuffer.h"
+
+namespace vkEngine
+{
+	class CommandList;
+
+	// Global table of sampled textures, bound once per command buffer at set s_TextureSet.
+	// Shaders declare it as a runtime sized sampler2D array and select a texture with its index,
+	// switching textures costs no descriptor writes or set binds.
+	class BindlessRegistry
+	{
+	public:
+		static constexpr uint32_t s_TextureSet = 1;
+		static constexpr uint32_t s_TextureBinding = 0;
+		static constexpr uint32_t s_InvalidIndex = UINT32_MAX;
+
+		BindlessRegistry(VkDevice device);
+		~BindlessRegistry();
+
+		BindlessRegistry(const BindlessRegistry&) = delete;
+		BindlessRegistry& operator=(const BindlessRegistry&) = delete;
+
+		// Writes the texture into a free slot. The slot may be reused once the texture is unregistered,
+		// so unregister only after the frames that sampled it have completed.
+		uint32_t registerTexture(const VkDescriptorImageInfo& imageInfo);
+		void unregisterTexture(uint32_t index);
+
+		VkDescriptorSetLayout getSetLayout() const { return m_SetLayout; }
+		const DescriptorHandle& getHandle() const { return m_Handle; }
+		void bind(CommandList& commandList, VkPipelineBindPoint bindPoint, VkPipelineLayout layout) const;
+
+	private:
+		VkDevice m_Device = VK_NULL_HANDLE;
+		VkDescriptorSetLayout m_SetLayout = VK_NULL_HANDLE; // Owned by the pipeline layout cache
+		VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE; // Only used without the descriptor buffer backend
+		DescriptorHandle m_Handle{};
+
+		std::mutex m_Mutex;
+		std::vector<uint32_t> m_FreeIndices{};
+		uint32_t m_NextIndex = 0;
+	};
+}
@@ -0,0 +1,107 @@
+#include "pch.h"
+#include "DescriptorAllocator.h"
+
+namespace vkEngine
+{
+	DescriptorAllocator::DescriptorAllocator(VkDevice device, uint32_t initialSetsPerPool, const std::vector<DescriptorPoolRatio>& ratios)
+		: m_Device(device), m_Ratios(ratios), m_SetsPerPool(initialSetsPerPool)
+	{
+	}
+
+	DescriptorAllocator::~DescriptorAllocator()
+	{
+		for (VkDescriptorPool pool : m_ReadyPools)
+		{
+			vkDestroyDescriptorPool(m_Device, pool, nullptr);
+		}
+		for (VkDescriptorPool pool : m_FullPools)
+		{
+			vkDestroyDescriptorPool(m_Device, pool, nullptr);
+		}
+	}
+
+	const std::vector<DescriptorPoolRatio>& DescriptorAllocator::getDefaultRatios()
+	{
+		static const std::vector<DescriptorPoolRatio> ratios =
+		{
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.0f }
+		};
+		return ratios;
+	}
+
+	VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout)
+	{
+		VkDescriptorPool pool = getPool();
+
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = pool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &layout;
+
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		VkResult result = vkAllocateDescriptorSets(m_Device, &allocInfo, &descriptorSet);
+
+		// The pool is exhausted, retire it and retry once with a fresh one
+		if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+		{
+			m_FullPools.push_back(pool);
+			m_ReadyPools.pop_back();
+
+			allocInfo.descriptorPool = getPool();
+			result = vkAllocateDescriptorSets(m_Device, &allocInfo, &descriptorSet);
+		}
+
+		ENGINE_ASSERT(result == VK_SUCCESS, "Descriptor set allocation failed");
+		return descriptorSet;
+	}
+
+	void DescriptorAllocator::reset()
+	{
+		for (VkDescriptorPool pool : m_ReadyPools)
+		{
+			vkResetDescriptorPool(m_Device, pool, 0);
+		}
+		for (VkDescriptorPool pool : m_FullPools)
+		{
+			vkResetDescriptorPool(m_Device, pool, 0);
+			m_ReadyPools.push_back(pool);
+		}
+		m_FullPools.clear();
+	}
+
+	VkDescriptorPool DescriptorAllocator::getPool()
+	{
+		if (m_ReadyPools.empty())
+		{
+			m_ReadyPools.push_back(createPool(m_SetsPerPool));
+			m_SetsPerPool = std::min(m_SetsPerPool * 2, s_MaxSetsPerPool);
+		}
+		return m_ReadyPools.back();
+	}
+
+	VkDescriptorPool DescriptorAllocator::createPool(uint32_t setCount)
+	{
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		poolSizes.reserve(m_Ratios.size());
+		for (const DescriptorPoolRatio& ratio : m_Ratios)
+		{
+			poolSizes.push_back({ ratio.type, std::max(1u, static_cast<uint32_t>(ratio.ratio * setCount)) });
+		}
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+		poolInfo.pPoolSizes = poolSizes.data();
+		poolInfo.maxSets = setCount;
+
+		VkDescriptorPool pool = VK_NULL_HANDLE;
+		ENGINE_ASSERT(vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &pool) == VK_SUCCESS, "Descriptor pool creation failed");
+		return pool;
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vkEngine
+{
+	// Share of each descriptor type in a pool, multiplied by the number of sets the pool holds
+	struct DescriptorPoolRatio
+	{
+		VkDescriptorType type;
+		float ratio;
+	};
+
+	// Allocates descriptor sets of any layout from a chain of pools. When a pool runs out, a larger one is
+	// created and allocation retries, so callers never size pools by hand. reset() returns every set at once,
+	// which makes one allocator per frame in flight a cheap home for transient sets.
+	// Layouts created with UPDATE_AFTER_BIND_POOL need a dedicated pool and are not supported.
+	class DescriptorAllocator
+	{
+	public:
+		DescriptorAllocator(VkDevice device, uint32_t initialSetsPerPool = 64, const std::vector<DescriptorPoolRatio>& ratios = getDefaultRatios());
+		~DescriptorAllocator();
+
+		DescriptorAllocator(const DescriptorAllocator&) = delete;
+		DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+		VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+		void reset();
+
+		static const std::vector<DescriptorPoolRatio>& getDefaultRatios();
+
+	private:
+		VkDescriptorPool getPool();
+		VkDescriptorPool createPool(uint32_t setCount);
+
+	private:
+		static constexpr uint32_t s_MaxSetsPerPool = 4096;
+
+		VkDevice m_Device = VK_NULL_HANDLE;
+		std::vector<DescriptorPoolRatio> m_Ratios{};
+		uint32_t m_SetsPerPool = 0;
+
+		std::vector<VkDescriptorPool> m_ReadyPools{};
+		std::vector<VkDescriptorPool> m_FullPools{};
+	};
+}
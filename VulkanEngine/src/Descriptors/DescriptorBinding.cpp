@@ -0,0 +1,26 @@
+#include "pch.h"
+#include "DescriptorBinding.h"
+#include "VulkanContext.h"
+
+namespace vkEngine
+{
+	namespace DescriptorBinding
+	{
+		void beginCommandBuffer(VkCommandBuffer commandBuffer)
+		{
+			if (const Shared<DescriptorBuffer>& descriptorBuffer = VulkanContext::getDescriptorBuffer())
+				descriptorBuffer->bind(commandBuffer);
+		}
+
+		void bindSet(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set, const DescriptorHandle& handle)
+		{
+			if (const Shared<DescriptorBuffer>& descriptorBuffer = VulkanContext::getDescriptorBuffer())
+			{
+				descriptorBuffer->setOffset(commandBuffer, bindPoint, layout, set, handle.bufferOffset);
+				return;
+			}
+
+			vkCmdBindDescriptorSets(commandBuffer, bindPoint, layout, set, 1, &handle.set, 0, nullptr);
+		}
+	}
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "DescriptorBuffer.h"
+
+namespace vkEngine
+{
+	// Binding entry points shared by both descriptor backends, so recording code does not care
+	// whether sets come from pools or from the descriptor buffer.
+	namespace DescriptorBinding
+	{
+		// Call once right after vkBeginCommandBuffer, binds the descriptor buffer when that backend is active
+		void beginCommandBuffer(VkCommandBuffer commandBuffer);
+		void bindSet(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set, const DescriptorHandle& handle);
+	}
+}
@@ -0,0 +1,179 @@
+#include "pch.h"
+#include "DescriptorBuffer.h"
+#include "VulkanContext.h"
+#include "Utility/VulkanUtils.h"
+
+namespace vkEngine
+{
+	namespace
+	{
+		VkDeviceAddress getBufferAddress(VkDevice device, VkBuffer buffer)
+		{
+			VkBufferDeviceAddressInfo addressInfo{};
+			addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+			addressInfo.buffer = buffer;
+			return vkGetBufferDeviceAddress(device, &addressInfo);
+		}
+	}
+
+	DescriptorBuffer::DescriptorBuffer(VkDevice device, VkDeviceSize size)
+		: m_Device(device), m_Size(size)
+	{
+		ENGINE_ASSERT(VulkanContext::getPhysicalDevice()->getCapabilities().descriptorBuffer, "Descriptor buffer backend requires VK_EXT_descriptor_buffer");
+
+		// Combined image samplers embed a sampler, so the buffer holds both resource and sampler descriptors
+		m_Usage = VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = m_Size;
+		bufferInfo.usage = m_Usage;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		ENGINE_ASSERT(vkCreateBuffer(m_Device, &bufferInfo, nullptr, &m_Buffer) == VK_SUCCESS, "Descriptor buffer creation failed");
+
+		VkMemoryRequirements memRequirements;
+		vkGetBufferMemoryRequirements(m_Device, m_Buffer, &memRequirements);
+
+		VkMemoryAllocateFlagsInfo allocFlagsInfo{};
+		allocFlagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+		allocFlagsInfo.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.pNext = &allocFlagsInfo;
+		allocInfo.allocationSize = memRequirements.size;
+		allocInfo.memoryTypeIndex = VulkanUtils::findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+		ENGINE_ASSERT(vkAllocateMemory(m_Device, &allocInfo, nullptr, &m_Memory) == VK_SUCCESS, "Descriptor buffer memory allocation failed");
+		vkBindBufferMemory(m_Device, m_Buffer, m_Memory, 0);
+
+		void* mapped = nullptr;
+		vkMapMemory(m_Device, m_Memory, 0, m_Size, 0, &mapped);
+		m_Mapped = static_cast<uint8_t*>(mapped);
+		m_Address = getBufferAddress(m_Device, m_Buffer);
+	}
+
+	DescriptorBuffer::~DescriptorBuffer()
+	{
+		vkUnmapMemory(m_Device, m_Memory);
+		vkDestroyBuffer(m_Device, m_Buffer, nullptr);
+		vkFreeMemory(m_Device, m_Memory, nullptr);
+	}
+
+	VkDeviceSize DescriptorBuffer::allocate(VkDescriptorSetLayout layout)
+	{
+		VkDeviceSize alignment = VulkanContext::getPhysicalDevice()->getDescriptorBufferProperties().descriptorBufferOffsetAlignment;
+		VkDeviceSize layoutSize = getLayoutSize(layout);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		auto freeOffsets = m_FreeOffsets.find(layoutSize);
+		if (freeOffsets != m_FreeOffsets.end() && !freeOffsets->second.empty())
+		{
+			VkDeviceSize offset = freeOffsets->second.back();
+			freeOffsets->second.pop_back();
+			return offset;
+		}
+
+		VkDeviceSize offset = (m_Head + alignment - 1) / alignment * alignment;
+		ENGINE_ASSERT(offset + layoutSize <= m_Size, "Descriptor buffer is full, %llu bytes requested", static_cast<unsigned long long>(layoutSize));
+
+		m_Head = offset + layoutSize;
+		return offset;
+	}
+
+	void DescriptorBuffer::free(VkDeviceSize offset, VkDescriptorSetLayout layout)
+	{
+		VkDeviceSize layoutSize = getLayoutSize(layout);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_FreeOffsets[layoutSize].push_back(offset);
+	}
+
+	void DescriptorBuffer::write(VkDeviceSize setOffset, VkDescriptorSetLayout layout, uint32_t binding, uint32_t arrayElement, VkDescriptorType type, const DescriptorData& data)
+	{
+		const DeviceExtensionFunctions& functions = VulkanContext::getLogicalDevice()->getExtensionFunctions();
+
+		VkDeviceSize bindingOffset = 0;
+		functions.getDescriptorSetLayoutBindingOffset(m_Device, layout, binding, &bindingOffset);
+
+		VkDescriptorAddressInfoEXT addressInfo{};
+		addressInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT;
+
+		VkDescriptorGetInfoEXT getInfo{};
+		getInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT;
+		getInfo.type = type;
+		switch (type)
+		{
+		case VK_DESCRIPTOR_TYPE_SAMPLER:
+			getInfo.data.pSampler = &data.image.sampler;
+			break;
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+			getInfo.data.pCombinedImageSampler = &data.image;
+			break;
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+			getInfo.data.pSampledImage = &data.image;
+			break;
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+			getInfo.data.pStorageImage = &data.image;
+			break;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+			ENGINE_ASSERT(data.buffer.range != VK_WHOLE_SIZE, "Descriptor buffer writes need an explicit buffer range");
+			addressInfo.address = getBufferAddress(m_Device, data.buffer.buffer) + data.buffer.offset;
+			addressInfo.range = data.buffer.range;
+			if (type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+				getInfo.data.pUniformBuffer = &addressInfo;
+			else
+				getInfo.data.pStorageBuffer = &addressInfo;
+			break;
+		default:
+			ENGINE_ASSERT(false, "Descriptor type %d is not supported by the descriptor buffer backend", static_cast<int>(type));
+			return;
+		}
+
+		size_t descriptorSize = getDescriptorSize(type);
+		VkDeviceSize offset = setOffset + bindingOffset + arrayElement * descriptorSize;
+		ENGINE_ASSERT(offset + descriptorSize <= m_Size, "Descriptor write outside of the descriptor buffer");
+
+		functions.getDescriptor(m_Device, &getInfo, descriptorSize, m_Mapped + offset);
+	}
+
+	void DescriptorBuffer::bind(VkCommandBuffer commandBuffer) const
+	{
+		VkDescriptorBufferBindingInfoEXT bindingInfo{};
+		bindingInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT;
+		bindingInfo.address = m_Address;
+		bindingInfo.usage = m_Usage;
+
+		VulkanContext::getLogicalDevice()->getExtensionFunctions().cmdBindDescriptorBuffers(commandBuffer, 1, &bindingInfo);
+	}
+
+	void DescriptorBuffer::setOffset(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set, VkDeviceSize offset) const
+	{
+		uint32_t bufferIndex = 0;
+		VulkanContext::getLogicalDevice()->getExtensionFunctions().cmdSetDescriptorBufferOffsets(commandBuffer, bindPoint, layout, set, 1, &bufferIndex, &offset);
+	}
+
+	size_t DescriptorBuffer::getDescriptorSize(VkDescriptorType type) const
+	{
+		const VkPhysicalDeviceDescriptorBufferPropertiesEXT& properties = VulkanContext::getPhysicalDevice()->getDescriptorBufferProperties();
+		switch (type)
+		{
+		case VK_DESCRIPTOR_TYPE_SAMPLER: return properties.samplerDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: return properties.combinedImageSamplerDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE: return properties.sampledImageDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE: return properties.storageImageDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER: return properties.uniformBufferDescriptorSize;
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: return properties.storageBufferDescriptorSize;
+		default: return 0;
+		}
+	}
+
+	VkDeviceSize DescriptorBuffer::getLayoutSize(VkDescriptorSetLayout layout) const
+	{
+		VkDeviceSize layoutSize = 0;
+		VulkanContext::getLogicalDevice()->getExtensionFunctions().getDescriptorSetLayoutSize(m_Device, layout, &layoutSize);
+		return layoutSize;
+	}
+}
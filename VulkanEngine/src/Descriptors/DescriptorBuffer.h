@@ -0,0 +1,62 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "DescriptorUpdateTemplate.h"
+
+namespace vkEngine
+{
+	// Where the descriptors of one set live: a pool allocated set, or an offset into the descriptor buffer
+	struct DescriptorHandle
+	{
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		VkDeviceSize bufferOffset = 0;
+	};
+
+	// VK_EXT_descriptor_buffer backend. Descriptors are written with vkGetDescriptorEXT straight into one
+	// persistently mapped buffer, a set is just an offset bound with vkCmdSetDescriptorBufferOffsetsEXT.
+	// Space is handed out linearly. Freed sets keep their place and are handed out again to sets of the same size,
+	// so owners that recreate their sets with the same layouts, as on every resize, reuse the space instead of growing.
+	class DescriptorBuffer
+	{
+	public:
+		static constexpr VkDeviceSize s_DefaultSize = 4 * 1024 * 1024;
+
+		DescriptorBuffer(VkDevice device, VkDeviceSize size = s_DefaultSize);
+		~DescriptorBuffer();
+
+		DescriptorBuffer(const DescriptorBuffer&) = delete;
+		DescriptorBuffer& operator=(const DescriptorBuffer&) = delete;
+
+		// Reserves room for one set of the layout and returns its offset in the buffer
+		VkDeviceSize allocate(VkDescriptorSetLayout layout);
+		// Returns a set's space, the GPU must be done with it
+		void free(VkDeviceSize offset, VkDescriptorSetLayout layout);
+		// Buffer descriptors need an explicit range, VK_WHOLE_SIZE has no meaning for an address
+		void write(VkDeviceSize setOffset, VkDescriptorSetLayout layout, uint32_t binding, uint32_t arrayElement, VkDescriptorType type, const DescriptorData& data);
+
+		// Binds the buffer, once per command buffer before any set offsets are set
+		void bind(VkCommandBuffer commandBuffer) const;
+		void setOffset(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t set, VkDeviceSize offset) const;
+
+	private:
+		size_t getDescriptorSize(VkDescriptorType type) const;
+		VkDeviceSize getLayoutSize(VkDescriptorSetLayout layout) const;
+
+	private:
+		VkDevice m_Device = VK_NULL_HANDLE;
+		VkBuffer m_Buffer = VK_NULL_HANDLE;
+		VkDeviceMemory m_Memory = VK_NULL_HANDLE;
+		VkBufferUsageFlags m_Usage = 0;
+		VkDeviceAddress m_Address = 0;
+		uint8_t* m_Mapped = nullptr;
+		VkDeviceSize m_Size = 0;
+
+		std::mutex m_Mutex;
+		VkDeviceSize m_Head = 0;
+		std::unordered_map<VkDeviceSize, std::vector<VkDeviceSize>> m_FreeOffsets{}; // By set size
+	};
+}
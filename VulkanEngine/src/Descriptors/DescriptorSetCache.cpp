@@ -0,0 +1,189 @@
+#include "pch.h"
+#include "DescriptorSetCache.h"
+#include "VulkanContext.h"
+
+namespace vkEngine
+{
+	namespace
+	{
+		bool isImageDescriptor(VkDescriptorType type)
+		{
+			switch (type)
+			{
+			case VK_DESCRIPTOR_TYPE_SAMPLER:
+			case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+			case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+			case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+			case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		bool isTexelBufferDescriptor(VkDescriptorType type)
+		{
+			return type == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
+		}
+	}
+
+	DescriptorResource DescriptorResource::buffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+	{
+		DescriptorResource resource{};
+		resource.binding = binding;
+		resource.type = type;
+		resource.bufferInfo = { buffer, offset, range };
+		return resource;
+	}
+
+	DescriptorResource DescriptorResource::image(uint32_t binding, VkDescriptorType type, const VkDescriptorImageInfo& imageInfo)
+	{
+		DescriptorResource resource{};
+		resource.binding = binding;
+		resource.type = type;
+		resource.imageInfo = imageInfo;
+		return resource;
+	}
+
+	bool DescriptorResource::isImage() const
+	{
+		return isImageDescriptor(type);
+	}
+
+	DescriptorSetCache::DescriptorSetCache(VkDevice device)
+		: m_Device(device), m_Allocator(device)
+	{
+	}
+
+	DescriptorSetCache::~DescriptorSetCache()
+	{
+		clear();
+	}
+
+	DescriptorHandle DescriptorSetCache::getSet(VkDescriptorSetLayout layout, const std::vector<DescriptorResource>& resources)
+	{
+		std::vector<uint64_t> key;
+		key.reserve(1 + resources.size() * 5);
+		key.push_back(reinterpret_cast<uint64_t>(layout));
+		for (const DescriptorResource& resource : resources)
+		{
+			key.insert(key.end(), { resource.binding, static_cast<uint64_t>(resource.type) });
+			if (resource.isImage())
+			{
+				key.insert(key.end(), {
+					reinterpret_cast<uint64_t>(resource.imageInfo.imageView),
+					reinterpret_cast<uint64_t>(resource.imageInfo.sampler),
+					static_cast<uint64_t>(resource.imageInfo.imageLayout) });
+			}
+			else
+			{
+				key.insert(key.end(), { reinterpret_cast<uint64_t>(resource.bufferInfo.buffer), resource.bufferInfo.offset, resource.bufferInfo.range });
+			}
+		}
+
+		auto [it, inserted] = m_Sets.try_emplace(key, CachedSet{ {}, layout });
+		DescriptorHandle& handle = it->second.handle;
+		if (!inserted)
+			return handle;
+
+		if (const Shared<DescriptorBuffer>& descriptorBuffer = VulkanContext::getDescriptorBuffer())
+		{
+			handle.bufferOffset = descriptorBuffer->allocate(layout);
+			for (const DescriptorResource& resource : resources)
+			{
+				DescriptorData data{};
+				if (resource.isImage())
+					data.image = resource.imageInfo;
+				else
+					data.buffer = resource.bufferInfo;
+
+				descriptorBuffer->write(handle.bufferOffset, layout, resource.binding, 0, resource.type, data);
+			}
+			return handle;
+		}
+
+		handle.set = m_Allocator.allocate(layout);
+
+		std::vector<VkWriteDescriptorSet> descriptorWrites;
+		descriptorWrites.reserve(resources.size());
+		for (const DescriptorResource& resource : resources)
+		{
+			VkWriteDescriptorSet descriptorWrite{};
+			descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrite.dstSet = handle.set;
+			descriptorWrite.dstBinding = resource.binding;
+			descriptorWrite.dstArrayElement = 0;
+			descriptorWrite.descriptorType = resource.type;
+			descriptorWrite.descriptorCount = 1;
+			if (resource.isImage())
+				descriptorWrite.pImageInfo = &resource.imageInfo;
+			else
+				descriptorWrite.pBufferInfo = &resource.bufferInfo;
+
+			descriptorWrites.push_back(descriptorWrite);
+		}
+
+		vkUpdateDescriptorSets(m_Device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+		return handle;
+	}
+
+	DescriptorHandle DescriptorSetCache::getSet(const DescriptorUpdateTemplate& updateTemplate, const std::vector<DescriptorData>& data)
+	{
+		std::vector<uint64_t> key;
+		key.reserve(2 + data.size() * 3);
+		key.push_back(reinterpret_cast<uint64_t>(updateTemplate.getLayout()));
+		key.push_back(UINT64_MAX); // Keeps template keys apart from resource list keys of the same layout
+		for (const VkDescriptorUpdateTemplateEntry& entry : updateTemplate.getEntries())
+		{
+			uint32_t firstSlot = static_cast<uint32_t>(entry.offset / sizeof(DescriptorData));
+			for (uint32_t slot = firstSlot; slot < firstSlot + entry.descriptorCount; slot++)
+			{
+				const DescriptorData& descriptor = data[slot];
+				if (isImageDescriptor(entry.descriptorType))
+				{
+					key.insert(key.end(), {
+						reinterpret_cast<uint64_t>(descriptor.image.imageView),
+						reinterpret_cast<uint64_t>(descriptor.image.sampler),
+						static_cast<uint64_t>(descriptor.image.imageLayout) });
+				}
+				else if (isTexelBufferDescriptor(entry.descriptorType))
+				{
+					key.push_back(reinterpret_cast<uint64_t>(descriptor.texelBuffer));
+				}
+				else
+				{
+					key.insert(key.end(), { reinterpret_cast<uint64_t>(descriptor.buffer.buffer), descriptor.buffer.offset, descriptor.buffer.range });
+				}
+			}
+		}
+
+		auto [it, inserted] = m_Sets.try_emplace(key, CachedSet{ {}, updateTemplate.getLayout() });
+		DescriptorHandle& handle = it->second.handle;
+		if (!inserted)
+			return handle;
+
+		if (const Shared<DescriptorBuffer>& descriptorBuffer = VulkanContext::getDescriptorBuffer())
+		{
+			handle.bufferOffset = descriptorBuffer->allocate(updateTemplate.getLayout());
+			updateTemplate.update(*descriptorBuffer, handle.bufferOffset, data);
+			return handle;
+		}
+
+		handle.set = m_Allocator.allocate(updateTemplate.getLayout());
+		updateTemplate.update(handle.set, data);
+		return handle;
+	}
+
+	void DescriptorSetCache::clear()
+	{
+		if (const Shared<DescriptorBuffer>& descriptorBuffer = VulkanContext::getDescriptorBuffer())
+		{
+			for (const auto& [key, cachedSet] : m_Sets)
+			{
+				descriptorBuffer->free(cachedSet.handle.bufferOffset, cachedSet.layout);
+			}
+		}
+		m_Sets.clear();
+		m_Allocator.reset();
+	}
+}
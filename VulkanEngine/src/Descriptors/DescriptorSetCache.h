@@ -0,0 +1,59 @@
+#pragma once
+
+#include <map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "DescriptorAllocator.h"
+#include "DescriptorUpdateTemplate.h"
+#include "DescriptorBuffer.h"
+
+namespace vkEngine
+{
+	// Resource written to one binding of a descriptor set
+	struct DescriptorResource
+	{
+		uint32_t binding = 0;
+		VkDescriptorType type = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+		VkDescriptorBufferInfo bufferInfo{};
+		VkDescriptorImageInfo imageInfo{};
+
+		static DescriptorResource buffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+		static DescriptorResource image(uint32_t binding, VkDescriptorType type, const VkDescriptorImageInfo& imageInfo);
+
+		bool isImage() const;
+	};
+
+	// Descriptor sets that are never rewritten, keyed by layout and bound resources.
+	// Identical requests return the same set, so it is allocated and written once.
+	// Resources must outlive the sets referencing them, clear() drops every set once the GPU is done with them.
+	// With the descriptor buffer backend sets are regions of that buffer, clear() returns them for reuse.
+	class DescriptorSetCache
+	{
+	public:
+		DescriptorSetCache(VkDevice device);
+		~DescriptorSetCache();
+
+		DescriptorSetCache(const DescriptorSetCache&) = delete;
+		DescriptorSetCache& operator=(const DescriptorSetCache&) = delete;
+
+		DescriptorHandle getSet(VkDescriptorSetLayout layout, const std::vector<DescriptorResource>& resources);
+		// Same as above for data packed for an update template, a new set is written with a single template update
+		DescriptorHandle getSet(const DescriptorUpdateTemplate& updateTemplate, const std::vector<DescriptorData>& data);
+
+		size_t size() const { return m_Sets.size(); }
+		void clear();
+
+	private:
+		struct CachedSet
+		{
+			DescriptorHandle handle{};
+			VkDescriptorSetLayout layout = VK_NULL_HANDLE; // Frees the set's descriptor buffer space
+		};
+
+	private:
+		VkDevice m_Device = VK_NULL_HANDLE;
+		DescriptorAllocator m_Allocator;
+		std::map<std::vector<uint64_t>, CachedSet> m_Sets{};
+	};
+}
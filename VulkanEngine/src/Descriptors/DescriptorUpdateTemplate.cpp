@@ -0,0 +1,84 @@
+#include "pch.h"
+#include "DescriptorUpdateTemplate.h"
+#include "DescriptorBuffer.h"
+#include "VulkanContext.h"
+
+namespace vkEngine
+{
+	DescriptorUpdateTemplate::DescriptorUpdateTemplate(VkDevice device, VkDescriptorSetLayout layout, const std::vector<ReflectedBinding>& bindings)
+		: m_Device(device), m_Layout(layout)
+	{
+		for (const ReflectedBinding& binding : bindings)
+		{
+			if (binding.count == 0)
+				continue;
+
+			VkDescriptorUpdateTemplateEntry entry{};
+			entry.dstBinding = binding.binding;
+			entry.dstArrayElement = 0;
+			entry.descriptorCount = binding.count;
+			entry.descriptorType = binding.type;
+			entry.offset = m_SlotCount * sizeof(DescriptorData);
+			entry.stride = sizeof(DescriptorData);
+
+			m_Entries.push_back(entry);
+			m_EntryNames.push_back(binding.name);
+			m_SlotCount += binding.count;
+		}
+
+		ENGINE_ASSERT(!m_Entries.empty(), "Descriptor update template needs at least one fixed size binding");
+
+		if (VulkanContext::getPhysicalDevice()->getCapabilities().descriptorBuffer)
+			return;
+
+		VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+		templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+		templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(m_Entries.size());
+		templateInfo.pDescriptorUpdateEntries = m_Entries.data();
+		templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+		templateInfo.descriptorSetLayout = m_Layout;
+
+		ENGINE_ASSERT(vkCreateDescriptorUpdateTemplate(m_Device, &templateInfo, nullptr, &m_Template) == VK_SUCCESS, "Descriptor update template creation failed");
+	}
+
+	DescriptorUpdateTemplate::~DescriptorUpdateTemplate()
+	{
+		vkDestroyDescriptorUpdateTemplate(m_Device, m_Template, nullptr);
+	}
+
+	uint32_t DescriptorUpdateTemplate::getSlot(uint32_t binding, uint32_t arrayElement) const
+	{
+		auto it = std::find_if(m_Entries.begin(), m_Entries.end(), [binding](const VkDescriptorUpdateTemplateEntry& entry) { return entry.dstBinding == binding; });
+		ENGINE_ASSERT(it != m_Entries.end() && arrayElement < it->descriptorCount, "Binding %u element %u is not part of the update template", binding, arrayElement);
+
+		return static_cast<uint32_t>(it->offset / sizeof(DescriptorData)) + arrayElement;
+	}
+
+	uint32_t DescriptorUpdateTemplate::getSlot(const std::string& name, uint32_t arrayElement) const
+	{
+		auto it = std::find(m_EntryNames.begin(), m_EntryNames.end(), name);
+		ENGINE_ASSERT(it != m_EntryNames.end(), "Binding %s is not part of the update template", name.c_str());
+
+		return getSlot(m_Entries[std::distance(m_EntryNames.begin(), it)].dstBinding, arrayElement);
+	}
+
+	void DescriptorUpdateTemplate::update(VkDescriptorSet descriptorSet, const std::vector<DescriptorData>& data) const
+	{
+		ENGINE_ASSERT(data.size() == m_SlotCount, "Descriptor update data has %zu slots, the template expects %u", data.size(), m_SlotCount);
+		ENGINE_ASSERT(m_Template != VK_NULL_HANDLE, "Descriptor update template was created for the descriptor buffer backend");
+		vkUpdateDescriptorSetWithTemplate(m_Device, descriptorSet, m_Template, data.data());
+	}
+
+	void DescriptorUpdateTemplate::update(DescriptorBuffer& descriptorBuffer, VkDeviceSize setOffset, const std::vector<DescriptorData>& data) const
+	{
+		ENGINE_ASSERT(data.size() == m_SlotCount, "Descriptor update data has %zu slots, the template expects %u", data.size(), m_SlotCount);
+		for (const VkDescriptorUpdateTemplateEntry& entry : m_Entries)
+		{
+			uint32_t firstSlot = static_cast<uint32_t>(entry.offset / sizeof(DescriptorData));
+			for (uint32_t element = 0; element < entry.descriptorCount; element++)
+			{
+				descriptorBuffer.write(setOffset, m_Layout, entry.dstBinding, entry.dstArrayElement + element, entry.descriptorType, data[firstSlot + element]);
+			}
+		}
+	}
+}
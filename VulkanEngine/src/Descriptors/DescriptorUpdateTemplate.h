@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "Shaders/ShaderReflection.h"
+
+namespace vkEngine
+{
+	// One descriptor in the packed update data, the member used depends on the binding's descriptor type
+	union DescriptorData
+	{
+		VkDescriptorImageInfo image;
+		VkDescriptorBufferInfo buffer;
+		VkBufferView texelBuffer;
+	};
+
+	class DescriptorBuffer;
+
+	// Descriptor update template built from the reflected bindings of one set.
+	// The update data is an array of DescriptorData with one slot per descriptor, bindings laid out in order,
+	// so a whole set is written with a single vkUpdateDescriptorSetWithTemplate call.
+	// Runtime sized arrays are skipped, they belong to bindless tables updated slot by slot.
+	// With the descriptor buffer backend no Vulkan template is created, the same data is written into the buffer.
+	class DescriptorUpdateTemplate
+	{
+	public:
+		DescriptorUpdateTemplate(VkDevice device, VkDescriptorSetLayout layout, const std::vector<ReflectedBinding>& bindings);
+		~DescriptorUpdateTemplate();
+
+		DescriptorUpdateTemplate(const DescriptorUpdateTemplate&) = delete;
+		DescriptorUpdateTemplate& operator=(const DescriptorUpdateTemplate&) = delete;
+
+		VkDescriptorSetLayout getLayout() const { return m_Layout; }
+		const std::vector<VkDescriptorUpdateTemplateEntry>& getEntries() const { return m_Entries; }
+
+		// Zero initialized update data with a slot for every descriptor of the set
+		std::vector<DescriptorData> createData() const { return std::vector<DescriptorData>(m_SlotCount, DescriptorData{}); }
+		uint32_t getSlot(uint32_t binding, uint32_t arrayElement = 0) const;
+		uint32_t getSlot(const std::string& name, uint32_t arrayElement = 0) const;
+
+		void update(VkDescriptorSet descriptorSet, const std::vector<DescriptorData>& data) const;
+		void update(DescriptorBuffer& descriptorBuffer, VkDeviceSize setOffset, const std::vector<DescriptorData>& data) const;
+
+	private:
+		VkDevice m_Device = VK_NULL_HANDLE;
+		VkDescriptorSetLayout m_Layout = VK_NULL_HANDLE;
+		VkDescriptorUpdateTemplate m_Template = VK_NULL_HANDLE;
+
+		std::vector<VkDescriptorUpdateTemplateEntry> m_Entries{};
+		std::vector<std::string> m_EntryNames{};
+		uint32_t m_SlotCount = 0;
+	};
+}
@@ -11,6 +11,7 @@ namespace vkEngine
 		m_Instance(inst)
 	{
 		initLogicalDevice();
+		loadExtensionFunctions();
 	}
 
 	LogicalDevice::~LogicalDevice()
@@ -37,13 +38,88 @@ namespace vkEngine
 			queueCreateInfos.push_back(queueCreateInfo);
 		}
 
-		VkPhysicalDeviceFeatures deviceFeatures = m_PhysicalDevice->getFeatures();
+		const DeviceCapabilities& capabilities = m_PhysicalDevice->getCapabilities();
+		m_EnabledExtensions = m_DeviceExtensions;
+
+		VkPhysicalDeviceFeatures2 deviceFeatures{};
+		deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		deviceFeatures.features = m_PhysicalDevice->getFeatures();
+		void** next = &deviceFeatures.pNext;
+
+		VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+		dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+		if (capabilities.dynamicRendering)
+		{
+			dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+			*next = &dynamicRenderingFeatures;
+			next = &dynamicRenderingFeatures.pNext;
+			m_EnabledExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+		}
+
+		VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures{};
+		extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+		if (capabilities.extendedDynamicState)
+		{
+			extendedDynamicStateFeatures.extendedDynamicState = VK_TRUE;
+			*next = &extendedDynamicStateFeatures;
+			next = &extendedDynamicStateFeatures.pNext;
+			m_EnabledExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+		}
+
+		VkPhysicalDeviceExtendedDynamicState3FeaturesEXT extendedDynamicState3Features{};
+		extendedDynamicState3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+		if (capabilities.dynamicPolygonMode)
+		{
+			extendedDynamicState3Features.extendedDynamicState3PolygonMode = VK_TRUE;
+			*next = &extendedDynamicState3Features;
+			next = &extendedDynamicState3Features.pNext;
+			m_EnabledExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+		}
+
+		VkPhysicalDeviceDescriptorBufferFeaturesEXT descriptorBufferFeatures{};
+		descriptorBufferFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT;
+		if (capabilities.descriptorBuffer)
+		{
+			descriptorBufferFeatures.descriptorBuffer = VK_TRUE;
+			*next = &descriptorBufferFeatures;
+			next = &descriptorBufferFeatures.pNext;
+			m_EnabledExtensions.push_back(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME);
+		}
+
+		// Required by descriptor buffers below Vulkan 1.3, see PhysicalDevice::queryCapabilities
+		VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features{};
+		synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+		if (capabilities.descriptorBuffer)
+		{
+			synchronization2Features.synchronization2 = VK_TRUE;
+			*next = &synchronization2Features;
+			next = &synchronization2Features.pNext;
+			m_EnabledExtensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+		}
+
+		VkPhysicalDeviceVulkan12Features vulkan12Features{};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES;
+		if (capabilities.descriptorIndexing)
+		{
+			vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+			vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+			vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+			vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+			vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+		}
+		vulkan12Features.bufferDeviceAddress = capabilities.bufferDeviceAddress ? VK_TRUE : VK_FALSE;
+		if (m_PhysicalDevice->getProperties().apiVersion >= VK_API_VERSION_1_2)
+		{
+			*next = &vulkan12Features;
+			next = &vulkan12Features.pNext;
+		}
 
 		VkDeviceCreateInfo deviceInfo{};
 		deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceInfo.pNext = &deviceFeatures;
 		deviceInfo.pQueueCreateInfos = queueCreateInfos.data();
 		deviceInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
-		deviceInfo.pEnabledFeatures = &deviceFeatures;
+		deviceInfo.pEnabledFeatures = nullptr; // Provided through VkPhysicalDeviceFeatures2 in pNext
 
 		//Specify validation layers for older version of vulkan where is still the case (Previosly vulkan differ these two settings)
 		std::vector<const char*> validationLayers{};
@@ -57,13 +133,47 @@ namespace vkEngine
 			deviceInfo.enabledLayerCount = 0;
 		}
 
-		
-			deviceInfo.enabledExtensionCount = static_cast<uint32_t>(m_DeviceExtensions.size());
-		deviceInfo.ppEnabledExtensionNames = m_DeviceExtensions.data();
+		deviceInfo.enabledExtensionCount = static_cast<uint32_t>(m_EnabledExtensions.size());
+		deviceInfo.ppEnabledExtensionNames = m_EnabledExtensions.data();
 
 		ENGINE_ASSERT(vkCreateDevice(m_PhysicalDevice->physicalDevice(), &deviceInfo, nullptr, &m_Device) == VK_SUCCESS, "Device creation failed");
 	}
 
+	void LogicalDevice::loadExtensionFunctions()
+	{
+		const DeviceCapabilities& capabilities = m_PhysicalDevice->getCapabilities();
+
+		if (capabilities.dynamicRendering)
+		{
+			m_ExtensionFunctions.cmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(vkGetDeviceProcAddr(m_Device, "vkCmdBeginRenderingKHR"));
+			m_ExtensionFunctions.cmdEndRendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(vkGetDeviceProcAddr(m_Device, "vkCmdEndRenderingKHR"));
+		}
+
+		if (capabilities.extendedDynamicState)
+		{
+			m_ExtensionFunctions.cmdSetCullMode = reinterpret_cast<PFN_vkCmdSetCullModeEXT>(vkGetDeviceProcAddr(m_Device, "vkCmdSetCullModeEXT"));
+			m_ExtensionFunctions.cmdSetFrontFace = reinterpret_cast<PFN_vkCmdSetFrontFaceEXT>(vkGetDeviceProcAddr(m_Device, "vkCmdSetFrontFaceEXT"));
+			m_ExtensionFunctions.cmdSetPrimitiveTopology = reinterpret_cast<PFN_vkCmdSetPrimitiveTopologyEXT>(vkGetDeviceProcAddr(m_Device, "vkCmdSetPrimitiveTopologyEXT"));
+			m_ExtensionFunctions.cmdSetDepthTestEnable = reinterpret_cast<PFN_vkCmdSetDepthTestEnableEXT>(vkGetDeviceProcAddr(m_Device, "vkCmdSetDepthTestEnableEXT"));
+			m_ExtensionFunctions.cmdSetDepthWriteEnable = reinterpret_cast<PFN_vkCmdSetDepthWriteEnableEXT>(vkGetDeviceProcAddr(m_Device, "vkCmdSetDepthWriteEnableEXT"));
+			m_ExtensionFunctions.cmdSetDepthCompareOp = reinterpret_cast<PFN_vkCmdSetDepthCompareOpEXT>(vkGetDeviceProcAddr(m_Device, "vkCmdSetDepthCompareOpEXT"));
+		}
+
+		if (capabilities.descriptorBuffer)
+		{
+			m_ExtensionFunctions.getDescriptorSetLayoutSize = reinterpret_cast<PFN_vkGetDescriptorSetLayoutSizeEXT>(vkGetDeviceProcAddr(m_Device, "vkGetDescriptorSetLayoutSizeEXT"));
+			m_ExtensionFunctions.getDescriptorSetLayoutBindingOffset = reinterpret_cast<PFN_vkGetDescriptorSetLayoutBindingOffsetEXT>(vkGetDeviceProcAddr(m_Device, "vkGetDescriptorSetLayoutBindingOffsetEXT"));
+			m_ExtensionFunctions.getDescriptor = reinterpret_cast<PFN_vkGetDescriptorEXT>(vkGetDeviceProcAddr(m_Device, "vkGetDescriptorEXT"));
+			m_ExtensionFunctions.cmdBindDescriptorBuffers = reinterpret_cast<PFN_vkCmdBindDescriptorBuffersEXT>(vkGetDeviceProcAddr(m_Device, "vkCmdBindDescriptorBuffersEXT"));
+			m_ExtensionFunctions.cmdSetDescriptorBufferOffsets = reinterpret_cast<PFN_vkCmdSetDescriptorBufferOffsetsEXT>(vkGetDeviceProcAddr(m_Device, "vkCmdSetDescriptorBufferOffsetsEXT"));
+		}
+
+		if (capabilities.dynamicPolygonMode)
+		{
+			m_ExtensionFunctions.cmdSetPolygonMode = reinterpret_cast<PFN_vkCmdSetPolygonModeEXT>(vkGetDeviceProcAddr(m_Device, "vkCmdSetPolygonModeEXT"));
+		}
+	}
+
 	void LogicalDevice::cleanup()
 	{
 		ENGINE_ASSERT(m_Device != VK_NULL_HANDLE, "Logical Device is null");
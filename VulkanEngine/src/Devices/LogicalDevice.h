@@ -7,6 +7,28 @@ namespace vkEngine
 	class PhysicalDevice;
 	class Instance;
 
+	// Entry points of optional extensions, null when the extension is not enabled
+	struct DeviceExtensionFunctions
+	{
+		PFN_vkCmdBeginRenderingKHR cmdBeginRendering = nullptr;
+		PFN_vkCmdEndRenderingKHR cmdEndRendering = nullptr;
+
+		PFN_vkCmdSetCullModeEXT cmdSetCullMode = nullptr;
+		PFN_vkCmdSetFrontFaceEXT cmdSetFrontFace = nullptr;
+		PFN_vkCmdSetPrimitiveTopologyEXT cmdSetPrimitiveTopology = nullptr;
+		PFN_vkCmdSetDepthTestEnableEXT cmdSetDepthTestEnable = nullptr;
+		PFN_vkCmdSetDepthWriteEnableEXT cmdSetDepthWriteEnable = nullptr;
+		PFN_vkCmdSetDepthCompareOpEXT cmdSetDepthCompareOp = nullptr;
+
+		PFN_vkCmdSetPolygonModeEXT cmdSetPolygonMode = nullptr;
+
+		PFN_vkGetDescriptorSetLayoutSizeEXT getDescriptorSetLayoutSize = nullptr;
+		PFN_vkGetDescriptorSetLayoutBindingOffsetEXT getDescriptorSetLayoutBindingOffset = nullptr;
+		PFN_vkGetDescriptorEXT getDescriptor = nullptr;
+		PFN_vkCmdBindDescriptorBuffersEXT cmdBindDescriptorBuffers = nullptr;
+		PFN_vkCmdSetDescriptorBufferOffsetsEXT cmdSetDescriptorBufferOffsets = nullptr;
+	};
+
 	class LogicalDevice
 	{
 	public:
@@ -20,6 +42,8 @@ namespace vkEngine
 		LogicalDevice& operator=(LogicalDevice&&) = default;
 
 		VkDevice logicalDevice() const { return m_Device; }
+		const DeviceExtensionFunctions& getExtensionFunctions() const { return m_ExtensionFunctions; }
+		const std::vector<const char*>& getEnabledExtensions() const { return m_EnabledExtensions; }
 
 
 	private:
@@ -27,9 +51,12 @@ namespace vkEngine
 		const Shared<Instance> m_Instance;
 		const std::vector<const char*>& m_DeviceExtensions;
 		VkDevice m_Device{VK_NULL_HANDLE};
+		std::vector<const char*> m_EnabledExtensions{};
+		DeviceExtensionFunctions m_ExtensionFunctions{};
 
 	private:
 		void initLogicalDevice();
+		void loadExtensionFunctions();
 		void cleanup();
 	};
 }
@@ -96,10 +96,20 @@ namespace vkEngine
 
 		return VK_SAMPLE_COUNT_1_BIT;
 	}
-	uint32_t PhysicalDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+	uint32_t PhysicalDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, VkMemoryPropertyFlags preferredProperties)
 	{
 		VkPhysicalDeviceMemoryProperties memProperties = getMemoryProperties();
 
+		if (preferredProperties != 0)
+		{
+			VkMemoryPropertyFlags allProperties = properties | preferredProperties;
+			for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+			{
+				if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & allProperties) == allProperties)
+					return i;
+			}
+		}
+
 		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
 		{
 			if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
@@ -286,5 +296,116 @@ namespace vkEngine
 		}
 
 		ENGINE_ASSERT(m_PhysicalDevice != VK_NULL_HANDLE, "Failed to find suitable GPU");
+		queryCapabilities();
+	}
+
+	bool PhysicalDevice::isExtensionSupported(const char* extension) const
+	{
+		return m_SupportedExtensions.contains(extension);
+	}
+
+	void PhysicalDevice::queryCapabilities()
+	{
+		uint32_t extensionCount;
+		vkEnumerateDeviceExtensionProperties(m_PhysicalDevice, nullptr, &extensionCount, nullptr);
+
+		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(m_PhysicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+		for (const auto& extension : availableExtensions)
+		{
+			m_SupportedExtensions.insert(extension.extensionName);
+		}
+
+		// Feature structs may only be chained for extensions the device exposes
+		VkPhysicalDeviceFeatures2 features{};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		void** next = &features.pNext;
+
+		VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+		dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+		if (isExtensionSupported(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+		{
+			*next = &dynamicRenderingFeatures;
+			next = &dynamicRenderingFeatures.pNext;
+		}
+
+		VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures{};
+		extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+		if (isExtensionSupported(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME))
+		{
+			*next = &extendedDynamicStateFeatures;
+			next = &extendedDynamicStateFeatures.pNext;
+		}
+
+		VkPhysicalDeviceExtendedDynamicState3FeaturesEXT extendedDynamicState3Features{};
+		extendedDynamicState3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+		if (isExtensionSupported(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME))
+		{
+			*next = &extendedDynamicState3Features;
+			next = &extendedDynamicState3Features.pNext;
+		}
+
+		VkPhysicalDeviceDescriptorBufferFeaturesEXT descriptorBufferFeatures{};
+		descriptorBufferFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT;
+		if (isExtensionSupported(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME))
+		{
+			*next = &descriptorBufferFeatures;
+			next = &descriptorBufferFeatures.pNext;
+		}
+
+		VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features{};
+		synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+		if (isExtensionSupported(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME))
+		{
+			*next = &synchronization2Features;
+			next = &synchronization2Features.pNext;
+		}
+
+		VkPhysicalDeviceVulkan12Features vulkan12Features{};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES;
+		if (m_DeviceInfo.properties.apiVersion >= VK_API_VERSION_1_2)
+		{
+			*next = &vulkan12Features;
+			next = &vulkan12Features.pNext;
+		}
+
+		vkGetPhysicalDeviceFeatures2(m_PhysicalDevice, &features);
+
+		m_Capabilities.dynamicRendering = dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+		m_Capabilities.extendedDynamicState = extendedDynamicStateFeatures.extendedDynamicState == VK_TRUE;
+		m_Capabilities.dynamicPolygonMode = extendedDynamicState3Features.extendedDynamicState3PolygonMode == VK_TRUE;
+		m_Capabilities.descriptorIndexing = vulkan12Features.runtimeDescriptorArray && vulkan12Features.descriptorBindingPartiallyBound &&
+			vulkan12Features.descriptorBindingSampledImageUpdateAfterBind && vulkan12Features.descriptorBindingUpdateUnusedWhilePending &&
+			vulkan12Features.shaderSampledImageArrayNonUniformIndexing;
+		m_Capabilities.bufferDeviceAddress = vulkan12Features.bufferDeviceAddress == VK_TRUE;
+		m_Capabilities.multiDrawIndirect = features.features.multiDrawIndirect && features.features.drawIndirectFirstInstance;
+		for (uint32_t i = 0; i < m_DeviceInfo.memoryProperties.memoryTypeCount; i++)
+		{
+			if (m_DeviceInfo.memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+				m_Capabilities.lazilyAllocatedMemory = true;
+		}
+		// Descriptor buffers are addressed by device address and only replace sets when bindless textures work as well. Below
+		// Vulkan 1.3, which the instance targets, the extension also depends on synchronization2
+		m_Capabilities.descriptorBuffer = descriptorBufferFeatures.descriptorBuffer && synchronization2Features.synchronization2
+			&& m_Capabilities.bufferDeviceAddress && m_Capabilities.descriptorIndexing;
+
+		if (m_Capabilities.descriptorBuffer)
+		{
+			m_DescriptorBufferProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT;
+
+			VkPhysicalDeviceProperties2 properties{};
+			properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			properties.pNext = &m_DescriptorBufferProperties;
+			vkGetPhysicalDeviceProperties2(m_PhysicalDevice, &properties);
+		}
+
+		ENGINE_INFO("Dynamic rendering: %s", m_Capabilities.dynamicRendering ? "supported" : "not supported");
+		ENGINE_INFO("Extended dynamic state: %s", m_Capabilities.extendedDynamicState ? "supported" : "not supported");
+		ENGINE_INFO("Dynamic polygon mode: %s", m_Capabilities.dynamicPolygonMode ? "supported" : "not supported");
+		ENGINE_INFO("Descriptor indexing: %s", m_Capabilities.descriptorIndexing ? "supported" : "not supported");
+		ENGINE_INFO("Descriptor buffer: %s", m_Capabilities.descriptorBuffer ? "supported" : "not supported");
+		ENGINE_INFO("Multi draw indirect: %s", m_Capabilities.multiDrawIndirect ? "supported" : "not supported");
+		ENGINE_INFO("Lazily allocated memory: %s", m_Capabilities.lazilyAllocatedMemory ? "supported" : "not supported");
 	}
 }
\ No newline at end of file
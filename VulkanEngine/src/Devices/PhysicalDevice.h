@@ -6,6 +6,19 @@
 namespace vkEngine
 {
 
+	// Optional features, enabled on the logical device only when the GPU supports them
+	struct DeviceCapabilities
+	{
+		bool dynamicRendering = false;
+		bool extendedDynamicState = false; // Cull mode, front face, topology and depth state set at record time
+		bool dynamicPolygonMode = false; // From extended dynamic state 3
+		bool descriptorIndexing = false; // Partially bound, update after bind, non uniformly indexed sampled image arrays for bindless textures
+		bool bufferDeviceAddress = false;
+		bool descriptorBuffer = false; // Descriptors written into buffer memory instead of pool allocated sets
+		bool multiDrawIndirect = false; // Indirect draws with several commands and a non zero firstInstance
+		bool lazilyAllocatedMemory = false; // Memory committed only when a transient attachment spills out of tile memory
+	};
+
 	struct PhysicalDeviceInfo
 	{
 		VkPhysicalDeviceProperties properties{};
@@ -30,9 +43,13 @@ namespace vkEngine
 		VkSampleCountFlagBits getMaxUsableSampleCount() const;
 
 
-			uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+		// preferredProperties are added when some allowed type has them, such as LAZILY_ALLOCATED for transient attachments
+		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, VkMemoryPropertyFlags preferredProperties = 0);
 
 		const PhysicalDeviceInfo& getDeviceInfo() const { return m_DeviceInfo; }
+		const DeviceCapabilities& getCapabilities() const { return m_Capabilities; }
+		const VkPhysicalDeviceDescriptorBufferPropertiesEXT& getDescriptorBufferProperties() const { return m_DescriptorBufferProperties; }
+		bool isExtensionSupported(const char* extension) const;
 
 		VkFormatProperties getFormatProperties(VkFormat format) const;
 		VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
@@ -41,6 +58,9 @@ namespace vkEngine
 	private:
 		VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
 		PhysicalDeviceInfo m_DeviceInfo;
+		DeviceCapabilities m_Capabilities{};
+		VkPhysicalDeviceDescriptorBufferPropertiesEXT m_DescriptorBufferProperties{};
+		std::unordered_set<std::string> m_SupportedExtensions{};
 		const Shared<Instance> m_Instance;
 		const Shared<Window> m_Window;
 		const std::vector<const char*>& m_DeviceExtensions{};
@@ -48,6 +68,7 @@ namespace vkEngine
 		private
 			:
 				void initialize();
+				void queryCapabilities();
 				bool isDeviceSuitable(VkPhysicalDevice device);
 				VkBool32 isQueueSupportPresentation(VkPhysicalDevice device, QueueFamilyIndex index) const;
 				bool checkDeviceExtensionSupport(VkPhysicalDevice device);
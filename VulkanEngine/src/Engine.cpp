@@ -5,6 +5,7 @@
 #include "Application.h"
 #include "QueueHandler.h"
 #include "Utility/VulkanUtils.h"
+#include "Shaders/Shader.h"
 #include <tiny_obj_loader.h>
 #include <unordered_map>
 #include <glm/gtx/string_cast.hpp>
@@ -19,7 +20,48 @@ namespace vkEngine
 	static uint32_t currentFrame = 0;
 
 	const int WINDOW_STARTUP_HEIGHT = 1000, WINDOW_STARTUP_WIDTH = 1000;
+	const uint32_t BENCHMARK_WARMUP_FRAMES = 100, BENCHMARK_MEASURED_FRAMES = 1000, BENCHMARK_REPORT_FRAMES = 250;
+	const float LOD_PIXEL_ERROR = 1.0f; // On screen error a level of detail may show
+	const size_t CPU_OCCLUDER_COUNT = 16; // Nearest instances in view rasterized as occluders when the GPU cannot cull
+	const VkClearColorValue CLEAR_COLOR = { {0.0f, 0.0f, 0.0f, 1.0f} };
 	const std::string APP_NAME = "VulkanEngine";
+	const std::string SHADER_SOURCE_DIR = "shaders/src";
+	const std::string SHADER_BINARY_DIR = "shaders/bin";
+	const std::string DEFAULT_VERTEX_SHADER = SHADER_BINARY_DIR + "/defaultShader.vert.spv";
+	const std::string DEFAULT_FRAGMENT_SHADER = SHADER_BINARY_DIR + "/defaultShader.frag.spv";
+	const std::string VERTEX_PULLING_SHADER = SHADER_BINARY_DIR + "/vertexPulling.vert.spv";
+
+	namespace
+	{
+		// Largest axis scale of the instance transform, mesh space distances grow by up to this much
+		float getInstanceScale(const InstanceData& instance)
+		{
+			return std::max({ glm::length(glm::vec3(instance.modelMat[0])), glm::length(glm::vec3(instance.modelMat[1])), glm::length(glm::vec3(instance.modelMat[2])) });
+		}
+
+		// World space box around the mesh's bounding sphere moved by the instance transform
+		BoundingBox getInstanceBounds(const InstanceData& instance, const glm::vec4& boundingSphere)
+		{
+			glm::vec3 center{ instance.modelMat * glm::vec4(glm::vec3(boundingSphere), 1.0f) };
+			return BoundingBox::fromSphere(center, boundingSphere.w * getInstanceScale(instance));
+		}
+
+		// Positions of the triangles of indices, with an index list of their own
+		OccluderMesh createOccluderMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+		{
+			OccluderMesh mesh;
+			std::unordered_map<uint32_t, uint32_t> remap;
+			mesh.indices.reserve(indices.size());
+			for (uint32_t index : indices)
+			{
+				auto [it, inserted] = remap.try_emplace(index, static_cast<uint32_t>(mesh.vertices.size()));
+				if (inserted)
+					mesh.vertices.push_back(vertices[index].position);
+				mesh.indices.push_back(it->second);
+			}
+			return mesh;
+		}
+	}
 
 	Engine::Engine(const Application* app)
 		: m_App(app)
@@ -41,6 +83,8 @@ namespace vkEngine
 
 			update(deltaTime);
 			render();
+			if (m_App->getOptions().benchmarkInstances > 0)
+				reportBenchmark(deltaTime);
 
 			timer.Stop();
 		}
@@ -64,26 +108,51 @@ namespace vkEngine
 
 	void vkEngine::Engine::initVulkan()
 	{
-		initRenderPass();
+		m_UseDynamicRendering = VulkanContext::getPhysicalDevice()->getCapabilities().dynamicRendering;
+		m_UseVertexPulling = VulkanContext::getPhysicalDevice()->getCapabilities().bufferDeviceAddress;
+		// Only the depth pyramid samples the depth buffer, without occlusion culling it can stay a transient attachment
+		VulkanContext::getSwapchain()->setDepthBufferSampled(InstanceCuller::supportsOcclusionCulling(m_UseDynamicRendering));
+		VulkanContext::getSwapchain()->setMSAABufferUsed(!m_UseDynamicRendering);
+		if (!m_UseDynamicRendering)
+			initRenderPass();
 		initDescriptorsSetLayout();
 		initGraphicsPipeline();
-		VulkanContext::getSwapchain()->initFramebuffers(m_RenderPass); // TODO: Framebuffers are part of renderpass not swapchain. Not a good place for this.
+		if (!m_UseDynamicRendering)
+			VulkanContext::getSwapchain()->initFramebuffers(m_RenderPass); // TODO: Framebuffers are part of renderpass not swapchain. Not a good place for this.
 		VulkanContext::getCommandHandler()->allocateCommandBuffers(s_MaxFramesInFlight);
 
 		initTextureImage();
 
-		initVertexBuffer();
-		initIndexBuffer();
+		initGeometry();
 		initUniformBuffer();
+		initInstanceBuffers();
+		initInstances();
+		initSceneBvh();
+		m_DrawBatcher = CreateScoped<DrawBatcher>(s_MaxFramesInFlight, m_ThreadPool.get());
+		// The late pass continues drawing into the early pass's attachments, which the render pass path cannot
+		m_DepthPyramid = CreateScoped<DepthPyramid>(*VulkanContext::getSwapchain()->getDepthBuffer());
+		m_RenderGraph = CreateScoped<RenderGraph>(m_DeletionQueue);
+		// Instances are culled into the meshlets of the level they pick, at worst every one picks the level with the most
+		uint32_t maxLevelMeshlets = 0;
+		for (const std::vector<MeshAllocation>& levelMeshlets : m_LodMeshlets)
+		{
+			maxLevelMeshlets = std::max(maxLevelMeshlets, static_cast<uint32_t>(levelMeshlets.size()));
+		}
+		m_InstanceCuller = CreateScoped<InstanceCuller>(m_InstanceBuffers, *m_DrawBatcher, *m_DepthPyramid, maxLevelMeshlets, static_cast<uint32_t>(m_MeshLods.size()),
+			m_UseDynamicRendering);
+		if (!m_InstanceCuller->isCulling())
+			m_OcclusionRasterizer = CreateScoped<OcclusionRasterizer>(m_ThreadPool.get());
 
-		initDescriptorPool();
+		initDescriptorSetCache();
 		initDescriptorSets();
 		initSyncObjects();
+		initShaderHotReload();
 	}
 
 	void vkEngine::Engine::update(Timestep deltaTime)
 	{
 		m_Camera->Update(deltaTime);
+		pickInstance();
 
 		updateUniformBuffer(currentFrame, deltaTime);
 
@@ -96,8 +165,13 @@ namespace vkEngine
 			return;
 
 		vkWaitForFences(VulkanContext::getDevice(), 1, &m_InFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+		m_DeletionQueue.flush(m_FrameSlotSubmissions[currentFrame]);
+		m_InstanceBuffers[currentFrame]->reset();
+		m_DrawBatcher->begin(currentFrame);
+		m_InstanceCuller->begin(currentFrame);
 
-		updateTexture(m_DescriptorSets[currentFrame], 1);
+		processShaderReloads();
+		selectTexture();
 
 		auto& swapchain = VulkanContext::getSwapchain();
 		VkResult result = swapchain->acquireNextImage(currentFrame);
@@ -107,6 +181,8 @@ namespace vkEngine
 		{
 			vkWaitForFences(VulkanContext::getDevice(), s_MaxFramesInFlight, &m_InFlightFences[0], VK_TRUE, UINT64_MAX);
 			swapchain->recreateSwapchain(m_RenderPass);
+			m_DepthPyramid->resize(*swapchain->getDepthBuffer());
+			m_InstanceCuller->updateDepthPyramid();
 			return;
 		}
 		else
@@ -135,6 +211,7 @@ namespace vkEngine
 		submitInfo.signalSemaphoreCount = signalSemaphoresCount;
 
 		VulkanContext::getQueueHandler()->submitCommands(submitInfo, m_InFlightFences[currentFrame]);
+		m_FrameSlotSubmissions[currentFrame] = ++m_FrameNumber;
 
 		swapchain->present(signalSemaphores, signalSemaphoresCount);
 
@@ -152,15 +229,28 @@ namespace vkEngine
 		{
 			m_UniformBuffers[i].reset();
 		}
+		m_InstanceCuller.reset();
+		m_RenderGraph.reset();
+		m_DepthPyramid.reset();
+		m_SceneBvh.reset();
+		m_OcclusionRasterizer.reset();
+		m_ThreadPool.reset();
+		m_InstanceBuffers.clear();
+		m_DrawBatcher.reset();
 
-		vkDestroyDescriptorPool(device, m_DesciptorPool, nullptr);
-		vkDestroyDescriptorSetLayout(device, m_DescriptorSetLayout, nullptr);
+		m_DescriptorSetCache.reset();
 
 		m_IndexBuffer.reset();
 		m_VertexBuffer.reset();
+		m_GeometryPool.reset();
+
+		m_ShaderHotReloader.reset();
+		if (m_PendingPipelines.valid())
+			m_PendingPipelines.get();
+		m_DeletionQueue.flushAll();
 
-		vkDestroyPipeline(device, m_GraphicsPipeline, nullptr);
-		vkDestroyPipelineLayout(device, m_PipelineLayout, nullptr);
+		m_GraphicsPipeline.reset();
+		m_PipelineCache.clear();
 
 		vkDestroyRenderPass(device, m_RenderPass, nullptr);
 
@@ -177,91 +267,50 @@ namespace vkEngine
 
 	void Engine::initDescriptorsSetLayout()
 	{
-		VkDescriptorSetLayoutBinding uboLayoutBinding{};
-		uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		uboLayoutBinding.binding = 0;
-		uboLayoutBinding.descriptorCount = 1;
-		uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-		uboLayoutBinding.pImmutableSamplers = nullptr; // Optional
-
-		VkDescriptorSetLayoutBinding samplerLayoutBinding{};
-		samplerLayoutBinding.binding = 1;
-		samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		samplerLayoutBinding.descriptorCount = 1;
-		samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-		std::array<VkDescriptorSetLayoutBinding, 2> bindings = { uboLayoutBinding, samplerLayoutBinding };
-		VkDescriptorSetLayoutCreateInfo layoutInfo{};
-		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-		layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-		layoutInfo.pBindings = bindings.data();
-
-		ENGINE_ASSERT(vkCreateDescriptorSetLayout(VulkanContext::getDevice(), &layoutInfo, nullptr, &m_DescriptorSetLayout) == VK_SUCCESS, "Layout descriptors set creation failed");
+		ShaderReflection vertexReflection(Shader::readFile(m_UseVertexPulling ? VERTEX_PULLING_SHADER : DEFAULT_VERTEX_SHADER));
+		ShaderReflection fragmentReflection(Shader::readFile(DEFAULT_FRAGMENT_SHADER));
+
+		m_PipelineLayoutInfo = VulkanContext::getPipelineLayoutCache()->getLayout({ &vertexReflection, &fragmentReflection });
+		ENGINE_ASSERT(m_PipelineLayoutInfo.setLayouts.size() == 2, "Default shader is expected to use the frame set and the bindless texture set");
+		ENGINE_ASSERT(m_PipelineLayoutInfo.findBinding("ubo") && m_PipelineLayoutInfo.findBinding("instances") && m_PipelineLayoutInfo.findBinding("visibleInstances")
+			&& m_PipelineLayoutInfo.findBinding("textures"),
+			"Default shader bindings not found");
+		ENGINE_ASSERT(m_PipelineLayoutInfo.setLayouts[BindlessRegistry::s_TextureSet] == VulkanContext::getBindlessRegistry()->getSetLayout(),
+			"Default shader texture table does not match the bindless registry layout");
+		ENGINE_ASSERT(!m_UseVertexPulling || (!m_PipelineLayoutInfo.pushConstantRanges.empty() && m_PipelineLayoutInfo.pushConstantRanges[0].size >= sizeof(DrawPushConstants)),
+			"Vertex pulling shader is expected to declare the draw push constants");
+
+		m_PipelineLayout = m_PipelineLayoutInfo.layout;
+		m_DescriptorSetLayout = m_PipelineLayoutInfo.setLayouts[0];
 	}
 
-	void Engine::initDescriptorPool()
+	void Engine::initDescriptorSetCache()
 	{
-		std::array<VkDescriptorPoolSize, 2> poolSizes{};
-		poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		poolSizes[0].descriptorCount = static_cast<uint32_t>(s_MaxFramesInFlight);
-
-		poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		poolSizes[1].descriptorCount = static_cast<uint32_t>(s_MaxFramesInFlight);
-
-		VkDescriptorPoolCreateInfo poolInfo{};
-		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-		poolInfo.pPoolSizes = poolSizes.data();
-		poolInfo.maxSets = static_cast<uint32_t>(s_MaxFramesInFlight);
-
-		ENGINE_ASSERT(vkCreateDescriptorPool(VulkanContext::getDevice(), &poolInfo, nullptr, &m_DesciptorPool) == VK_SUCCESS, "Descriptor pool creation failed");
+		m_DescriptorSetCache = CreateScoped<DescriptorSetCache>(VulkanContext::getDevice());
 	}
 
 	void Engine::initDescriptorSets()
 	{
-		std::vector<VkDescriptorSetLayout> layouts(s_MaxFramesInFlight, m_DescriptorSetLayout);
-		VkDescriptorSetAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		allocInfo.descriptorPool = m_DesciptorPool;
-		allocInfo.descriptorSetCount = static_cast<uint32_t>(s_MaxFramesInFlight);
-		allocInfo.pSetLayouts = layouts.data();
+		const DescriptorUpdateTemplate& updateTemplate = VulkanContext::getPipelineLayoutCache()->getUpdateTemplate(m_PipelineLayoutInfo, 0);
+		std::vector<DescriptorData> data = updateTemplate.createData();
+		uint32_t uboSlot = updateTemplate.getSlot("ubo");
+		uint32_t instancesSlot = updateTemplate.getSlot("instances");
+		uint32_t visibleInstancesSlot = updateTemplate.getSlot("visibleInstances");
 
+		// Each frame's uniform, instance and visible instance buffers are fixed, so its set is written once and shared through the cache
 		m_DescriptorSets.resize(s_MaxFramesInFlight);
-
-		ENGINE_ASSERT(vkAllocateDescriptorSets(VulkanContext::getDevice(), &allocInfo, m_DescriptorSets.data()) == VK_SUCCESS, "Descriptor sets allocations failed");
-
 		for (size_t i = 0; i < s_MaxFramesInFlight; i++)
 		{
-			VkDescriptorBufferInfo bufferInfo{};
-			bufferInfo.buffer = m_UniformBuffers[i]->getBuffer();
-			bufferInfo.offset = 0;
-			bufferInfo.range = VK_WHOLE_SIZE;
-
-			VkDescriptorImageInfo imageInfo = m_TextureTest->getDescriptorImageInfo();
-
-			std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
-
-			descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[0].dstSet = m_DescriptorSets[i];
-			descriptorWrites[0].dstBinding = 0;
-			descriptorWrites[0].dstArrayElement = 0;
-			descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			descriptorWrites[0].descriptorCount = 1;
-			descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-			descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[1].dstSet = m_DescriptorSets[i];
-			descriptorWrites[1].dstBinding = 1;
-			descriptorWrites[1].dstArrayElement = 0;
-			descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorWrites[1].descriptorCount = 1;
-			descriptorWrites[1].pImageInfo = &imageInfo;
-
-			vkUpdateDescriptorSets(VulkanContext::getDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+			data[uboSlot].buffer = { m_UniformBuffers[i]->getBuffer(), 0, sizeof(UniformBufferObject) };
+			data[instancesSlot].buffer = { m_InstanceBuffers[i]->getBuffer(), 0, m_InstanceBuffers[i]->getSize() };
+			data[visibleInstancesSlot].buffer = { m_InstanceCuller->getVisibleInstanceBuffer(static_cast<uint32_t>(i)), 0, m_InstanceCuller->getVisibleInstanceBufferSize() };
+			m_DescriptorSets[i] = m_DescriptorSetCache->getSet(updateTemplate, data);
 		}
 	}
 
-	void Engine::updateTexture(VkDescriptorSet descriptorSet, uint32_t binding) {
+	// Textures live in the bindless table, switching only changes the index pushed with the draw
+	void Engine::selectTexture()
+	{
 		if (glfwGetKey(m_App->getWindow()->getWindowGLFW(), GLFW_KEY_1) == GLFW_PRESS)
 		{
 			m_CurrentTexture = m_TextureTest;
@@ -270,29 +319,56 @@ namespace vkEngine
 		{
 			m_CurrentTexture = m_TextureTest2;
 		}
-		else
-		{
+
+		if (m_App->getOptions().benchmarkInstances == 0)
+			m_Instances.front().textureIndex = m_CurrentTexture->getBindlessIndex();
+	}
+
+	// Frame times are averaged after a warm up and logged periodically, the window closes once the run is complete
+	void Engine::reportBenchmark(Timestep deltaTime)
+	{
+		m_BenchmarkFrame++;
+		if (m_BenchmarkFrame <= BENCHMARK_WARMUP_FRAMES)
 			return;
-		}
 
-		float currentTime = CurrentTime::GetCurrentTimeInSec();
+		m_BenchmarkTime += deltaTime.GetMilliseconds();
+		uint32_t measuredFrames = m_BenchmarkFrame - BENCHMARK_WARMUP_FRAMES;
+		if (measuredFrames % BENCHMARK_REPORT_FRAMES != 0)
+			return;
 
-		ENGINE_INFO("Time %f: ", currentTime);
-		// Update the descriptor set with the new texture
+		float averageTime = m_BenchmarkTime / measuredFrames;
+		const CullStats& cullStats = m_InstanceCuller->isCulling() ? m_InstanceCuller->getStats() : m_CpuCullStats;
+		ENGINE_INFO("Benchmark: %u instances, %u frames, %.3f ms/frame (%.1f FPS), %u visible, %u culled, %u occluded", m_App->getOptions().benchmarkInstances, measuredFrames,
+			averageTime, 1000.0f / averageTime, cullStats.visible, cullStats.culled, cullStats.occluded);
+		ENGINE_INFO("Benchmark: %zu meshlets over %zu levels of detail per instance, %u meshlet draws facing away", m_Meshlets.size(), m_MeshLods.size(),
+			cullStats.backFacing);
+		ENGINE_INFO("Benchmark: %zu draw batches, %u state commands recorded, %u redundant ones dropped", m_DrawBatcher->getBatchCount(),
+			m_CommandListStats.issued, m_CommandListStats.skipped);
+		if (m_UseDynamicRendering)
+		{
+			const RenderGraphStats& graphStats = m_RenderGraph->getStats();
+			ENGINE_INFO("Benchmark: %u render graph passes, %u culled, %u image barriers, %u transient images in %llu of %llu bytes", graphStats.passes,
+				graphStats.culledPasses, graphStats.imageBarriers, graphStats.transientImages, static_cast<unsigned long long>(graphStats.transientMemory),
+				static_cast<unsigned long long>(graphStats.aliasedMemory));
+		}
 
-		VkDescriptorImageInfo imageInfo = m_CurrentTexture->getDescriptorImageInfo();
+		if (measuredFrames >= BENCHMARK_MEASURED_FRAMES)
+			m_App->getWindow()->close();
+	}
 
-		VkWriteDescriptorSet descriptorWrite{};
-		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrite.dstSet = descriptorSet;
-		descriptorWrite.dstBinding = binding;
-		descriptorWrite.dstArrayElement = 0;
-		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptorWrite.descriptorCount = 1;
-		descriptorWrite.pImageInfo = &imageInfo;
+	// Left click logs the instance under the cursor
+	void Engine::pickInstance()
+	{
+		bool buttonDown = glfwGetMouseButton(m_App->getWindow()->getWindowGLFW(), GLFW_MOUSE_BUTTON_1) == GLFW_PRESS;
+		bool clicked = buttonDown && !m_PickButtonDown;
+		m_PickButtonDown = buttonDown;
+		if (!clicked)
+			return;
 
-		vkUpdateDescriptorSets(VulkanContext::getDevice(), 1, &descriptorWrite, 0, nullptr);
+		if (std::optional<RayHit> hit = m_SceneBvh->raycast(m_Camera->GetCursorRay()))
+			ENGINE_INFO("Picked instance %u at distance %.2f", hit->object, hit->distance);
 	}
+
 	void Engine::modelInit()
 	{
 		Shared<Texture2D> modelTexture = CreateShared<Texture2D>(TEXTURE_PATH, true);
@@ -332,6 +408,9 @@ namespace vkEngine
 				indices.push_back(uniqueVertices[vertex]);
 			}
 		}
+
+		m_ModelMatrix = glm::rotate(glm::mat4(1.0f), 90.f, glm::vec3(0, 0, 1));
+		m_ModelMatrix = glm::rotate(m_ModelMatrix, glm::cos(0.f), glm::vec3(0, 1, 0));
 	}
 	void Engine::initUniformBuffer()
 	{
@@ -345,213 +424,176 @@ namespace vkEngine
 		}
 	}
 
+	void Engine::initInstanceBuffers()
+	{
+		uint32_t capacity = std::max(InstanceBuffer::s_DefaultCapacity, m_App->getOptions().benchmarkInstances);
+
+		m_InstanceBuffers.resize(s_MaxFramesInFlight);
+		for (size_t i = 0; i < s_MaxFramesInFlight; i++)
+		{
+			m_InstanceBuffers[i] = CreateShared<InstanceBuffer>(capacity);
+		}
+	}
+
+	void Engine::initInstances()
+	{
+		uint32_t count = m_App->getOptions().benchmarkInstances;
+		if (count == 0)
+		{
+			m_Instances = { InstanceData{ m_ModelMatrix, m_CurrentTexture->getBindlessIndex() } };
+			return;
+		}
+
+		// Square grid of model copies centered on the origin, alternating between the test textures
+		const float spacing = 1.5f;
+		uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(count))));
+		float halfExtent = (side - 1) * spacing * 0.5f;
+
+		m_Instances.reserve(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			glm::vec3 offset{ (i % side) * spacing - halfExtent, 0.0f, (i / side) * spacing - halfExtent };
+			const Shared<Texture2D>& texture = i % 2 ? m_TextureTest2 : m_TextureTest;
+			m_Instances.push_back(InstanceData{ glm::translate(glm::mat4(1.0f), offset) * m_ModelMatrix, texture->getBindlessIndex() });
+		}
+	}
+
+	void Engine::initSceneBvh()
+	{
+		m_ThreadPool = CreateScoped<ThreadPool>();
+		m_SceneBvh = CreateScoped<BoundingVolumeHierarchy>(m_ThreadPool.get());
+
+		m_InstanceBounds.clear();
+		m_InstanceBounds.reserve(m_Instances.size());
+		for (const InstanceData& instance : m_Instances)
+		{
+			m_InstanceBounds.push_back(getInstanceBounds(instance, m_Mesh.boundingSphere));
+		}
+
+		Timer timer("SceneBvh");
+		timer.Start();
+		m_SceneBvh->build(m_InstanceBounds);
+		timer.Stop();
+		ENGINE_INFO("Scene BVH: %u instances, %zu nodes, built in %.2f ms", m_SceneBvh->getObjectCount(), m_SceneBvh->getNodes().size(), timer.GetTimeMilliseconds());
+	}
+
 	void Engine::initTextureImage()
 	{
 		m_TextureTest = CreateShared<Texture2D>("assets/textures/viking_room.png", VK_SAMPLE_COUNT_1_BIT, true);
 		m_TextureTest2 = CreateShared<Texture2D>("assets/textures/brick_wall.jpg", VK_SAMPLE_COUNT_1_BIT, true);
+		m_CurrentTexture = m_TextureTest;
 	}
 
 	void Engine::updateUniformBuffer(uint32_t currentFrame, Timestep deltaTime)
 	{
 		UniformBufferObject ubo{};
 
-		float time = CurrentTime::GetCurrentTimeInSec();
-
 		//ENGINE_INFO(std::string("Camera pos " + glm::to_string(m_Camera->GetPosition())).c_str());
 
-		glm::mat4 modelMat = glm::mat4(1.0f);
-
-		modelMat = glm::rotate(modelMat, 90.f, glm::vec3(0, 0, 1));
+		glm::mat4 projMat = m_Camera->GetProjectionMatrix();
+		projMat[1][1] *= -1;
 
-		ubo.modelMat = glm::rotate(modelMat, glm::cos(0.f), glm::vec3(0, 1, 0));
-		ubo.viewMat = m_Camera->GetViewMatrix();
-		ubo.projMat = m_Camera->GetProjectionMatrix();
-		ubo.projMat[1][1] *= -1;
+		// Combined once here instead of per vertex, model matrices come with each draw
+		ubo.viewProjMat = projMat * m_Camera->GetViewMatrix();
+		m_ViewProjection = ubo.viewProjMat;
 
 		memcpy(m_UniformBuffers[currentFrame]->getMappedMemory(), &ubo, sizeof(ubo));
 	}
 
 	void Engine::initGraphicsPipeline()
 	{
-		auto vertShaderCode = readFile("shaders/bin/defaultShader.vert.spv");
-		auto fragShaderCode = readFile("shaders/bin/defaultShader.frag.spv");
+		GraphicsPipelineConfig config =
+		{
+			.vertexShaderPath = m_UseVertexPulling ? VERTEX_PULLING_SHADER : DEFAULT_VERTEX_SHADER,
+			.fragmentShaderPath = DEFAULT_FRAGMENT_SHADER,
+			.renderPass = m_RenderPass,
+			.subpass = 0,
+			.colorFormats = { VulkanContext::getSwapchain()->getImagesFormat() },
+			.depthFormat = VulkanContext::getSwapchain()->getDepthBuffer()->getFormat(),
+			.sampleCount = VulkanContext::getSwapchain()->getDepthBuffer()->getConfig().sampleCount,
+			// Model vertices are all white, the variant without vertex color skips the multiply
+			.specializationConstants = { { "USE_TEXTURE", VK_TRUE }, { "USE_VERTEX_COLOR", VK_FALSE } }
+		};
 
-		VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-		VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+		m_GraphicsPipelineConfig = config;
+		m_GraphicsPipeline = m_PipelineCache.getPipeline(config);
+		ENGINE_ASSERT(m_GraphicsPipeline->getLayout() == m_PipelineLayout, "Graphics pipeline layout does not match the descriptor layout");
+	}
 
-		VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-		vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-		vertShaderStageInfo.module = vertShaderModule;
-		vertShaderStageInfo.pName = "main";
-		vertShaderStageInfo.pSpecializationInfo = nullptr; // possible constant values
+	void Engine::initShaderHotReload()
+	{
+		if (!DEBUG_BUILD_CONFIGURATION)
+			return;
 
-		VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-		fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		fragShaderStageInfo.module = fragShaderModule;
-		fragShaderStageInfo.pName = "main";
-		fragShaderStageInfo.pSpecializationInfo = nullptr; // possible constant values
+		m_ShaderHotReloader = CreateScoped<ShaderHotReloader>(SHADER_SOURCE_DIR, SHADER_BINARY_DIR);
+	}
 
-		VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+	void Engine::processShaderReloads()
+	{
+		using namespace std::chrono_literals;
 
-		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		// Swap in finished pipelines at the frame boundary, frames still in flight keep using the old ones until they are retired
+		if (m_PendingPipelines.valid() && m_PendingPipelines.wait_for(0s) == std::future_status::ready)
+		{
+			for (auto& reloadedPipeline : m_PendingPipelines.get())
+			{
+				Shared<GraphicsPipeline> currentPipeline = m_PipelineCache.getPipeline(reloadedPipeline->getConfig());
 
-		auto bindingDescription = Vertex::getBindingDescription();
-		auto attributeDescriptions = Vertex::getAttributeDescriptions();
+				// Descriptor sets were allocated for the current layout, a shader that changed its interface needs a restart
+				if (reloadedPipeline->getLayout() != currentPipeline->getLayout())
+				{
+					ENGINE_WARN("Reloaded shaders changed the pipeline layout of %s, keeping the previous pipeline", reloadedPipeline->getConfig().vertexShaderPath.c_str());
+					continue;
+				}
 
-		vertexInputInfo.vertexBindingDescriptionCount = 1;
-		vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-		vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+				Shared<GraphicsPipeline> retiredPipeline = m_PipelineCache.replace(std::move(reloadedPipeline));
+				m_DeletionQueue.push(m_FrameNumber, [retiredPipeline]() mutable { retiredPipeline.reset(); });
+			}
 
-		std::vector<VkDynamicState> dynamicStates = {
-			VK_DYNAMIC_STATE_VIEWPORT,
-			VK_DYNAMIC_STATE_SCISSOR
-		};
+			m_GraphicsPipeline = m_PipelineCache.getPipeline(m_GraphicsPipeline->getConfig());
+			ENGINE_INFO("Graphics pipelines reloaded");
+		}
 
-		VkPipelineDynamicStateCreateInfo dynamicState{};
-		dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-		dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-		dynamicState.pDynamicStates = dynamicStates.data();
+		if (!m_ShaderHotReloader)
+			return;
 
-		VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-		inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-		inputAssembly.primitiveRestartEnable = VK_FALSE;
+		for (auto& spirvPath : m_ShaderHotReloader->pollRecompiledShaders())
+		{
+			m_ReloadedShaders.push_back(std::move(spirvPath));
+		}
 
-		VkExtent2D swapchainExtent = VulkanContext::getSwapchain()->getExtent();
-		VkViewport viewport{};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = static_cast<float>(swapchainExtent.width);
-		viewport.height = static_cast<float>(swapchainExtent.height);
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
+		if (m_ReloadedShaders.empty() || m_PendingPipelines.valid())
+			return;
 
-		VkRect2D scissor{};
-		scissor.offset = { 0, 0 };
-		scissor.extent = swapchainExtent;
+		// Every cached variant built from a changed shader is rebuilt
+		std::vector<GraphicsPipelineConfig> configs;
+		for (const auto& spirvPath : m_ReloadedShaders)
+		{
+			for (auto& config : m_PipelineCache.getConfigsUsingShader(spirvPath))
+			{
+				if (std::find(configs.begin(), configs.end(), config) == configs.end())
+					configs.push_back(std::move(config));
+			}
+		}
+		m_ReloadedShaders.clear();
 
-		VkPipelineViewportStateCreateInfo viewportState{};
-		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-		viewportState.viewportCount = 1;
-		viewportState.scissorCount = 1;
-		viewportState.pViewports = &viewport;
-		viewportState.pScissors = &scissor;
-
-		VkPipelineRasterizationStateCreateInfo rasterizer{};
-		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-		rasterizer.depthClampEnable = VK_FALSE; // Discarding or clamping vertices that are outside of planes. Needs a GPU feature enabled
-		rasterizer.rasterizerDiscardEnable = VK_FALSE; // Disables geometry ability to pass through rasterizer stage(basically disables output)
-		rasterizer.polygonMode = VK_POLYGON_MODE_FILL; // How fragments are generated
-		rasterizer.lineWidth = 1.0f;
-		rasterizer.cullMode = VK_CULL_MODE_NONE; // Culling side
-		rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-		rasterizer.depthBiasEnable = VK_FALSE; // Bias for shadow mapping
-
-		VkPipelineMultisampleStateCreateInfo multisampling{};
-		multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-		multisampling.sampleShadingEnable = VK_FALSE;
-		multisampling.rasterizationSamples = VulkanContext::getSwapchain()->getMSAABuffer()->getConfig().sampleCount;
-
-
-		VkPipelineDepthStencilStateCreateInfo depthStencil{};
-		depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-		depthStencil.depthTestEnable = VK_TRUE;
-		depthStencil.depthWriteEnable = VK_TRUE;
-		depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-		depthStencil.depthBoundsTestEnable = VK_FALSE;
-		depthStencil.minDepthBounds = 0.0f; // Optional
-		depthStencil.maxDepthBounds = 1.0f; // Optional
-		depthStencil.stencilTestEnable = VK_FALSE;
-		depthStencil.front = {}; // Optional
-		depthStencil.back = {}; // Optional
-
-		VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-		colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-		colorBlendAttachment.blendEnable = VK_FALSE;
-		colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-		colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-		colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-		colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-		colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-		colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-
-		VkPipelineColorBlendStateCreateInfo colorBlending{};
-		colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-		colorBlending.logicOpEnable = VK_FALSE;
-		colorBlending.logicOp = VK_LOGIC_OP_COPY; // Optional
-		colorBlending.attachmentCount = 1;
-		colorBlending.pAttachments = &colorBlendAttachment;
-		colorBlending.blendConstants[0] = 0.0f; // Optional
-		colorBlending.blendConstants[1] = 0.0f; // Optional
-		colorBlending.blendConstants[2] = 0.0f; // Optional
-		colorBlending.blendConstants[3] = 0.0f; // Optional
-
-		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = 1;
-		pipelineLayoutInfo.pSetLayouts = &m_DescriptorSetLayout;
-		pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-		pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
-
-		ENGINE_ASSERT(vkCreatePipelineLayout(VulkanContext::getDevice(), &pipelineLayoutInfo, nullptr, &m_PipelineLayout) == VK_SUCCESS, "Pipeline layout creation failed");
-
-		VkGraphicsPipelineCreateInfo pipelineInfo{};
-		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-		pipelineInfo.stageCount = 2;
-		pipelineInfo.pStages = shaderStages;
-
-		pipelineInfo.pVertexInputState = &vertexInputInfo;
-		pipelineInfo.pInputAssemblyState = &inputAssembly;
-		pipelineInfo.pViewportState = &viewportState;
-		pipelineInfo.pRasterizationState = &rasterizer;
-		pipelineInfo.pMultisampleState = &multisampling;
-		pipelineInfo.pDepthStencilState = &depthStencil;
-		pipelineInfo.pColorBlendState = &colorBlending;
-		pipelineInfo.pDynamicState = &dynamicState;
-
-		pipelineInfo.layout = m_PipelineLayout;
-		pipelineInfo.renderPass = m_RenderPass;
-		pipelineInfo.subpass = 0;
-
-		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
-		pipelineInfo.basePipelineIndex = -1; // Optional
-
-		ENGINE_ASSERT(vkCreateGraphicsPipelines(VulkanContext::getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_GraphicsPipeline) == VK_SUCCESS, "Pipeline creation failed");
-
-		vkDestroyShaderModule(VulkanContext::getDevice(), fragShaderModule, nullptr);
-		vkDestroyShaderModule(VulkanContext::getDevice(), vertShaderModule, nullptr);
-	}
-
-	std::vector<char> Engine::readFile(const std::string& filename)
-	{
-		std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-		ENGINE_ASSERT(file.is_open(), (std::string("Failed to open file at this path: ") + filename).c_str());
-
-		size_t fileSize = (size_t)file.tellg();
-		std::vector<char> buffer(fileSize);
-
-		file.seekg(0);
-		file.read(buffer.data(), fileSize);
-		file.close();
-
-		return buffer;
-	}
-
-	VkShaderModule Engine::createShaderModule(const std::vector<char>& code)
-	{
-		VkShaderModuleCreateInfo moduleInfo{};
-		moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-		moduleInfo.codeSize = code.size();
+		if (configs.empty())
+			return;
 
-		VkShaderModule shaderModule{};
-		ENGINE_ASSERT(vkCreateShaderModule(VulkanContext::getDevice(), &moduleInfo, nullptr, &shaderModule) == VK_SUCCESS, "Shader module creation failed")
-			return shaderModule;
+		m_PendingPipelines = std::async(std::launch::async, [configs = std::move(configs)]()
+			{
+				// A pipeline that fails to build is left out, its variant keeps the previous pipeline until the next edit
+				std::vector<Scoped<GraphicsPipeline>> pipelines;
+				for (const auto& config : configs)
+				{
+					Scoped<GraphicsPipeline> pipeline = GraphicsPipeline::tryCreate(config);
+					if (pipeline)
+						pipelines.push_back(std::move(pipeline));
+					else
+						ENGINE_WARN("Failed to rebuild the pipeline of %s and %s, keeping the previous one", config.vertexShaderPath.c_str(), config.fragmentShaderPath.c_str());
+				}
+				return pipelines;
+			});
 	}
 
 	void Engine::initRenderPass()
@@ -560,7 +602,7 @@ namespace vkEngine
 		colorAttachment.format = VulkanContext::getSwapchain()->getImagesFormat();
 		colorAttachment.samples = VulkanContext::getSwapchain()->getMSAABuffer()->getConfig().sampleCount;
 		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR; //what to do with framebuffer before rendering
-		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;//after
+		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE; // Resolved into the swapchain image, the samples stay transient
 		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -651,6 +693,60 @@ namespace vkEngine
 		vkBindBufferMemory(VulkanContext::getDevice(), buffer, bufferMemory, 0);
 	}
 
+	void Engine::initGeometry()
+	{
+		// Every level of detail is uploaded after the previous one with its triangles in meshlet order, so each meshlet is a
+		// range of the index buffer
+		Timer timer("Geometry");
+		timer.Start();
+		MeshLodChain lodChain = MeshLodChain::build(vertices, indices);
+		std::vector<MeshletMesh> levelMeshlets;
+		indices.clear();
+		for (const MeshLod& level : lodChain.levels)
+		{
+			std::vector<uint32_t> levelIndices(lodChain.indices.begin() + level.firstIndex, lodChain.indices.begin() + level.firstIndex + level.indexCount);
+			levelMeshlets.push_back(MeshletMesh::build(vertices, levelIndices));
+			indices.insert(indices.end(), levelMeshlets.back().indices.begin(), levelMeshlets.back().indices.end());
+		}
+		// Two sided like the rasterizer, the simplification may let it hide a little more than the model would
+		const MeshLod& coarsestLevel = lodChain.levels.back();
+		m_OccluderMesh = createOccluderMesh(vertices, std::vector<uint32_t>(lodChain.indices.begin() + coarsestLevel.firstIndex,
+			lodChain.indices.begin() + coarsestLevel.firstIndex + coarsestLevel.indexCount));
+		timer.Stop();
+		ENGINE_INFO("Model: %zu levels of detail, built in %.2f ms", lodChain.levels.size(), timer.GetTimeMilliseconds());
+
+		if (!m_UseVertexPulling)
+		{
+			initVertexBuffer();
+			initIndexBuffer();
+			m_Mesh = { 0, static_cast<uint32_t>(vertices.size()), 0, static_cast<uint32_t>(indices.size()), GeometryPool::computeBoundingSphere(vertices) };
+		}
+		else
+		{
+			m_GeometryPool = CreateScoped<GeometryPool>();
+			m_Mesh = m_GeometryPool->addMesh(vertices, indices);
+		}
+
+		m_MeshLods = lodChain.levels;
+		uint32_t firstIndex = 0;
+		for (size_t i = 0; i < m_MeshLods.size(); i++)
+		{
+			MeshLod& level = m_MeshLods[i];
+			level.firstIndex = firstIndex;
+			firstIndex += level.indexCount;
+
+			MeshAllocation levelMesh = m_Mesh;
+			levelMesh.firstIndex = m_Mesh.firstIndex + level.firstIndex;
+			levelMesh.indexCount = level.indexCount;
+			levelMesh.lodSphere = m_Mesh.boundingSphere;
+			levelMesh.lodErrors = { level.error, i + 1 < m_MeshLods.size() ? m_MeshLods[i + 1].error : FLT_MAX };
+			m_LodMeshlets.push_back(levelMeshlets[i].getAllocations(levelMesh));
+			m_Meshlets.insert(m_Meshlets.end(), m_LodMeshlets.back().begin(), m_LodMeshlets.back().end());
+			ENGINE_INFO("Model LOD %zu: %u triangles in %zu meshlets, error %.4f", i, level.indexCount / 3, m_LodMeshlets.back().size(), level.error);
+		}
+		m_LodInstances.resize(m_MeshLods.size());
+	}
+
 	void Engine::initVertexBuffer()
 	{
 		m_VertexBuffer = CreateScoped<VertexBuffer>(vertices);
@@ -669,33 +765,107 @@ namespace vkEngine
 		beginInfo.pInheritanceInfo = nullptr; // Optional
 
 		ENGINE_ASSERT(vkBeginCommandBuffer(commandBuffer, &beginInfo) == VK_SUCCESS, "Beginning of command buffer failed");
+		DescriptorBinding::beginCommandBuffer(commandBuffer);
+		// Graphics state goes through the list, the compute passes bind their own state on the raw command buffer
+		CommandList commandList(commandBuffer);
 
-		VkExtent2D swapchainExtent = VulkanContext::getSwapchain()->getExtent();
-
-		VkRenderPassBeginInfo renderPassInfo{};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = m_RenderPass;
-		renderPassInfo.framebuffer = VulkanContext::getSwapchain()->getFramebuffer(imageIndex);
-		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = swapchainExtent;
+		float lodErrorScale = MeshLodChain::getErrorScale(m_Camera->GetFieldOfView(), static_cast<float>(VulkanContext::getSwapchain()->getExtent().height), LOD_PIXEL_ERROR);
+		submitModelInstances(lodErrorScale);
+		m_DrawBatcher->build(m_InstanceCuller->isCulling(), m_InstanceCuller->getPassCount());
 
-		//VkClearValue clearColor = { {{0.850f, 0.796f, 0.937f, 1.0f}} };
-		std::array<VkClearValue, 2> clearValues{};
-		clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
-		clearValues[1].depthStencil = { 1.0f, 0 };
+		if (m_UseDynamicRendering)
+		{
+			buildRenderGraph(imageIndex, lodErrorScale);
+			m_RenderGraph->compile(m_FrameNumber);
+			m_RenderGraph->execute(commandList);
+		}
+		else
+		{
+			// The render pass draws the frame in a single pass and transitions its attachments itself
+			m_InstanceCuller->record(commandBuffer, *m_DrawBatcher, m_ViewProjection, m_Camera->GetPosition(), lodErrorScale);
+			beginRenderPass(commandBuffer, imageIndex);
+			recordDrawPass(commandList, InstanceCuller::EarlyPass);
+			vkCmdEndRenderPass(commandBuffer);
+		}
 
-		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-		renderPassInfo.pClearValues = clearValues.data();
+		ENGINE_ASSERT(vkEndCommandBuffer(commandBuffer) == VK_SUCCESS, "Ending of command buffer failed");
+		m_CommandListStats = commandList.getStats();
+	}
 
-		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE); //Last parameter is about execution of primary buffers
+	// Culling runs before the early pass and writes the instance counts the batches are drawn with. With occlusion culling,
+	// what the previous frame's depth hid is tested again against the depth pyramid of this frame's early pass, and drawn on
+	// top if visible. The pyramid is then rebuilt from the complete depth for the next frame. The multisampled color is
+	// resolved straight into the swapchain image by the last draw pass
+	void Engine::buildRenderGraph(uint32_t imageIndex, float lodErrorScale)
+	{
+		RenderGraph& graph = *m_RenderGraph;
+		graph.begin();
 
-		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline); // Second parameter is about pipeline how it will be used
+		auto& swapchain = VulkanContext::getSwapchain();
+		VkExtent2D extent = swapchain->getExtent();
+		const Scoped<DepthImage>& depthBuffer = swapchain->getDepthBuffer();
+		VkSampleCountFlagBits sampleCount = depthBuffer->getConfig().sampleCount;
+		bool multisampled = sampleCount != VK_SAMPLE_COUNT_1_BIT;
+		bool occlusionCulling = m_InstanceCuller->isOcclusionCulling();
+
+		// Attachments are cleared every frame, so they start out undefined once the previous frame is done writing them.
+		// The swapchain image becomes writable at the acquire semaphore's wait stage
+		RenderGraphImage backbuffer = graph.importImage("Backbuffer", swapchain->getImage(imageIndex), swapchain->getImageView(imageIndex),
+			{ extent, swapchain->getImagesFormat() },
+			{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0 },
+			{ VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0 });
+		RenderGraphImage depth = graph.importImage("Depth", depthBuffer->getImage(), depthBuffer->getImageView(),
+			{ extent, depthBuffer->getFormat(), depthBuffer->getConfig().sampleCount },
+			{ VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT });
+		// Nothing outside the draw passes uses the multisampled color, the graph owns it
+		RenderGraphImage color = multisampled ? graph.createImage("Multisampled color", { extent, swapchain->getImagesFormat(), sampleCount }) : backbuffer;
+
+		RenderGraphPass& earlyCull = graph.addPass("Early cull", RenderGraphPassType::Compute)
+			.setSideEffects()
+			.setExecute([this, lodErrorScale](CommandList& list) { m_InstanceCuller->record(list.getCommandBuffer(), *m_DrawBatcher, m_ViewProjection, m_Camera->GetPosition(), lodErrorScale); });
+
+		// Without occlusion culling the early pass draws everything visible and resolves
+		graph.addPass("Early draw", RenderGraphPassType::Graphics)
+			.writeColor(color, VK_ATTACHMENT_LOAD_OP_CLEAR, CLEAR_COLOR, multisampled && !occlusionCulling ? backbuffer : RenderGraphPass::s_NoImage)
+			.writeDepth(depth, VK_ATTACHMENT_LOAD_OP_CLEAR)
+			.setExecute([this](CommandList& list) { recordDrawPass(list, InstanceCuller::EarlyPass); });
+
+		if (!occlusionCulling)
+			return;
 
-		VkBuffer vertexBuffers[] = { m_VertexBuffer->getBuffer() };
-		VkDeviceSize offsets[] = { 0 };
+		// The pyramid is the next frame's occlusion history, it stays in GENERAL with its last reduction still to be made visible
+		const Image2D& pyramidImage = m_DepthPyramid->getImage();
+		RenderGraphImage pyramid = graph.importImage("Depth pyramid", pyramidImage.getImage(), pyramidImage.getImageView(),
+			{ pyramidImage.getExtent(), pyramidImage.getFormat(), VK_SAMPLE_COUNT_1_BIT, m_DepthPyramid->getLevelCount() },
+			{ VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT },
+			{ VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT });
+		earlyCull.readStorage(pyramid);
+
+		graph.addPass("Depth pyramid", RenderGraphPassType::Compute)
+			.sample(depth)
+			.writeStorage(pyramid)
+			.setExecute([this](CommandList& list) { m_DepthPyramid->record(list.getCommandBuffer()); });
+
+		graph.addPass("Late cull", RenderGraphPassType::Compute)
+			.setSideEffects()
+			.readStorage(pyramid)
+			.setExecute([this](CommandList& list) { m_InstanceCuller->recordLate(list.getCommandBuffer()); });
+
+		graph.addPass("Late draw", RenderGraphPassType::Graphics)
+			.writeColor(color, VK_ATTACHMENT_LOAD_OP_LOAD, {}, multisampled ? backbuffer : RenderGraphPass::s_NoImage)
+			.writeDepth(depth, VK_ATTACHMENT_LOAD_OP_LOAD)
+			.setExecute([this](CommandList& list) { recordDrawPass(list, InstanceCuller::LatePass); });
+
+		// Rebuilt from the finished depth, what the late pass drew occludes in the next frame's early pass as well
+		graph.addPass("History depth pyramid", RenderGraphPassType::Compute)
+			.sample(depth)
+			.writeStorage(pyramid)
+			.setExecute([this](CommandList& list) { m_DepthPyramid->record(list.getCommandBuffer()); });
+	}
 
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-		vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+	void Engine::recordDrawPass(CommandList& commandList, uint32_t pass)
+	{
+		VkExtent2D swapchainExtent = VulkanContext::getSwapchain()->getExtent();
 
 		VkViewport viewport{};
 		viewport.x = 0.0f;
@@ -704,30 +874,151 @@ namespace vkEngine
 		viewport.height = static_cast<float>(swapchainExtent.height);
 		viewport.minDepth = 0.0f;
 		viewport.maxDepth = 1.0f;
-		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		commandList.setViewport(viewport);
 
 		VkRect2D scissor{};
 		scissor.offset = { 0, 0 };
 		scissor.extent = swapchainExtent;
-		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+		commandList.setScissor(scissor);
+
+		commandList.bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, m_DescriptorSets[currentFrame]);
+		VulkanContext::getBindlessRegistry()->bind(commandList, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout);
 
-		vkCmdBindDescriptorSets
-		(
-			commandBuffer,
-			VK_PIPELINE_BIND_POINT_GRAPHICS,
-			m_PipelineLayout,
-			0,
-			1,
-			&m_DescriptorSets[currentFrame],
-			0,
-			nullptr
-		);
+		m_DrawBatcher->record(commandList, [this](CommandList& list, const DrawBatch& batch) { bindDrawBatch(list, batch); }, pass);
+	}
+
+	// The cull pass picks every instance's level of detail. Without it the levels are picked here, each level then draws
+	// only the instances picking it
+	void Engine::submitModelInstances(float lodErrorScale)
+	{
+		if (m_InstanceCuller->isCulling())
+		{
+			submitMeshInstances(m_Meshlets, m_Instances);
+			return;
+		}
 
-		vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+		// Without GPU culling the instances are culled here, against the frustum through the scene BVH, then against the
+		// nearest instances in view
+		m_ViewInstances.clear();
+		m_SceneBvh->cullFrustum(Frustum::fromViewProjection(m_ViewProjection), m_ViewInstances);
+		m_CpuCullStats.culled = static_cast<uint32_t>(m_Instances.size() - m_ViewInstances.size());
+		cullOccludedInstances();
+		m_CpuCullStats.visible = static_cast<uint32_t>(m_ViewInstances.size());
 
-		vkCmdEndRenderPass(commandBuffer);
+		for (std::vector<InstanceData>& levelInstances : m_LodInstances)
+		{
+			levelInstances.clear();
+		}
 
-		ENGINE_ASSERT(vkEndCommandBuffer(commandBuffer) == VK_SUCCESS, "Ending of command buffer failed");
+		const glm::vec3& cameraPosition = m_Camera->GetPosition();
+		for (uint32_t index : m_ViewInstances)
+		{
+			const InstanceData& instance = m_Instances[index];
+			glm::vec3 center{ instance.modelMat * glm::vec4(glm::vec3(m_Mesh.boundingSphere), 1.0f) };
+			float scale = getInstanceScale(instance);
+			float distance = std::max(glm::length(center - cameraPosition) - m_Mesh.boundingSphere.w * scale, 0.0f);
+			m_LodInstances[MeshLodChain::selectLevel(m_MeshLods, distance, lodErrorScale * scale)].push_back(instance);
+		}
+
+		for (size_t i = 0; i < m_LodInstances.size(); i++)
+		{
+			submitMeshInstances(m_LodMeshlets[i], m_LodInstances[i]);
+		}
+	}
+
+	// Rasterizes the instances in view nearest to the camera as occluders and drops the view instances whose bounds they hide
+	void Engine::cullOccludedInstances()
+	{
+		const glm::vec3& cameraPosition = m_Camera->GetPosition();
+		auto nearer = [this, &cameraPosition](uint32_t a, uint32_t b)
+		{
+			glm::vec3 toA = m_InstanceBounds[a].getCenter() - cameraPosition, toB = m_InstanceBounds[b].getCenter() - cameraPosition;
+			return glm::dot(toA, toA) < glm::dot(toB, toB);
+		};
+		size_t occluderCount = std::min(CPU_OCCLUDER_COUNT, m_ViewInstances.size());
+		std::partial_sort(m_ViewInstances.begin(), m_ViewInstances.begin() + occluderCount, m_ViewInstances.end(), nearer);
+
+		m_OcclusionRasterizer->begin(m_ViewProjection);
+		for (size_t i = 0; i < occluderCount; i++)
+		{
+			m_OcclusionRasterizer->addOccluder(m_OccluderMesh, m_Instances[m_ViewInstances[i]].modelMat);
+		}
+		m_OcclusionRasterizer->rasterize();
+
+		m_ViewInstanceBounds.clear();
+		for (uint32_t index : m_ViewInstances)
+		{
+			m_ViewInstanceBounds.push_back(m_InstanceBounds[index]);
+		}
+		m_OcclusionRasterizer->testBoxes(m_ViewInstanceBounds, m_ViewInstanceVisibility);
+
+		size_t visibleCount = 0;
+		for (size_t i = 0; i < m_ViewInstances.size(); i++)
+		{
+			if (m_ViewInstanceVisibility[i])
+				m_ViewInstances[visibleCount++] = m_ViewInstances[i];
+		}
+		m_CpuCullStats.occluded = static_cast<uint32_t>(m_ViewInstances.size() - visibleCount);
+		m_ViewInstances.resize(visibleCount);
+	}
+
+	// Every instance in one draw per meshlet, their data goes to this frame's instance buffer once and the cull pass lists
+	// the visible ones of each meshlet. The draws are sorted into batches of the same pipeline and geometry, front to back
+	// by the meshlet's distance under the first instance, nothing is recorded until the batches are.
+	void Engine::submitMeshInstances(const std::vector<MeshAllocation>& meshlets, const std::vector<InstanceData>& instances)
+	{
+		if (instances.empty())
+			return;
+
+		uint32_t firstInstance = m_InstanceBuffers[currentFrame]->push(instances);
+		const void* geometry = m_UseVertexPulling ? static_cast<const void*>(m_GeometryPool.get()) : static_cast<const void*>(m_VertexBuffer.get());
+		const glm::vec3& cameraPosition = m_Camera->GetPosition();
+		float farPlane = m_Camera->GetNearFar().y;
+		for (const MeshAllocation& meshlet : meshlets)
+		{
+			DrawSortInfo sortInfo{};
+			glm::vec3 center{ instances.front().modelMat * glm::vec4(glm::vec3(meshlet.boundingSphere), 1.0f) };
+			sortInfo.depth = glm::length(center - cameraPosition) / farPlane;
+			m_DrawBatcher->add(m_GraphicsPipeline.get(), geometry, !m_UseVertexPulling, m_GraphicsPipelineConfig.cullMode, meshlet, firstInstance,
+				static_cast<uint32_t>(instances.size()), sortInfo);
+		}
+	}
+
+	void Engine::bindDrawBatch(CommandList& commandList, const DrawBatch& batch)
+	{
+		batch.pipeline->bind(commandList, m_GraphicsPipelineConfig);
+
+		// Pulled geometry is reached through the pushed pool addresses
+		if (m_UseVertexPulling)
+		{
+			const VkPushConstantRange& drawRange = m_PipelineLayoutInfo.pushConstantRanges[0];
+			DrawPushConstants draw{ m_GeometryPool->getVertexAddress(), m_GeometryPool->getIndexAddress() };
+			commandList.pushConstants(m_PipelineLayout, drawRange.stageFlags, drawRange.offset, sizeof(draw), &draw);
+			return;
+		}
+
+		commandList.bindVertexBuffer(0, m_VertexBuffer->getBuffer(), 0);
+		commandList.bindIndexBuffer(m_IndexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+	}
+
+	void Engine::beginRenderPass(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+	{
+		auto& swapchain = VulkanContext::getSwapchain();
+
+		std::array<VkClearValue, 2> clearValues{};
+		clearValues[0].color = CLEAR_COLOR;
+		clearValues[1].depthStencil = { 1.0f, 0 };
+
+		VkRenderPassBeginInfo renderPassInfo{};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = m_RenderPass;
+		renderPassInfo.framebuffer = swapchain->getFramebuffer(imageIndex);
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = swapchain->getExtent();
+		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+		renderPassInfo.pClearValues = clearValues.data();
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE); //Last parameter is about execution of primary buffers
 	}
 
 	void Engine::initSyncObjects()
@@ -5,18 +5,54 @@
 #include <glm/glm.hpp>
 
 #include "TimeHelper.h"
+#include "CommandList.h"
 #include "Camera/Camera.h"
 #include "Buffers/Buffer.h"
 #include "Buffers/UniformBuffer.h"
+#include "Buffers/GeometryPool.h"
+#include "Buffers/InstanceBuffer.h"
+#include "Culling/BoundingVolumeHierarchy.h"
+#include "Culling/OcclusionRasterizer.h"
 #include "Images/Texture2D.h"
+#include "Pipeline/GraphicsPipelineCache.h"
+#include "Pipeline/PipelineLayoutCache.h"
+#include "Descriptors/DescriptorSetCache.h"
+#include "Descriptors/DescriptorBinding.h"
+#include "Renderer/DepthPyramid.h"
+#include "Renderer/DrawBatcher.h"
+#include "Renderer/InstanceCuller.h"
+#include "Renderer/Meshlet.h"
+#include "Renderer/MeshLod.h"
+#include "Renderer/RenderGraph.h"
+#include "Shaders/ShaderHotReloader.h"
+#include "Utility/DeletionQueue.h"
+#include "Utility/ThreadPool.h"
+
+#include <future>
 
 namespace vkEngine
 {
+	// Per frame data, written once per frame and shared by every draw
 	struct UniformBufferObject
 	{
-		glm::mat4 modelMat;
-		glm::mat4 viewMat;
-		glm::mat4 projMat;
+		glm::mat4 viewProjMat;
+	};
+
+	// Geometry addresses pushed with each draw, only declared by the vertex pulling shader.
+	// Transforms and texture indices are per instance, see InstanceData.
+	struct DrawPushConstants
+	{
+		VkDeviceAddress vertexAddress;
+		VkDeviceAddress indexAddress;
+	};
+
+	// Startup options, filled from the command line
+	struct EngineOptions
+	{
+		uint32_t benchmarkInstances = 0; // Renders a grid of this many model instances and logs frame times, 0 renders the single model
+		uint32_t cullBenchmarkObjects = 0; // Times CPU frustum culling of this many objects and exits, see runCullingBenchmark
+		uint32_t occlusionBenchmarkOccluders = 0; // Times the CPU occlusion rasterizer with this many occluders and exits, see runOcclusionBenchmark
+		uint32_t renderQueueBenchmarkKeys = 0; // Times the draw key sort with this many keys and exits, see runRenderQueueBenchmark
 	};
 
 	class Application;
@@ -30,7 +66,7 @@ namespace vkEngine
 		const Application* getApp() const { return m_App; };
 	public:
 		static const uint32_t s_MaxFramesInFlight = 3;
-		VkRenderPass m_RenderPass{ VK_NULL_HANDLE };
+		VkRenderPass m_RenderPass{ VK_NULL_HANDLE }; // Stays null when dynamic rendering is used
 		const Shared<Instance>& getInstance() const { return m_Instance; };
 	private:
 		void update(Timestep deltaTime);
@@ -48,37 +84,56 @@ namespace vkEngine
 		void initVulkan();
 
 		void initGraphicsPipeline();
-		static std::vector<char> readFile(const std::string& filename);
-		VkShaderModule createShaderModule(const std::vector<char>& code);
+		void initShaderHotReload();
+		void processShaderReloads();
 
 		void initRenderPass();
 
 		void initBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
 		//void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
 
+		void initGeometry();
 		void initVertexBuffer();
 		void initIndexBuffer();
 		void initUniformBuffer();
+		void initInstanceBuffers();
+		void initInstances();
+		void initSceneBvh();
 		void initTextureImage();
 
 
 		void updateUniformBuffer(uint32_t currentFrame, Timestep deltaTime);
 
 		void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+		void submitModelInstances(float lodErrorScale);
+		void cullOccludedInstances();
+		void submitMeshInstances(const std::vector<MeshAllocation>& meshlets, const std::vector<InstanceData>& instances);
+		// The frame's passes with dynamic rendering, recorded by m_RenderGraph
+		void buildRenderGraph(uint32_t imageIndex, float lodErrorScale);
+		void bindDrawBatch(CommandList& commandList, const DrawBatch& batch);
+		void recordDrawPass(CommandList& commandList, uint32_t pass);
+		void beginRenderPass(VkCommandBuffer commandBuffer, uint32_t imageIndex);
 
 		void initSyncObjects();
 	private:
 
 		void initDescriptorsSetLayout();
-		void initDescriptorPool();
+		void initDescriptorSetCache();
 		void initDescriptorSets();
 
+		PipelineLayoutInfo m_PipelineLayoutInfo{};
 		VkDescriptorSetLayout m_DescriptorSetLayout;
-		VkDescriptorPool m_DesciptorPool;
-		std::vector<VkDescriptorSet> m_DescriptorSets;
+		std::vector<DescriptorHandle> m_DescriptorSets;
+		Scoped<DescriptorSetCache> m_DescriptorSetCache{ nullptr };
 
 		//DEBUG FUNC
-		void updateTexture(VkDescriptorSet descriptorSet, uint32_t binding);
+		void selectTexture();
+		void reportBenchmark(Timestep deltaTime);
+		void pickInstance();
+		bool m_PickButtonDown = false;
+		uint32_t m_BenchmarkFrame = 0;
+		float m_BenchmarkTime = 0.0f;
+		CommandListStats m_CommandListStats{}; // Of the last recorded frame
 		float m_LastUpdateTime = 0.0f;
 
 
@@ -89,17 +144,58 @@ namespace vkEngine
 		const std::string TEXTURE_PATH = "assets/textures/viking_room.png";
 
 
-		VkPipeline m_GraphicsPipeline;
+		bool m_UseDynamicRendering = false;
+		GraphicsPipelineCache m_PipelineCache{};
+		Shared<GraphicsPipeline> m_GraphicsPipeline{ nullptr };
+		GraphicsPipelineConfig m_GraphicsPipelineConfig{}; // Requested state, including the raster state set at bind time
 		VkPipelineLayout m_PipelineLayout{ VK_NULL_HANDLE };
 
+		Scoped<ShaderHotReloader> m_ShaderHotReloader{ nullptr };
+		std::future<std::vector<Scoped<GraphicsPipeline>>> m_PendingPipelines{};
+		std::vector<std::string> m_ReloadedShaders{};
+
+		DeletionQueue m_DeletionQueue{};
+		uint64_t m_FrameNumber = 0;
+		std::array<uint64_t, s_MaxFramesInFlight> m_FrameSlotSubmissions{};
+
 
 
 		Shared<Texture2D> m_TextureTest{ nullptr }, m_TextureTest2{ nullptr }, m_CurrentTexture{ nullptr };
+		glm::mat4 m_ModelMatrix{ 1.0f };
 
 		Scoped<VertexBuffer> m_VertexBuffer{ nullptr };
 		Scoped<IndexBuffer> m_IndexBuffer{ nullptr };
 
+		// Vertex pulling path, used when buffer device address is supported
+		bool m_UseVertexPulling = false;
+		Scoped<GeometryPool> m_GeometryPool{ nullptr };
+		MeshAllocation m_Mesh{};
+		std::vector<MeshLod> m_MeshLods{}; // Levels of detail of m_Mesh, ranges of its indices
+		std::vector<std::vector<MeshAllocation>> m_LodMeshlets{}; // Per level, its parts drawn and culled separately
+		std::vector<MeshAllocation> m_Meshlets{}; // Every level's meshlets, the cull pass picks each instance's level
+		std::vector<std::vector<InstanceData>> m_LodInstances{}; // Per level, the instances picking it when the CPU picks the levels
+
 		std::vector<Shared<UniformBuffer>> m_UniformBuffers{};
+		std::vector<Shared<InstanceBuffer>> m_InstanceBuffers{};
+		std::vector<InstanceData> m_Instances{};
+		Scoped<DrawBatcher> m_DrawBatcher{ nullptr };
+		Scoped<RenderGraph> m_RenderGraph{ nullptr };
+		Scoped<InstanceCuller> m_InstanceCuller{ nullptr };
+		Scoped<DepthPyramid> m_DepthPyramid{ nullptr }; // Occlusion culling depth, rebuilt between the early and the late pass
+
+		// Spatial index over the instances' world bounds, for CPU side queries such as picking
+		Scoped<ThreadPool> m_ThreadPool{ nullptr };
+		Scoped<BoundingVolumeHierarchy> m_SceneBvh{ nullptr };
+		std::vector<BoundingBox> m_InstanceBounds{}; // Of m_Instances, the objects of the scene BVH
+
+		// Culls the instances on the CPU when the GPU cannot, see submitModelInstances
+		Scoped<OcclusionRasterizer> m_OcclusionRasterizer{ nullptr };
+		OccluderMesh m_OccluderMesh{}; // Coarsest level of detail of the model
+		std::vector<uint32_t> m_ViewInstances{}; // Instances left by the frame's CPU culling
+		std::vector<BoundingBox> m_ViewInstanceBounds{};
+		std::vector<uint8_t> m_ViewInstanceVisibility{};
+		CullStats m_CpuCullStats{};
+		glm::mat4 m_ViewProjection{ 1.0f }; // Matrix of the frame's uniform buffer, the culling frustum is extracted from it
 
 
 
@@ -10,7 +10,8 @@ namespace vkEngine
 	Image2D::Image2D(const Shared<PhysicalDevice>& phsDevice, const Shared<LogicalDevice>& device, const Image2DConfig& config)
 		: m_Config(config), m_Device(device), m_PhysDevice(phsDevice)
 	{
-		if (config.usageFlags == VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
+		// Depth images are created by DepthImage, whose overrides are not dispatched to from here
+		if (config.usageFlags & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)
 			return;
 
 		createImage();
@@ -55,7 +56,7 @@ namespace vkEngine
 		VkMemoryAllocateInfo allocInfo = {};
 		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
 		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = m_PhysDevice->findMemoryType(memRequirements.memoryTypeBits, m_Config.memoryProperties);
+		allocInfo.memoryTypeIndex = m_PhysDevice->findMemoryType(memRequirements.memoryTypeBits, m_Config.memoryProperties, m_Config.preferredMemoryProperties);
 
 		ENGINE_ASSERT(vkAllocateMemory(device, &allocInfo, nullptr, &m_Memory) == VK_SUCCESS, "Failed to allocate memory for image");
 
@@ -198,7 +199,7 @@ namespace vkEngine
 		VkMemoryAllocateInfo allocInfo = {};
 		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
 		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = m_PhysDevice->findMemoryType(memRequirements.memoryTypeBits, m_Config.memoryProperties);
+		allocInfo.memoryTypeIndex = m_PhysDevice->findMemoryType(memRequirements.memoryTypeBits, m_Config.memoryProperties, m_Config.preferredMemoryProperties);
 
 		ENGINE_ASSERT(vkAllocateMemory(device, &allocInfo, nullptr, &m_Memory) == VK_SUCCESS,
 			"Failed to allocate depth image memory!");
@@ -215,11 +216,7 @@ namespace vkEngine
 		viewInfo.image = m_Image;
 		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
 		viewInfo.format = m_Config.format;
-		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-		if (m_PhysDevice->hasStencilComponent(m_Config.format))
-		{
-			viewInfo.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
-		}
+		viewInfo.subresourceRange.aspectMask = getAspectFlags();
 		viewInfo.subresourceRange.baseMipLevel = 0;
 		viewInfo.subresourceRange.levelCount = 1;
 		viewInfo.subresourceRange.baseArrayLayer = 0;
@@ -227,6 +224,29 @@ namespace vkEngine
 
 		ENGINE_ASSERT(vkCreateImageView(device, &viewInfo, nullptr, &m_ImageView) == VK_SUCCESS,
 			"Failed to create depth image view!");
+
+		// Shaders may only sample one aspect of a depth stencil image
+		if (m_Config.usageFlags & VK_IMAGE_USAGE_SAMPLED_BIT)
+		{
+			viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+			ENGINE_ASSERT(vkCreateImageView(device, &viewInfo, nullptr, &m_SampledView) == VK_SUCCESS,
+				"Failed to create sampled depth image view!");
+		}
+	}
+
+	VkImageAspectFlags DepthImage::getAspectFlags() const
+	{
+		VkImageAspectFlags aspectFlags = VK_IMAGE_ASPECT_DEPTH_BIT;
+		if (m_PhysDevice->hasStencilComponent(m_Config.format))
+			aspectFlags |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		return aspectFlags;
+	}
+
+	void DepthImage::cleanup()
+	{
+		vkDestroyImageView(m_Device->logicalDevice(), m_SampledView, nullptr);
+		m_SampledView = VK_NULL_HANDLE;
+		Image2D::cleanup();
 	}
 
 	DepthImage::DepthImage(const Shared<PhysicalDevice>& phsDevice, const Shared<LogicalDevice>& device, const Image2DConfig& config) : Image2D(phsDevice, device, config)
@@ -235,6 +255,12 @@ namespace vkEngine
 		createImageView();
 	};
 
+	DepthImage::~DepthImage()
+	{
+		// The base destructor only releases what Image2D created
+		vkDestroyImageView(m_Device->logicalDevice(), m_SampledView, nullptr);
+	}
+
 	void DepthImage::transitionImageLayout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout) {
 		VkImageMemoryBarrier barrier = {};
 		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -16,6 +16,8 @@ namespace vkEngine
 		VkImageAspectFlags aspectFlags = 0;
 		uint32_t mipmapLevel = 0;
 		VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT;
+		// Added to memoryProperties when the image accepts a memory type that has them
+		VkMemoryPropertyFlags preferredMemoryProperties = 0;
 	};
 
 
@@ -41,10 +43,9 @@ namespace vkEngine
 		VkExtent2D getExtent() const { return m_Config.extent; }
 		VkFormat getFormat() const { return m_Config.format; }
 		Image2DConfig getConfig() const { return m_Config; }
-	private:
-		void cleanup();
 	protected:
 		Image2D() = default;
+		virtual void cleanup();
 		virtual void createImage();
 		virtual void createImageView();
 
@@ -62,14 +63,23 @@ namespace vkEngine
 	{
 	public:
 		DepthImage(const Shared<PhysicalDevice>& phsDevice, const Shared<LogicalDevice>& device, const Image2DConfig& config);
+		~DepthImage() override;
 
 		void transitionImageLayout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout) override;
 		// Disable copy and assignment
 		DepthImage(const DepthImage&) = delete;
 		DepthImage& operator=(const DepthImage&) = delete;
 
+		// Depth aspect only view for sampling, the attachment view also covers stencil. Null without VK_IMAGE_USAGE_SAMPLED_BIT
+		VkImageView getSampledView() const { return m_SampledView; }
+		VkImageAspectFlags getAspectFlags() const;
+
 	protected:
+		void cleanup() override;
 		void createImage() override;
 		void createImageView() override;
+
+	private:
+		VkImageView m_SampledView = VK_NULL_HANDLE;
 	};
 }
@@ -0,0 +1,77 @@
+#include "pch.h"
+#include "RenderTargetPool.h"
+
+namespace vkEngine
+{
+	namespace
+	{
+		bool isSameConfig(const Image2DConfig& a, const Image2DConfig& b)
+		{
+			return a.extent.width == b.extent.width && a.extent.height == b.extent.height && a.format == b.format
+				&& a.usageFlags == b.usageFlags && a.sampleCount == b.sampleCount && a.mipmapLevel == b.mipmapLevel
+				&& a.aspectFlags == b.aspectFlags && a.memoryProperties == b.memoryProperties
+				&& a.preferredMemoryProperties == b.preferredMemoryProperties;
+		}
+	}
+
+	RenderTargetPool::RenderTargetPool(const Shared<PhysicalDevice>& physicalDevice, const Shared<LogicalDevice>& device)
+		: m_PhysicalDevice(physicalDevice), m_Device(device)
+	{
+	}
+
+	RenderTargetPool::~RenderTargetPool()
+	{
+		clear();
+	}
+
+	Scoped<Image2D> RenderTargetPool::acquire(const Image2DConfig& config)
+	{
+		ENGINE_ASSERT(!(config.usageFlags & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT), "Depth stencil render targets are acquired with acquireDepth");
+
+		Scoped<Image2D> target = takeIdle(config);
+		if (!target)
+			target = CreateScoped<Image2D>(m_PhysicalDevice, m_Device, config);
+		return target;
+	}
+
+	Scoped<DepthImage> RenderTargetPool::acquireDepth(const Image2DConfig& config)
+	{
+		ENGINE_ASSERT(config.usageFlags & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, "Depth render targets need VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT");
+
+		// Only DepthImages are released with depth stencil usage, see Image2D's constructor
+		Scoped<Image2D> target = takeIdle(config);
+		if (target)
+			return Scoped<DepthImage>(static_cast<DepthImage*>(target.release()));
+		return CreateScoped<DepthImage>(m_PhysicalDevice, m_Device, config);
+	}
+
+	void RenderTargetPool::release(Scoped<Image2D> target)
+	{
+		if (!target)
+			return;
+
+		m_IdleTargets.push_back(std::move(target));
+		if (m_IdleTargets.size() > s_MaxIdleTargets)
+			m_IdleTargets.pop_front();
+	}
+
+	void RenderTargetPool::clear()
+	{
+		m_IdleTargets.clear();
+	}
+
+	Scoped<Image2D> RenderTargetPool::takeIdle(const Image2DConfig& config)
+	{
+		// Newest first, the size the window just left is the likeliest to come back
+		for (auto it = m_IdleTargets.rbegin(); it != m_IdleTargets.rend(); ++it)
+		{
+			if (isSameConfig((*it)->getConfig(), config))
+			{
+				Scoped<Image2D> target = std::move(*it);
+				m_IdleTargets.erase(std::next(it).base());
+				return target;
+			}
+		}
+		return nullptr;
+	}
+}
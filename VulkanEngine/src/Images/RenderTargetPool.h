@@ -0,0 +1,42 @@
+#pragma once
+
+#include <deque>
+
+#include "Image2D.h"
+
+namespace vkEngine
+{
+	// Recycles render targets by configuration: extent, format, usage, sample count and the rest of Image2DConfig. Released
+	// targets stay allocated and the next request for the same configuration gets one back instead of a new image. The most
+	// recently released targets are kept, enough for a few earlier window sizes, so resizing back and forth does not
+	// allocate. Older ones are destroyed
+	class RenderTargetPool
+	{
+	public:
+		static constexpr uint32_t s_MaxIdleTargets = 12; // Four sizes of the swapchain's attachments and the depth pyramid
+
+		RenderTargetPool(const Shared<PhysicalDevice>& physicalDevice, const Shared<LogicalDevice>& device);
+		~RenderTargetPool();
+
+		RenderTargetPool(const RenderTargetPool&) = delete;
+		RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+		// An idle target created with config, or a new one. Contents are undefined either way
+		Scoped<Image2D> acquire(const Image2DConfig& config);
+		// Same for depth stencil attachments, which are DepthImages
+		Scoped<DepthImage> acquireDepth(const Image2DConfig& config);
+		// The GPU must be done with the target
+		void release(Scoped<Image2D> target);
+		void clear();
+
+		uint32_t getIdleCount() const { return static_cast<uint32_t>(m_IdleTargets.size()); }
+
+	private:
+		Scoped<Image2D> takeIdle(const Image2DConfig& config);
+
+	private:
+		const Shared<PhysicalDevice> m_PhysicalDevice;
+		const Shared<LogicalDevice> m_Device;
+		std::deque<Scoped<Image2D>> m_IdleTargets{}; // Most recently released last
+	};
+}
@@ -16,6 +16,7 @@ namespace vkEngine
 	{
 		loadTextureFromFile(path);
 		createTextureSampler();
+		m_BindlessIndex = VulkanContext::getBindlessRegistry()->registerTexture(getDescriptorImageInfo());
 	}
 
 
@@ -25,10 +26,12 @@ namespace vkEngine
 	{
 		loadTextureFromFile(path);
 		createTextureSampler();
+		m_BindlessIndex = VulkanContext::getBindlessRegistry()->registerTexture(getDescriptorImageInfo());
 	}
 
 	Texture2D::~Texture2D()
 	{
+		VulkanContext::getBindlessRegistry()->unregisterTexture(m_BindlessIndex);
 		vkDestroySampler(VulkanContext::getDevice(), m_Sampler, nullptr);
 	}
 
@@ -41,22 +44,6 @@ namespace vkEngine
 		return imageInfo;
 	}
 
-	void Texture2D::updateDescriptor(VkDescriptorSet descriptorSet, uint32_t binding)
-	{
-		VkDescriptorImageInfo imageInfo = getDescriptorImageInfo();
-
-		VkWriteDescriptorSet descriptorWrite{};
-		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrite.dstSet = descriptorSet;
-		descriptorWrite.dstBinding = binding;
-		descriptorWrite.dstArrayElement = 0;
-		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		descriptorWrite.descriptorCount = 1;
-		descriptorWrite.pImageInfo = &imageInfo;
-
-		vkUpdateDescriptorSets(VulkanContext::getDevice(), 1, &descriptorWrite, 0, nullptr);
-	}
-
 	void Texture2D::generateMipmaps(VkCommandBuffer commandBuffer)
 	{
 		VkImage image = m_Image->getImage();
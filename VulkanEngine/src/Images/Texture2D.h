@@ -18,8 +18,7 @@ namespace vkEngine
 		VkSampler getSampler() const { return m_Sampler; }
 		VkDescriptorImageInfo getDescriptorImageInfo() const;
 		VkExtent2D getExtent() const { return m_Image->getExtent(); }
-
-		void updateDescriptor(VkDescriptorSet descriptorSet, uint32_t binding);
+		uint32_t getBindlessIndex() const { return m_BindlessIndex; }
 
 	private:
 		void generateMipmaps(VkCommandBuffer buffer);
@@ -32,5 +31,6 @@ namespace vkEngine
 		VkFormat m_Format = VK_FORMAT_UNDEFINED;
 		bool m_EnableMipmaps = false;
 		bool m_EnableAnisotropy = false;
+		uint32_t m_BindlessIndex = UINT32_MAX;
 	};
 }
@@ -0,0 +1,43 @@
+#include "pch.h"
+#include "ComputePipeline.h"
+#include "VulkanContext.h"
+#include "Shaders/Shader.h"
+#include "Shaders/ShaderReflection.h"
+
+namespace vkEngine
+{
+	ComputePipeline::ComputePipeline(const std::string& shaderPath, const SpecializationConstants& specializationConstants)
+		: m_ShaderPath(shaderPath)
+	{
+		Shader shader(shaderPath, VK_SHADER_STAGE_COMPUTE_BIT);
+		ShaderReflection reflection(shader.getCode());
+		ShaderSpecialization specialization(reflection, specializationConstants);
+
+		for (const auto& [name, value] : specializationConstants)
+		{
+			if (!specialization.isSpecialized(name))
+				ENGINE_WARN("Specialization constant %s is not declared by %s", name.c_str(), shaderPath.c_str());
+		}
+
+		m_LayoutInfo = VulkanContext::getPipelineLayoutCache()->getLayout({ &reflection });
+
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage = shader.getStageCreateInfo(specialization.getInfo());
+		pipelineInfo.layout = m_LayoutInfo.layout;
+		if (VulkanContext::getPhysicalDevice()->getCapabilities().descriptorBuffer)
+			pipelineInfo.flags |= VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+
+		ENGINE_ASSERT(vkCreateComputePipelines(VulkanContext::getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_Pipeline) == VK_SUCCESS, "Compute pipeline creation failed for %s", shaderPath.c_str());
+	}
+
+	ComputePipeline::~ComputePipeline()
+	{
+		vkDestroyPipeline(VulkanContext::getDevice(), m_Pipeline, nullptr);
+	}
+
+	void ComputePipeline::bind(VkCommandBuffer commandBuffer) const
+	{
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
+	}
+}
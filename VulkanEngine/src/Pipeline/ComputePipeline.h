@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <vulkan/vulkan.h>
+
+#include "Pipeline/PipelineLayoutCache.h"
+#include "Shaders/ShaderSpecialization.h"
+
+namespace vkEngine
+{
+	// Single compute shader with a layout reflected from it and shared through the pipeline layout cache
+	class ComputePipeline
+	{
+	public:
+		ComputePipeline(const std::string& shaderPath, const SpecializationConstants& specializationConstants = {});
+		~ComputePipeline();
+
+		ComputePipeline(const ComputePipeline&) = delete;
+		ComputePipeline& operator=(const ComputePipeline&) = delete;
+
+		VkPipeline getPipeline() const { return m_Pipeline; }
+		VkPipelineLayout getLayout() const { return m_LayoutInfo.layout; }
+		const PipelineLayoutInfo& getLayoutInfo() const { return m_LayoutInfo; }
+		const std::string& getShaderPath() const { return m_ShaderPath; }
+
+		void bind(VkCommandBuffer commandBuffer) const;
+
+	private:
+		std::string m_ShaderPath{};
+		PipelineLayoutInfo m_LayoutInfo{};
+		VkPipeline m_Pipeline = VK_NULL_HANDLE;
+	};
+}
@@ -0,0 +1,282 @@
+#include "pch.h"
+#include "GraphicsPipeline.h"
+#include "VulkanContext.h"
+#include "CommandList.h"
+#include "Shaders/Shader.h"
+#include "Shaders/ShaderReflection.h"
+#include "Buffers/Buffer.h"
+
+#include <filesystem>
+
+namespace vkEngine
+{
+	namespace
+	{
+		// Only the attributes the vertex shader consumes are bound, Vertex provides their memory layout
+		bool getVertexAttributes(const ShaderReflection& reflection, std::vector<VkVertexInputAttributeDescription>& attributes)
+		{
+			const auto vertexAttributes = Vertex::getAttributeDescriptions();
+
+			for (const ReflectedVertexInput& input : reflection.getVertexInputs())
+			{
+				auto it = std::find_if(vertexAttributes.begin(), vertexAttributes.end(), [&input](const VkVertexInputAttributeDescription& attribute)
+					{
+						return attribute.location == input.location;
+					});
+
+				if (it == vertexAttributes.end())
+				{
+					ENGINE_WARN("Vertex shader input %s at location %u is not provided by Vertex", input.name.c_str(), input.location);
+					return false;
+				}
+				attributes.push_back(*it);
+			}
+			return true;
+		}
+
+		// Dynamic topology may only change within the topology class the pipeline was created with
+		VkPrimitiveTopology getTopologyClass(VkPrimitiveTopology topology)
+		{
+			switch (topology)
+			{
+			case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+				return VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+			case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+			case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+			case VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY:
+			case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY:
+				return VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+			case VK_PRIMITIVE_TOPOLOGY_PATCH_LIST:
+				return VK_PRIMITIVE_TOPOLOGY_PATCH_LIST;
+			default:
+				return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+			}
+		}
+	}
+
+	GraphicsPipeline::GraphicsPipeline(const GraphicsPipelineConfig& config)
+		: m_Config(getPipelineKey(config))
+	{
+		ENGINE_ASSERT(createPipeline(), "Pipeline creation failed for %s and %s", m_Config.vertexShaderPath.c_str(), m_Config.fragmentShaderPath.c_str());
+	}
+
+	GraphicsPipeline::~GraphicsPipeline()
+	{
+		vkDestroyPipeline(VulkanContext::getDevice(), m_Pipeline, nullptr);
+	}
+
+	Scoped<GraphicsPipeline> GraphicsPipeline::tryCreate(const GraphicsPipelineConfig& config)
+	{
+		Scoped<GraphicsPipeline> pipeline(new GraphicsPipeline());
+		pipeline->m_Config = getPipelineKey(config);
+		if (!pipeline->createPipeline())
+			return nullptr;
+		return pipeline;
+	}
+
+	bool GraphicsPipeline::usesShader(const std::string& spirvPath) const
+	{
+		auto normalized = [](const std::string& path) { return std::filesystem::path(path).lexically_normal().generic_string(); };
+
+		const std::string path = normalized(spirvPath);
+		return normalized(m_Config.vertexShaderPath) == path || normalized(m_Config.fragmentShaderPath) == path;
+	}
+
+	void GraphicsPipeline::bind(CommandList& commandList, const GraphicsPipelineConfig& config) const
+	{
+		commandList.bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
+		commandList.setRasterState(config);
+	}
+
+	GraphicsPipelineConfig GraphicsPipeline::getPipelineKey(const GraphicsPipelineConfig& config)
+	{
+		const DeviceCapabilities& capabilities = VulkanContext::getPhysicalDevice()->getCapabilities();
+		const GraphicsPipelineConfig defaults{};
+
+		GraphicsPipelineConfig key = config;
+		if (capabilities.extendedDynamicState)
+		{
+			key.cullMode = defaults.cullMode;
+			key.frontFace = defaults.frontFace;
+			key.topology = getTopologyClass(config.topology);
+			key.depthTestEnable = defaults.depthTestEnable;
+			key.depthWriteEnable = defaults.depthWriteEnable;
+			key.depthCompareOp = defaults.depthCompareOp;
+		}
+
+		if (capabilities.dynamicPolygonMode)
+			key.polygonMode = defaults.polygonMode;
+
+		return key;
+	}
+
+	bool GraphicsPipeline::createPipeline()
+	{
+		Scoped<Shader> vertexShader = Shader::tryCreate(m_Config.vertexShaderPath, VK_SHADER_STAGE_VERTEX_BIT);
+		Scoped<Shader> fragmentShader = Shader::tryCreate(m_Config.fragmentShaderPath, VK_SHADER_STAGE_FRAGMENT_BIT);
+		if (!vertexShader || !fragmentShader)
+			return false;
+
+		ShaderReflection vertexReflection(vertexShader->getCode());
+		ShaderReflection fragmentReflection(fragmentShader->getCode());
+
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+		if (!getVertexAttributes(vertexReflection, attributeDescriptions))
+			return false;
+
+		ShaderSpecialization vertexSpecialization(vertexReflection, m_Config.specializationConstants);
+		ShaderSpecialization fragmentSpecialization(fragmentReflection, m_Config.specializationConstants);
+
+		for (const auto& [name, value] : m_Config.specializationConstants)
+		{
+			if (!vertexSpecialization.isSpecialized(name) && !fragmentSpecialization.isSpecialized(name))
+				ENGINE_WARN("Specialization constant %s is not declared by %s or %s", name.c_str(), m_Config.vertexShaderPath.c_str(), m_Config.fragmentShaderPath.c_str());
+		}
+
+		VkPipelineShaderStageCreateInfo shaderStages[] =
+		{
+			vertexShader->getStageCreateInfo(vertexSpecialization.getInfo()),
+			fragmentShader->getStageCreateInfo(fragmentSpecialization.getInfo())
+		};
+
+		m_Layout = m_Config.layout;
+		if (m_Layout == VK_NULL_HANDLE)
+			m_Layout = VulkanContext::getPipelineLayoutCache()->getLayout({ &vertexReflection, &fragmentReflection }).layout;
+
+		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+		auto bindingDescription = Vertex::getBindingDescription();
+
+		vertexInputInfo.vertexBindingDescriptionCount = attributeDescriptions.empty() ? 0 : 1;
+		vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+		vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+
+		std::vector<VkDynamicState> dynamicStates = {
+			VK_DYNAMIC_STATE_VIEWPORT,
+			VK_DYNAMIC_STATE_SCISSOR
+		};
+
+		const DeviceCapabilities& capabilities = VulkanContext::getPhysicalDevice()->getCapabilities();
+		if (capabilities.extendedDynamicState)
+		{
+			dynamicStates.insert(dynamicStates.end(), {
+				VK_DYNAMIC_STATE_CULL_MODE_EXT,
+				VK_DYNAMIC_STATE_FRONT_FACE_EXT,
+				VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT,
+				VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT,
+				VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT,
+				VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT
+			});
+		}
+		if (capabilities.dynamicPolygonMode)
+			dynamicStates.push_back(VK_DYNAMIC_STATE_POLYGON_MODE_EXT);
+
+		VkPipelineDynamicStateCreateInfo dynamicState{};
+		dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+		dynamicState.pDynamicStates = dynamicStates.data();
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+		inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		inputAssembly.topology = m_Config.topology;
+		inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+		// Viewport and scissor are dynamic, only their count is baked into the pipeline
+		VkPipelineViewportStateCreateInfo viewportState{};
+		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportState.viewportCount = 1;
+		viewportState.scissorCount = 1;
+
+		VkPipelineRasterizationStateCreateInfo rasterizer{};
+		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		rasterizer.depthClampEnable = VK_FALSE; // Discarding or clamping vertices that are outside of planes. Needs a GPU feature enabled
+		rasterizer.rasterizerDiscardEnable = VK_FALSE; // Disables geometry ability to pass through rasterizer stage(basically disables output)
+		rasterizer.polygonMode = m_Config.polygonMode; // How fragments are generated
+		rasterizer.lineWidth = 1.0f;
+		rasterizer.cullMode = m_Config.cullMode; // Culling side
+		rasterizer.frontFace = m_Config.frontFace;
+		rasterizer.depthBiasEnable = VK_FALSE; // Bias for shadow mapping
+
+		VkPipelineMultisampleStateCreateInfo multisampling{};
+		multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisampling.sampleShadingEnable = VK_FALSE;
+		multisampling.rasterizationSamples = m_Config.sampleCount;
+
+		VkPipelineDepthStencilStateCreateInfo depthStencil{};
+		depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		depthStencil.depthTestEnable = m_Config.depthTestEnable ? VK_TRUE : VK_FALSE;
+		depthStencil.depthWriteEnable = m_Config.depthWriteEnable ? VK_TRUE : VK_FALSE;
+		depthStencil.depthCompareOp = m_Config.depthCompareOp;
+		depthStencil.depthBoundsTestEnable = VK_FALSE;
+		depthStencil.minDepthBounds = 0.0f; // Optional
+		depthStencil.maxDepthBounds = 1.0f; // Optional
+		depthStencil.stencilTestEnable = VK_FALSE;
+		depthStencil.front = {}; // Optional
+		depthStencil.back = {}; // Optional
+
+		VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+		colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		colorBlendAttachment.blendEnable = VK_FALSE;
+		colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+		colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+		colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+		colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+		VkPipelineColorBlendStateCreateInfo colorBlending{};
+		colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		colorBlending.logicOpEnable = VK_FALSE;
+		colorBlending.logicOp = VK_LOGIC_OP_COPY; // Optional
+		colorBlending.attachmentCount = 1;
+		colorBlending.pAttachments = &colorBlendAttachment;
+		colorBlending.blendConstants[0] = 0.0f; // Optional
+		colorBlending.blendConstants[1] = 0.0f; // Optional
+		colorBlending.blendConstants[2] = 0.0f; // Optional
+		colorBlending.blendConstants[3] = 0.0f; // Optional
+
+		VkPipelineRenderingCreateInfoKHR renderingInfo{};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+		renderingInfo.colorAttachmentCount = static_cast<uint32_t>(m_Config.colorFormats.size());
+		renderingInfo.pColorAttachmentFormats = m_Config.colorFormats.data();
+		renderingInfo.depthAttachmentFormat = m_Config.depthFormat;
+		if (m_Config.depthFormat != VK_FORMAT_UNDEFINED && VulkanContext::getPhysicalDevice()->hasStencilComponent(m_Config.depthFormat))
+			renderingInfo.stencilAttachmentFormat = m_Config.depthFormat;
+
+		VkGraphicsPipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		// Without a render pass the attachment formats come from the dynamic rendering info
+		if (m_Config.renderPass == VK_NULL_HANDLE)
+			pipelineInfo.pNext = &renderingInfo;
+		pipelineInfo.stageCount = 2;
+		pipelineInfo.pStages = shaderStages;
+
+		pipelineInfo.pVertexInputState = &vertexInputInfo;
+		pipelineInfo.pInputAssemblyState = &inputAssembly;
+		pipelineInfo.pViewportState = &viewportState;
+		pipelineInfo.pRasterizationState = &rasterizer;
+		pipelineInfo.pMultisampleState = &multisampling;
+		pipelineInfo.pDepthStencilState = &depthStencil;
+		pipelineInfo.pColorBlendState = &colorBlending;
+		pipelineInfo.pDynamicState = &dynamicState;
+
+		pipelineInfo.layout = m_Layout;
+		if (VulkanContext::getPhysicalDevice()->getCapabilities().descriptorBuffer)
+			pipelineInfo.flags |= VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+		pipelineInfo.renderPass = m_Config.renderPass;
+		pipelineInfo.subpass = m_Config.subpass;
+
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
+		pipelineInfo.basePipelineIndex = -1; // Optional
+
+		if (vkCreateGraphicsPipelines(VulkanContext::getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_Pipeline) != VK_SUCCESS)
+		{
+			m_Pipeline = VK_NULL_HANDLE;
+			ENGINE_WARN("vkCreateGraphicsPipelines failed for %s and %s", m_Config.vertexShaderPath.c_str(), m_Config.fragmentShaderPath.c_str());
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "Core.h"
+#include "Shaders/ShaderSpecialization.h"
+
+namespace vkEngine
+{
+	class CommandList;
+
+	struct GraphicsPipelineConfig
+	{
+		std::string vertexShaderPath{};
+		std::string fragmentShaderPath{};
+		VkPipelineLayout layout = VK_NULL_HANDLE; // Reflected from the shaders when left empty
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		uint32_t subpass = 0;
+		// Attachment formats for dynamic rendering, used when no render pass is given
+		std::vector<VkFormat> colorFormats{};
+		VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+		VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT;
+		VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		// Raster state below is set at record time when extended dynamic state is supported, see GraphicsPipeline::getPipelineKey
+		VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+		VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+		VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		bool depthTestEnable = true;
+		bool depthWriteEnable = true;
+		VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+		// Shader variant, shared by all stages. The driver folds the constants and strips the dead branches
+		SpecializationConstants specializationConstants{};
+
+		bool operator==(const GraphicsPipelineConfig& other) const = default;
+	};
+
+	class GraphicsPipeline
+	{
+	public:
+		GraphicsPipeline(const GraphicsPipelineConfig& config);
+		~GraphicsPipeline();
+
+		// Null when a shader fails to load, consumes an input Vertex does not provide or the driver rejects the pipeline,
+		// logged instead of asserted. For shaders edited at runtime, where the previous pipeline stays in use
+		static Scoped<GraphicsPipeline> tryCreate(const GraphicsPipelineConfig& config);
+
+		GraphicsPipeline(const GraphicsPipeline&) = delete;
+		GraphicsPipeline& operator=(const GraphicsPipeline&) = delete;
+
+		VkPipeline getPipeline() const { return m_Pipeline; }
+		VkPipelineLayout getLayout() const { return m_Layout; }
+		const GraphicsPipelineConfig& getConfig() const { return m_Config; }
+
+		bool usesShader(const std::string& spirvPath) const;
+
+		// Binds the pipeline and sets the raster state of config that is dynamic on this device, unless already set
+		void bind(CommandList& commandList, const GraphicsPipelineConfig& config) const;
+
+		// Config with the dynamic raster state reset to defaults, configs differing only in that state share a pipeline
+		static GraphicsPipelineConfig getPipelineKey(const GraphicsPipelineConfig& config);
+
+	private:
+		GraphicsPipeline() = default;
+
+		bool createPipeline();
+
+	private:
+		GraphicsPipelineConfig m_Config;
+		VkPipeline m_Pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout m_Layout = VK_NULL_HANDLE;
+	};
+}
+
+namespace std
+{
+	template<> struct hash<vkEngine::GraphicsPipelineConfig>
+	{
+		size_t operator()(const vkEngine::GraphicsPipelineConfig& config) const
+		{
+			size_t seed = 0;
+			auto combine = [&seed](size_t value) { seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2); };
+
+			combine(hash<string>()(config.vertexShaderPath));
+			combine(hash<string>()(config.fragmentShaderPath));
+			combine(hash<uint64_t>()(reinterpret_cast<uint64_t>(config.layout)));
+			combine(hash<uint64_t>()(reinterpret_cast<uint64_t>(config.renderPass)));
+			combine(config.subpass);
+			for (VkFormat format : config.colorFormats)
+			{
+				combine(format);
+			}
+			combine(config.depthFormat);
+			combine(config.sampleCount);
+			combine(config.topology);
+			combine(config.polygonMode);
+			combine(config.cullMode);
+			combine(config.frontFace);
+			combine(config.depthTestEnable);
+			combine(config.depthWriteEnable);
+			combine(config.depthCompareOp);
+			for (const auto& [name, value] : config.specializationConstants)
+			{
+				combine(hash<string>()(name));
+				combine(value);
+			}
+			return seed;
+		}
+	};
+}
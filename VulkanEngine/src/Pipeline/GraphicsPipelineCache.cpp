@@ -0,0 +1,38 @@
+#include "pch.h"
+#include "GraphicsPipelineCache.h"
+
+namespace vkEngine
+{
+	Shared<GraphicsPipeline> GraphicsPipelineCache::getPipeline(const GraphicsPipelineConfig& config)
+	{
+		// Dynamic raster state is not part of the key, the caller sets it when binding
+		GraphicsPipelineConfig key = GraphicsPipeline::getPipelineKey(config);
+
+		auto it = m_Pipelines.find(key);
+		if (it != m_Pipelines.end())
+			return it->second;
+
+		Shared<GraphicsPipeline> pipeline = CreateShared<GraphicsPipeline>(key);
+		m_Pipelines.emplace(key, pipeline);
+		return pipeline;
+	}
+
+	Shared<GraphicsPipeline> GraphicsPipelineCache::replace(const Shared<GraphicsPipeline>& pipeline)
+	{
+		Shared<GraphicsPipeline>& cached = m_Pipelines[pipeline->getConfig()];
+		Shared<GraphicsPipeline> previous = std::move(cached);
+		cached = pipeline;
+		return previous;
+	}
+
+	std::vector<GraphicsPipelineConfig> GraphicsPipelineCache::getConfigsUsingShader(const std::string& spirvPath) const
+	{
+		std::vector<GraphicsPipelineConfig> configs;
+		for (const auto& [config, pipeline] : m_Pipelines)
+		{
+			if (pipeline->usesShader(spirvPath))
+				configs.push_back(config);
+		}
+		return configs;
+	}
+}
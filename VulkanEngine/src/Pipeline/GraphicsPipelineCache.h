@@ -0,0 +1,31 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "GraphicsPipeline.h"
+
+namespace vkEngine
+{
+	// Owns one pipeline per distinct config, so every shader variant is compiled once and shared by its users
+	class GraphicsPipelineCache
+	{
+	public:
+		GraphicsPipelineCache() = default;
+
+		GraphicsPipelineCache(const GraphicsPipelineCache&) = delete;
+		GraphicsPipelineCache& operator=(const GraphicsPipelineCache&) = delete;
+
+		Shared<GraphicsPipeline> getPipeline(const GraphicsPipelineConfig& config);
+
+		// Swaps in a rebuilt pipeline and returns the one it replaces, which may still be in use by frames in flight
+		Shared<GraphicsPipeline> replace(const Shared<GraphicsPipeline>& pipeline);
+
+		std::vector<GraphicsPipelineConfig> getConfigsUsingShader(const std::string& spirvPath) const;
+		size_t size() const { return m_Pipelines.size(); }
+		void clear() { m_Pipelines.clear(); }
+
+	private:
+		std::unordered_map<GraphicsPipelineConfig, Shared<GraphicsPipeline>> m_Pipelines{};
+	};
+}
@@ -0,0 +1,239 @@
+#include "pch.h"
+#include "PipelineLayoutCache.h"
+#include "VulkanContext.h"
+
+namespace vkEngine
+{
+	const ReflectedBinding* PipelineLayoutInfo::findBinding(const std::string& name) const
+	{
+		auto it = std::find_if(bindings.begin(), bindings.end(), [&name](const ReflectedBinding& binding) { return binding.name == name; });
+		return it != bindings.end() ? &(*it) : nullptr;
+	}
+
+	std::vector<VkDescriptorPoolSize> PipelineLayoutInfo::getPoolSizes(uint32_t set, uint32_t setCount) const
+	{
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		for (const ReflectedBinding& binding : bindings)
+		{
+			if (binding.set != set)
+				continue;
+
+			auto it = std::find_if(poolSizes.begin(), poolSizes.end(), [&binding](const VkDescriptorPoolSize& size) { return size.type == binding.type; });
+			if (it == poolSizes.end())
+				it = poolSizes.insert(poolSizes.end(), { binding.type, 0 });
+
+			uint32_t count = binding.count == 0 ? PipelineLayoutCache::s_RuntimeArrayCapacity : binding.count;
+			it->descriptorCount += count * setCount;
+		}
+		return poolSizes;
+	}
+
+	namespace
+	{
+		// Bindless tables are shared by every pipeline, so the stages that happen to read them must not change the layout
+		VkShaderStageFlags getLayoutStageFlags(const ReflectedBinding& binding)
+		{
+			return binding.count == 0 ? VK_SHADER_STAGE_ALL : binding.stageFlags;
+		}
+	}
+
+	PipelineLayoutCache::PipelineLayoutCache(VkDevice device)
+		: m_Device(device)
+	{
+	}
+
+	PipelineLayoutCache::~PipelineLayoutCache()
+	{
+		m_UpdateTemplates.clear();
+		for (auto& [key, layout] : m_PipelineLayouts)
+		{
+			vkDestroyPipelineLayout(m_Device, layout, nullptr);
+		}
+		for (auto& [key, layout] : m_SetLayouts)
+		{
+			vkDestroyDescriptorSetLayout(m_Device, layout, nullptr);
+		}
+	}
+
+	PipelineLayoutInfo PipelineLayoutCache::getLayout(const std::vector<const ShaderReflection*>& stages)
+	{
+		PipelineLayoutInfo info{};
+
+		// Merge the stages, a binding used by several stages becomes one binding visible to all of them
+		std::optional<VkPushConstantRange> pushConstants{};
+		for (const ShaderReflection* stage : stages)
+		{
+			for (const ReflectedBinding& binding : stage->getBindings())
+			{
+				auto it = std::find_if(info.bindings.begin(), info.bindings.end(), [&binding](const ReflectedBinding& other)
+					{
+						return other.set == binding.set && other.binding == binding.binding;
+					});
+
+				if (it == info.bindings.end())
+				{
+					info.bindings.push_back(binding);
+					continue;
+				}
+
+				ENGINE_ASSERT(it->type == binding.type, "Shader stages declare set %u binding %u with different descriptor types", binding.set, binding.binding);
+				it->stageFlags |= binding.stageFlags;
+				it->count = std::max(it->count, binding.count);
+				if (it->name.empty())
+					it->name = binding.name;
+			}
+
+			if (const auto& range = stage->getPushConstantRange())
+			{
+				if (!pushConstants)
+				{
+					pushConstants = range;
+					continue;
+				}
+
+				// A single range visible to every stage keeps vkCmdPushConstants calls simple
+				uint32_t end = std::max(pushConstants->offset + pushConstants->size, range->offset + range->size);
+				pushConstants->offset = std::min(pushConstants->offset, range->offset);
+				pushConstants->size = end - pushConstants->offset;
+				pushConstants->stageFlags |= range->stageFlags;
+			}
+		}
+
+		std::sort(info.bindings.begin(), info.bindings.end(), [](const ReflectedBinding& a, const ReflectedBinding& b)
+			{
+				return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+			});
+
+		if (pushConstants)
+			info.pushConstantRanges.push_back(pushConstants.value());
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		// Sets without bindings still need a layout when a higher set is used
+		uint32_t setCount = info.bindings.empty() ? 0 : info.bindings.back().set + 1;
+		for (uint32_t set = 0; set < setCount; set++)
+		{
+			std::vector<ReflectedBinding> setBindings;
+			std::copy_if(info.bindings.begin(), info.bindings.end(), std::back_inserter(setBindings), [set](const ReflectedBinding& binding) { return binding.set == set; });
+
+			info.setLayouts.push_back(getSetLayoutLocked(setBindings));
+		}
+
+		std::vector<uint64_t> key;
+		key.reserve(2 + info.setLayouts.size() + info.pushConstantRanges.size() * 3);
+		key.push_back(info.setLayouts.size());
+		for (VkDescriptorSetLayout setLayout : info.setLayouts)
+		{
+			key.push_back(reinterpret_cast<uint64_t>(setLayout));
+		}
+		key.push_back(info.pushConstantRanges.size());
+		for (const VkPushConstantRange& range : info.pushConstantRanges)
+		{
+			key.insert(key.end(), { range.stageFlags, range.offset, range.size });
+		}
+
+		auto [it, inserted] = m_PipelineLayouts.try_emplace(key, VK_NULL_HANDLE);
+		if (inserted)
+		{
+			VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+			pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+			pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(info.setLayouts.size());
+			pipelineLayoutInfo.pSetLayouts = info.setLayouts.data();
+			pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(info.pushConstantRanges.size());
+			pipelineLayoutInfo.pPushConstantRanges = info.pushConstantRanges.data();
+
+			ENGINE_ASSERT(vkCreatePipelineLayout(m_Device, &pipelineLayoutInfo, nullptr, &it->second) == VK_SUCCESS, "Pipeline layout creation failed");
+		}
+
+		info.layout = it->second;
+		return info;
+	}
+
+	VkDescriptorSetLayout PipelineLayoutCache::getSetLayout(const std::vector<ReflectedBinding>& bindings)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return getSetLayoutLocked(bindings);
+	}
+
+	const DescriptorUpdateTemplate& PipelineLayoutCache::getUpdateTemplate(const PipelineLayoutInfo& info, uint32_t set)
+	{
+		ENGINE_ASSERT(set < info.setLayouts.size(), "Pipeline layout has no set %u", set);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		Scoped<DescriptorUpdateTemplate>& updateTemplate = m_UpdateTemplates[info.setLayouts[set]];
+		if (!updateTemplate)
+		{
+			std::vector<ReflectedBinding> setBindings;
+			std::copy_if(info.bindings.begin(), info.bindings.end(), std::back_inserter(setBindings), [set](const ReflectedBinding& binding) { return binding.set == set; });
+
+			updateTemplate = CreateScoped<DescriptorUpdateTemplate>(m_Device, info.setLayouts[set], setBindings);
+		}
+		return *updateTemplate;
+	}
+
+	VkDescriptorSetLayout PipelineLayoutCache::getSetLayoutLocked(const std::vector<ReflectedBinding>& bindings)
+	{
+		std::vector<uint32_t> key;
+		key.reserve(bindings.size() * 4);
+		for (const ReflectedBinding& binding : bindings)
+		{
+			key.insert(key.end(), { binding.binding, static_cast<uint32_t>(binding.type), binding.count, getLayoutStageFlags(binding) });
+		}
+
+		auto [it, inserted] = m_SetLayouts.try_emplace(key, VK_NULL_HANDLE);
+		if (!inserted)
+			return it->second;
+
+		// Descriptor buffer layouts are written in place and may not use update after bind
+		bool descriptorBuffer = VulkanContext::getPhysicalDevice()->getCapabilities().descriptorBuffer;
+
+		std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+		std::vector<VkDescriptorBindingFlags> bindingFlags;
+		layoutBindings.reserve(bindings.size());
+		bindingFlags.reserve(bindings.size());
+		bool updateAfterBind = false;
+		bool hasRuntimeArray = false;
+		for (const ReflectedBinding& binding : bindings)
+		{
+			bool runtimeArray = binding.count == 0;
+			ENGINE_ASSERT(!runtimeArray || VulkanContext::getPhysicalDevice()->getCapabilities().descriptorIndexing,
+				"Runtime sized descriptor array %s requires descriptor indexing", binding.name.c_str());
+
+			VkDescriptorSetLayoutBinding layoutBinding{};
+			layoutBinding.binding = binding.binding;
+			layoutBinding.descriptorType = binding.type;
+			layoutBinding.descriptorCount = runtimeArray ? s_RuntimeArrayCapacity : binding.count;
+			layoutBinding.stageFlags = getLayoutStageFlags(binding);
+			layoutBinding.pImmutableSamplers = nullptr;
+			layoutBindings.push_back(layoutBinding);
+
+			// Slots are filled as resources are created, while earlier frames may still be using the set
+			VkDescriptorBindingFlags flags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+			if (!descriptorBuffer)
+				flags |= VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+			bindingFlags.push_back(runtimeArray ? flags : 0);
+			updateAfterBind |= runtimeArray && !descriptorBuffer;
+			hasRuntimeArray |= runtimeArray;
+		}
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+		bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+		bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+		bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
+		layoutInfo.pBindings = layoutBindings.data();
+		if (hasRuntimeArray)
+			layoutInfo.pNext = &bindingFlagsInfo;
+		if (updateAfterBind)
+			layoutInfo.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+		if (descriptorBuffer)
+			layoutInfo.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+
+		ENGINE_ASSERT(vkCreateDescriptorSetLayout(m_Device, &layoutInfo, nullptr, &it->second) == VK_SUCCESS, "Layout descriptors set creation failed");
+		return it->second;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "Shaders/ShaderReflection.h"
+#include "Descriptors/DescriptorUpdateTemplate.h"
+
+namespace vkEngine
+{
+	// Layout resolved from the reflection of every stage of a pipeline
+	struct PipelineLayoutInfo
+	{
+		VkPipelineLayout layout = VK_NULL_HANDLE;
+		std::vector<VkDescriptorSetLayout> setLayouts{};
+		std::vector<ReflectedBinding> bindings{};
+		std::vector<VkPushConstantRange> pushConstantRanges{};
+
+		const ReflectedBinding* findBinding(const std::string& name) const;
+		std::vector<VkDescriptorPoolSize> getPoolSizes(uint32_t set, uint32_t setCount) const;
+	};
+
+	// Creates descriptor set layouts and pipeline layouts from shader reflection.
+	// Identical layouts are created once and shared, so pipelines with matching interfaces stay layout compatible.
+	// Layouts live until the cache is destroyed. Lookups are thread safe, pipelines can be built off the render thread.
+	// Runtime sized arrays become bindless tables: partially bound, update after bind and visible to every stage.
+	class PipelineLayoutCache
+	{
+	public:
+		static constexpr uint32_t s_RuntimeArrayCapacity = 4096;
+
+		PipelineLayoutCache(VkDevice device);
+		~PipelineLayoutCache();
+
+		PipelineLayoutCache(const PipelineLayoutCache&) = delete;
+		PipelineLayoutCache& operator=(const PipelineLayoutCache&) = delete;
+
+		PipelineLayoutInfo getLayout(const std::vector<const ShaderReflection*>& stages);
+		VkDescriptorSetLayout getSetLayout(const std::vector<ReflectedBinding>& bindings);
+		// Update template writing every fixed size binding of one set of the layout, shared by sets of the same layout
+		const DescriptorUpdateTemplate& getUpdateTemplate(const PipelineLayoutInfo& info, uint32_t set);
+
+	private:
+		VkDescriptorSetLayout getSetLayoutLocked(const std::vector<ReflectedBinding>& bindings);
+
+	private:
+		VkDevice m_Device = VK_NULL_HANDLE;
+
+		std::mutex m_Mutex;
+		std::map<std::vector<uint32_t>, VkDescriptorSetLayout> m_SetLayouts{};
+		std::map<std::vector<uint64_t>, VkPipelineLayout> m_PipelineLayouts{};
+		std::map<VkDescriptorSetLayout, Scoped<DescriptorUpdateTemplate>> m_UpdateTemplates{};
+	};
+}
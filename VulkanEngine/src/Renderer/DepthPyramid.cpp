@@ -0,0 +1,182 @@
+#include "pch.h"
+#include "DepthPyramid.h"
+#include "VulkanContext.h"
+#include "Descriptors/DescriptorBinding.h"
+#include "Images/RenderTargetPool.h"
+#include "Utility/VulkanUtils.h"
+
+namespace vkEngine
+{
+	namespace
+	{
+		const std::string REDUCE_SHADER = "shaders/bin/depthPyramid.comp.spv";
+		const std::string MULTISAMPLED_REDUCE_SHADER = "shaders/bin/depthPyramidMultisampled.comp.spv";
+
+		// Bindings shared by both reduction shaders
+		constexpr uint32_t SOURCE_BINDING = 0;
+		constexpr uint32_t DESTINATION_BINDING = 1;
+
+		// Matches DepthPyramidPushConstants in the reduction shaders
+		struct DepthPyramidPushConstants
+		{
+			glm::uvec2 sourceSize;
+			glm::uvec2 destinationSize;
+		};
+	}
+
+	DepthPyramid::DepthPyramid(const DepthImage& depthBuffer)
+		: m_DepthBuffer(&depthBuffer),
+		m_ReducePipeline(REDUCE_SHADER),
+		m_DescriptorSetCache(VulkanContext::getDevice())
+	{
+		if (depthBuffer.getConfig().sampleCount != VK_SAMPLE_COUNT_1_BIT)
+			m_MultisampledPipeline = CreateScoped<ComputePipeline>(MULTISAMPLED_REDUCE_SHADER);
+
+		// Texels are fetched, never filtered
+		VkSamplerCreateInfo samplerInfo{};
+		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		samplerInfo.magFilter = VK_FILTER_NEAREST;
+		samplerInfo.minFilter = VK_FILTER_NEAREST;
+		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+		ENGINE_ASSERT(vkCreateSampler(VulkanContext::getDevice(), &samplerInfo, nullptr, &m_Sampler) == VK_SUCCESS, "Failed to create depth pyramid sampler");
+
+		create();
+	}
+
+	DepthPyramid::~DepthPyramid()
+	{
+		destroy();
+		vkDestroySampler(VulkanContext::getDevice(), m_Sampler, nullptr);
+	}
+
+	void DepthPyramid::resize(const DepthImage& depthBuffer)
+	{
+		destroy();
+		m_DepthBuffer = &depthBuffer;
+		create();
+	}
+
+	void DepthPyramid::create()
+	{
+		VkDevice device = VulkanContext::getDevice();
+
+		VkExtent2D depthExtent = m_DepthBuffer->getExtent();
+		VkExtent2D extent{ std::max((depthExtent.width + 1) / 2, 1u), std::max((depthExtent.height + 1) / 2, 1u) };
+		uint32_t levelCount = static_cast<uint32_t>(std::floor(std::log2(std::max(extent.width, extent.height)))) + 1;
+
+		Image2DConfig config =
+		{
+			.extent = extent,
+			.format = VK_FORMAT_R32_SFLOAT,
+			.memoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			.usageFlags = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			.aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT,
+			.mipmapLevel = levelCount
+		};
+		m_Image = VulkanContext::getRenderTargetPool()->acquire(config);
+
+		m_LevelViews.resize(levelCount);
+		m_LevelExtents.resize(levelCount);
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			VkImageViewCreateInfo viewInfo{};
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.image = m_Image->getImage();
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.format = config.format;
+			viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			viewInfo.subresourceRange.baseMipLevel = level;
+			viewInfo.subresourceRange.levelCount = 1;
+			viewInfo.subresourceRange.baseArrayLayer = 0;
+			viewInfo.subresourceRange.layerCount = 1;
+
+			ENGINE_ASSERT(vkCreateImageView(device, &viewInfo, nullptr, &m_LevelViews[level]) == VK_SUCCESS, "Failed to create depth pyramid level view");
+			m_LevelExtents[level] = { std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u) };
+		}
+
+		// Level 0 reads the depth buffer, every other level the one above it. A depth buffer that is not sampled has no level 0
+		// set and the pyramid is never recorded, it only stands in for the culling descriptors
+		m_LevelSets.resize(levelCount);
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			if (level == 0 && m_DepthBuffer->getSampledView() == VK_NULL_HANDLE)
+				continue;
+
+			const ComputePipeline& pipeline = level == 0 && m_MultisampledPipeline ? *m_MultisampledPipeline : m_ReducePipeline;
+			const DescriptorUpdateTemplate& updateTemplate = VulkanContext::getPipelineLayoutCache()->getUpdateTemplate(pipeline.getLayoutInfo(), 0);
+
+			std::vector<DescriptorData> data = updateTemplate.createData();
+			if (level == 0)
+				data[updateTemplate.getSlot(SOURCE_BINDING)].image = { m_Sampler, m_DepthBuffer->getSampledView(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+			else
+				data[updateTemplate.getSlot(SOURCE_BINDING)].image = { m_Sampler, m_LevelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL };
+			data[updateTemplate.getSlot(DESTINATION_BINDING)].image = { VK_NULL_HANDLE, m_LevelViews[level], VK_IMAGE_LAYOUT_GENERAL };
+
+			m_LevelSets[level] = m_DescriptorSetCache.getSet(updateTemplate, data);
+		}
+
+		// Nothing is reduced yet, the pyramid is only moved to the layout it keeps
+		VkCommandBuffer commandBuffer = VulkanContext::getCommandHandler()->beginSingleTimeCommands();
+		VulkanUtils::insertImageBarrier(commandBuffer, m_Image->getImage(), VK_IMAGE_ASPECT_COLOR_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+		VulkanContext::getCommandHandler()->endSingleTimeCommands(commandBuffer);
+
+		m_HasHistory = false;
+	}
+
+	void DepthPyramid::destroy()
+	{
+		for (VkImageView view : m_LevelViews)
+		{
+			vkDestroyImageView(VulkanContext::getDevice(), view, nullptr);
+		}
+		m_LevelViews.clear();
+		m_LevelExtents.clear();
+		m_LevelSets.clear();
+		m_DescriptorSetCache.clear();
+		VulkanContext::getRenderTargetPool()->release(std::move(m_Image));
+	}
+
+	void DepthPyramid::record(VkCommandBuffer commandBuffer)
+	{
+		ENGINE_ASSERT(m_DepthBuffer->getSampledView() != VK_NULL_HANDLE, "Depth pyramid needs a depth buffer created with VK_IMAGE_USAGE_SAMPLED_BIT");
+		VkExtent2D depthExtent = m_DepthBuffer->getExtent();
+		const ComputePipeline* boundPipeline = nullptr;
+		for (uint32_t level = 0; level < getLevelCount(); level++)
+		{
+			const ComputePipeline& pipeline = level == 0 && m_MultisampledPipeline ? *m_MultisampledPipeline : m_ReducePipeline;
+			if (&pipeline != boundPipeline)
+			{
+				pipeline.bind(commandBuffer);
+				boundPipeline = &pipeline;
+			}
+			DescriptorBinding::bindSet(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.getLayout(), 0, m_LevelSets[level]);
+
+			VkExtent2D source = level == 0 ? depthExtent : m_LevelExtents[level - 1];
+			VkExtent2D destination = m_LevelExtents[level];
+			DepthPyramidPushConstants constants{ { source.width, source.height }, { destination.width, destination.height } };
+			const VkPushConstantRange& range = pipeline.getLayoutInfo().pushConstantRanges[0];
+			vkCmdPushConstants(commandBuffer, pipeline.getLayout(), range.stageFlags, range.offset, sizeof(constants), &constants);
+
+			vkCmdDispatch(commandBuffer, (destination.width + s_WorkgroupSize - 1) / s_WorkgroupSize, (destination.height + s_WorkgroupSize - 1) / s_WorkgroupSize, 1);
+
+			// Each level is the source of the next one, readers of the last one are synchronized by the caller
+			if (level + 1 < getLevelCount())
+			{
+				VulkanUtils::insertImageBarrier(commandBuffer, m_Image->getImage(), VK_IMAGE_ASPECT_COLOR_BIT,
+					VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+					VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+			}
+		}
+
+		m_HasHistory = true;
+	}
+}
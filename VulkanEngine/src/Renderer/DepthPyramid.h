@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "Core.h"
+#include "Descriptors/DescriptorSetCache.h"
+#include "Images/Image2D.h"
+#include "Pipeline/ComputePipeline.h"
+
+namespace vkEngine
+{
+	// Hierarchical depth (Hi-Z) pyramid reduced from the depth buffer by compute. Level 0 is half the depth buffer's size
+	// and every texel holds the farthest depth of the area it covers, so anything nearer than its covering texels is hidden.
+	// The pyramid stays in VK_IMAGE_LAYOUT_GENERAL, written level by level as storage images and read through getImageView.
+	class DepthPyramid
+	{
+	public:
+		static constexpr uint32_t s_WorkgroupSize = 8; // local_size_x and local_size_y of the reduction shaders
+
+		DepthPyramid(const DepthImage& depthBuffer);
+		~DepthPyramid();
+
+		DepthPyramid(const DepthPyramid&) = delete;
+		DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+		// Follows a resized depth buffer, the GPU must be done with the previous pyramid. The history is dropped
+		void resize(const DepthImage& depthBuffer);
+		// Reduces the depth buffer. The caller moves it to DEPTH_STENCIL_READ_ONLY_OPTIMAL and orders the reduction after the
+		// depth writes and the previous readers of the pyramid, as the render graph does for a pass sampling the depth buffer
+		// and writing the pyramid. The levels are synchronized among themselves
+		void record(VkCommandBuffer commandBuffer);
+
+		// Whether a previous record filled the pyramid, it holds undefined depths until then
+		bool hasHistory() const { return m_HasHistory; }
+		const Image2D& getImage() const { return *m_Image; }
+		VkImageView getImageView() const { return m_Image->getImageView(); }
+		VkSampler getSampler() const { return m_Sampler; }
+		VkExtent2D getDepthExtent() const { return m_DepthBuffer->getExtent(); }
+		uint32_t getLevelCount() const { return static_cast<uint32_t>(m_LevelViews.size()); }
+
+	private:
+		void create();
+		void destroy();
+
+	private:
+		const DepthImage* m_DepthBuffer = nullptr;
+		ComputePipeline m_ReducePipeline;
+		Scoped<ComputePipeline> m_MultisampledPipeline{ nullptr }; // Reduces a multisampled depth buffer into level 0
+		DescriptorSetCache m_DescriptorSetCache;
+		VkSampler m_Sampler = VK_NULL_HANDLE;
+
+		Scoped<Image2D> m_Image{ nullptr };
+		std::vector<VkImageView> m_LevelViews{}; // Single level views, bound as storage images and as reduction sources
+		std::vector<DescriptorHandle> m_LevelSets{}; // Per level, reading the level above or the depth buffer
+		std::vector<VkExtent2D> m_LevelExtents{};
+		bool m_HasHistory = false;
+	};
+}
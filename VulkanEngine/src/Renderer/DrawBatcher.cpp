@@ -0,0 +1,149 @@
+#include "pch.h"
+#include "DrawBatcher.h"
+#include "VulkanContext.h"
+
+namespace vkEngine
+{
+	DrawBatcher::DrawBatcher(uint32_t frameCount, ThreadPool* threadPool, uint32_t maxDraws)
+		: m_MaxDraws(maxDraws), m_Queue(threadPool)
+	{
+		m_IndirectBuffers.resize(frameCount);
+		for (auto& indirectBuffer : m_IndirectBuffers)
+		{
+			indirectBuffer = CreateScoped<IndirectBuffer>(sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(maxDraws));
+		}
+	}
+
+	void DrawBatcher::begin(uint32_t frameIndex)
+	{
+		m_FrameIndex = frameIndex;
+		m_IndirectBuffers[m_FrameIndex]->reset();
+		m_Draws.clear();
+		m_Queue.clear();
+		m_PipelineIds.clear();
+		m_GeometryIds.clear();
+		m_Batches.clear();
+		m_Built = false;
+	}
+
+	void DrawBatcher::add(const GraphicsPipeline* pipeline, const void* geometry, bool indexed, VkCullModeFlags cullMode, const MeshAllocation& mesh, uint32_t firstInstance,
+		uint32_t instanceCount, DrawSortInfo sortInfo)
+	{
+		ENGINE_ASSERT(!m_Built, "Draw added after the frame's batches were built");
+
+		sortInfo.pipeline = m_PipelineIds.try_emplace(pipeline, static_cast<uint32_t>(m_PipelineIds.size())).first->second;
+		sortInfo.geometry = m_GeometryIds.try_emplace(geometry, static_cast<uint32_t>(m_GeometryIds.size())).first->second;
+		m_Queue.push(RenderQueue::makeKey(sortInfo), static_cast<uint32_t>(m_Draws.size()));
+		m_Draws.push_back({ pipeline, geometry, indexed, cullMode, mesh, firstInstance, instanceCount });
+	}
+
+	// A batch ends wherever the sorted draws change pipeline, geometry, indexing or cull mode
+	void DrawBatcher::buildBatches()
+	{
+		m_Queue.sort();
+
+		m_Batches.clear();
+		for (const RenderQueue::Entry& entry : m_Queue.getEntries())
+		{
+			const PendingDraw& draw = m_Draws[entry.item];
+			if (m_Batches.empty() || m_Batches.back().pipeline != draw.pipeline || m_Batches.back().geometry != draw.geometry || m_Batches.back().indexed != draw.indexed
+				|| m_Batches.back().cullMode != draw.cullMode)
+			{
+				DrawBatch& batch = m_Batches.emplace_back();
+				batch.pipeline = draw.pipeline;
+				batch.geometry = draw.geometry;
+				batch.indexed = draw.indexed;
+				batch.cullMode = draw.cullMode;
+			}
+
+			DrawBatch& batch = m_Batches.back();
+			const MeshAllocation& mesh = draw.mesh;
+			batch.commands.push_back({ mesh.indexCount, draw.instanceCount, mesh.firstIndex, static_cast<int32_t>(mesh.firstVertex), draw.firstInstance });
+			batch.boundingSpheres.push_back(mesh.boundingSphere);
+			batch.normalCones.push_back(mesh.normalCone);
+			batch.lodSpheres.push_back(mesh.lodSphere);
+			batch.lodErrors.push_back(mesh.lodErrors);
+		}
+	}
+
+	void DrawBatcher::build(bool zeroInstanceCounts, uint32_t passCount)
+	{
+		IndirectBuffer& indirectBuffer = *m_IndirectBuffers[m_FrameIndex];
+		if (!m_Built)
+			buildBatches();
+
+		std::vector<VkDrawIndexedIndirectCommand> indexedCommands;
+		std::vector<VkDrawIndirectCommand> nonIndexedCommands;
+		for (DrawBatch& batch : m_Batches)
+		{
+			batch.commandOffsets.clear();
+			for (uint32_t pass = 0; pass < passCount; pass++)
+			{
+				if (batch.indexed)
+				{
+					indexedCommands = batch.commands;
+					if (zeroInstanceCounts)
+					{
+						for (VkDrawIndexedIndirectCommand& command : indexedCommands)
+						{
+							command.instanceCount = 0;
+						}
+					}
+
+					batch.commandStride = sizeof(VkDrawIndexedIndirectCommand);
+					batch.commandOffsets.push_back(indirectBuffer.push(indexedCommands.data(), sizeof(VkDrawIndexedIndirectCommand) * indexedCommands.size()));
+					continue;
+				}
+
+				// Pulled geometry indexes with gl_VertexIndex, so the mesh's first index becomes firstVertex
+				nonIndexedCommands.clear();
+				for (size_t i = 0; i < batch.commands.size(); i++)
+				{
+					const VkDrawIndexedIndirectCommand& command = batch.commands[i];
+					nonIndexedCommands.push_back({ command.indexCount, zeroInstanceCounts ? 0 : command.instanceCount, command.firstIndex, command.firstInstance });
+				}
+
+				batch.commandStride = sizeof(VkDrawIndirectCommand);
+				batch.commandOffsets.push_back(indirectBuffer.push(nonIndexedCommands.data(), sizeof(VkDrawIndirectCommand) * nonIndexedCommands.size()));
+			}
+		}
+		m_PassCount = passCount;
+		m_Built = true;
+	}
+
+	void DrawBatcher::record(CommandList& commandList, const std::function<void(CommandList&, const DrawBatch&)>& bindBatch, uint32_t pass)
+	{
+		if (!m_Built)
+			build();
+		ENGINE_ASSERT(pass < m_PassCount, "Pass %u was not built, the batches have %u passes", pass, m_PassCount);
+
+		VkCommandBuffer commandBuffer = commandList.getCommandBuffer();
+		VkBuffer indirectBuffer = m_IndirectBuffers[m_FrameIndex]->getBuffer();
+		bool multiDraw = VulkanContext::getPhysicalDevice()->getCapabilities().multiDrawIndirect;
+
+		for (const DrawBatch& batch : m_Batches)
+		{
+			bindBatch(commandList, batch);
+			uint32_t drawCount = static_cast<uint32_t>(batch.commands.size());
+
+			// Without multi draw indirect every command is its own draw, binds are still shared by the batch. Nothing culls on
+			// the GPU then, the draws keep their instances
+			if (!multiDraw)
+			{
+				for (const VkDrawIndexedIndirectCommand& command : batch.commands)
+				{
+					if (batch.indexed)
+						vkCmdDrawIndexed(commandBuffer, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
+					else
+						vkCmdDraw(commandBuffer, command.indexCount, command.instanceCount, command.firstIndex, command.firstInstance);
+				}
+				continue;
+			}
+
+			if (batch.indexed)
+				vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer, batch.commandOffsets[pass], drawCount, batch.commandStride);
+			else
+				vkCmdDrawIndirect(commandBuffer, indirectBuffer, batch.commandOffsets[pass], drawCount, batch.commandStride);
+		}
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "Core.h"
+#include "CommandList.h"
+#include "Buffers/GeometryPool.h"
+#include "Buffers/IndirectBuffer.h"
+#include "Renderer/RenderQueue.h"
+
+namespace vkEngine
+{
+	class GraphicsPipeline;
+
+	// Draws sharing a pipeline and a geometry source, issued with a single indirect draw
+	struct DrawBatch
+	{
+		const GraphicsPipeline* pipeline = nullptr;
+		const void* geometry = nullptr; // Geometry pool or vertex buffer the draws index into
+		bool indexed = true; // Vertex pulling draws are non indexed, the shader reads the index buffer itself
+		VkCullModeFlags cullMode = VK_CULL_MODE_NONE; // Set when the batch is bound, only draws culling back faces may be culled as facing away
+		std::vector<VkDrawIndexedIndirectCommand> commands{};
+		std::vector<glm::vec4> boundingSpheres{}; // Mesh space bounds of each command's mesh, see MeshAllocation
+		std::vector<glm::vec4> normalCones{};
+		std::vector<glm::vec4> lodSpheres{};
+		std::vector<glm::vec2> lodErrors{};
+
+		// Placement of the commands in the frame's indirect buffer, one copy per pass
+		std::vector<VkDeviceSize> commandOffsets{};
+		uint32_t commandStride = 0;
+	};
+
+	// Orders the draws of a frame by their sort keys, see RenderQueue, groups consecutive draws sharing a pipeline and
+	// geometry and writes each group's commands into the frame's indirect buffer, so recording costs one bind and one
+	// vkCmdDraw*Indirect per batch instead of per object. Textures are bindless and transforms are per instance, so
+	// materials never split a batch, they only order the draws within one.
+	class DrawBatcher
+	{
+	public:
+		static constexpr uint32_t s_DefaultMaxDraws = 16384;
+
+		// threadPool may be null, it sorts large draw lists
+		DrawBatcher(uint32_t frameCount, ThreadPool* threadPool = nullptr, uint32_t maxDraws = s_DefaultMaxDraws);
+
+		DrawBatcher(const DrawBatcher&) = delete;
+		DrawBatcher& operator=(const DrawBatcher&) = delete;
+
+		// Drops the previous draws of the frame slot, call once its fence has signaled
+		void begin(uint32_t frameIndex);
+		// The pipeline and geometry ids of sortInfo are assigned here, the caller fills in the pass, transparency, material and depth.
+		// cullMode is the raster state the draw is bound with
+		void add(const GraphicsPipeline* pipeline, const void* geometry, bool indexed, VkCullModeFlags cullMode, const MeshAllocation& mesh, uint32_t firstInstance,
+			uint32_t instanceCount, DrawSortInfo sortInfo = {});
+		// Sorts the draws and writes every batch's commands into the frame's indirect buffer, each of passCount passes gets its own
+		// copy. With zeroInstanceCounts the instance counts are left at zero for a culling pass to accumulate on the GPU, which
+		// also moves the first instances into the visible instance list, see InstanceCuller
+		void build(bool zeroInstanceCounts = false, uint32_t passCount = 1);
+		// Issues every batch's commands of the pass, bindBatch binds the batch's pipeline and geometry before its draw
+		void record(CommandList& commandList, const std::function<void(CommandList&, const DrawBatch&)>& bindBatch, uint32_t pass = 0);
+
+		// In key order, valid once built
+		const std::vector<DrawBatch>& getBatches() const { return m_Batches; }
+		size_t getBatchCount() const { return m_Batches.size(); }
+		uint32_t getMaxDraws() const { return m_MaxDraws; }
+		VkBuffer getIndirectBuffer(uint32_t frameIndex) const { return m_IndirectBuffers[frameIndex]->getBuffer(); }
+		VkDeviceSize getIndirectBufferSize() const { return m_IndirectBuffers.front()->getSize(); }
+
+	private:
+		struct PendingDraw
+		{
+			const GraphicsPipeline* pipeline = nullptr;
+			const void* geometry = nullptr;
+			bool indexed = true;
+			VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+			MeshAllocation mesh{};
+			uint32_t firstInstance = 0;
+			uint32_t instanceCount = 0;
+		};
+
+		void buildBatches();
+
+	private:
+		std::vector<Scoped<IndirectBuffer>> m_IndirectBuffers{};
+		uint32_t m_FrameIndex = 0;
+		uint32_t m_MaxDraws = 0;
+		uint32_t m_PassCount = 0;
+		bool m_Built = false;
+
+		std::vector<PendingDraw> m_Draws{};
+		RenderQueue m_Queue;
+		// Sort ids of the frame's pipelines and geometry sources, in the order they were first added
+		std::unordered_map<const GraphicsPipeline*, uint32_t> m_PipelineIds{};
+		std::unordered_map<const void*, uint32_t> m_GeometryIds{};
+		std::vector<DrawBatch> m_Batches{};
+	};
+}
@@ -0,0 +1,363 @@
+#include "pch.h"
+#include "InstanceCuller.h"
+#include "VulkanContext.h"
+#include "Descriptors/DescriptorBinding.h"
+
+#include <numeric>
+
+namespace vkEngine
+{
+	namespace
+	{
+		const std::string CULL_SHADER = "shaders/bin/cullInstances.comp.spv";
+
+		// Matches CullFrameData in cullInstances.comp
+		struct CullFrameData
+		{
+			glm::vec4 frustumPlanes[Frustum::PlaneCount];
+			glm::mat4 viewProjection;
+			glm::vec4 cameraPosition;
+			glm::vec2 viewportSize;
+			uint32_t pyramidLevelCount;
+			uint32_t flags;
+			uint32_t lateVisibleOffset;
+			float lodErrorScale;
+			uint32_t levelCount;
+			uint32_t meshletCount;
+		};
+
+		// Flags of CullFrameData
+		constexpr uint32_t FLAG_OCCLUSION_HISTORY = 1;
+		constexpr uint32_t FLAG_LATE_PASS = 2;
+
+		// Matches the STEP_ constants in cullInstances.comp
+		enum CullStep : uint32_t
+		{
+			STEP_SELECT_LEVELS,
+			STEP_PLACE_DRAWS,
+			STEP_CULL_MESHLETS
+		};
+
+		// Matches CullPushConstants in cullInstances.comp
+		struct CullPushConstants
+		{
+			glm::vec4 lodSphere;
+			uint32_t step;
+			uint32_t pass;
+			uint32_t firstInstance;
+			uint32_t instanceCount;
+			uint32_t firstLevel;
+			uint32_t levelCount;
+			uint32_t padding[2];
+		};
+		static_assert(sizeof(CullPushConstants) <= 128, "Cull push constants exceed the guaranteed push constant size");
+
+		// Word offsets of firstInstance in VkDrawIndexedIndirectCommand and VkDrawIndirectCommand
+		constexpr uint32_t INDEXED_FIRST_INSTANCE_WORD = 4;
+		constexpr uint32_t FIRST_INSTANCE_WORD = 3;
+
+		// Makes the cull shader's writes visible to the next step, the draws and the host
+		void recordBarrier(VkCommandBuffer commandBuffer, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+		{
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.dstAccessMask = dstAccess;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		}
+
+		template<typename T>
+		T* mapBuffer(const Buffer& buffer)
+		{
+			void* mapped = nullptr;
+			vkMapMemory(VulkanContext::getDevice(), buffer.getMemory(), 0, VK_WHOLE_SIZE, 0, &mapped);
+			return static_cast<T*>(mapped);
+		}
+	}
+
+	InstanceCuller::InstanceCuller(const std::vector<Shared<InstanceBuffer>>& instanceBuffers, const DrawBatcher& batcher, const DepthPyramid& depthPyramid,
+		uint32_t maxLevelMeshlets, uint32_t maxLevelCount, bool occlusionCulling)
+		: m_Pipeline(CULL_SHADER),
+		m_DescriptorSetCache(VulkanContext::getDevice()),
+		m_DepthPyramid(&depthPyramid),
+		m_VisibleInstanceCapacity(instanceBuffers.front()->getCapacity() * maxLevelMeshlets),
+		m_LevelInstanceCapacity(instanceBuffers.front()->getCapacity() * maxLevelCount),
+		m_MaxDraws(batcher.getMaxDraws()),
+		m_Culling(VulkanContext::getPhysicalDevice()->getCapabilities().multiDrawIndirect)
+	{
+		m_OcclusionCulling = supportsOcclusionCulling(occlusionCulling);
+
+		const PipelineLayoutInfo& layoutInfo = m_Pipeline.getLayoutInfo();
+		ENGINE_ASSERT(!layoutInfo.pushConstantRanges.empty() && layoutInfo.pushConstantRanges[0].size == sizeof(CullPushConstants),
+			"Cull shader push constants do not match CullPushConstants");
+
+		const DescriptorUpdateTemplate& updateTemplate = VulkanContext::getPipelineLayoutCache()->getUpdateTemplate(layoutInfo, 0);
+		uint32_t instancesSlot = updateTemplate.getSlot("instances");
+		uint32_t visibleInstancesSlot = updateTemplate.getSlot("visibleInstances");
+		uint32_t drawCommandsSlot = updateTemplate.getSlot("drawCommands");
+		uint32_t statsSlot = updateTemplate.getSlot("stats");
+		uint32_t frameSlot = updateTemplate.getSlot("frame");
+		uint32_t occludedInstancesSlot = updateTemplate.getSlot("occludedInstances");
+		uint32_t levelsSlot = updateTemplate.getSlot("levels");
+		uint32_t meshletsSlot = updateTemplate.getSlot("meshlets");
+		uint32_t levelInstancesSlot = updateTemplate.getSlot("levelInstances");
+		uint32_t meshletDispatchSlot = updateTemplate.getSlot("meshletDispatch");
+		m_DepthPyramidSlot = updateTemplate.getSlot("depthPyramid");
+
+		VkDeviceSize occludedInstanceBufferSize = sizeof(uint32_t) * static_cast<VkDeviceSize>(m_VisibleInstanceCapacity);
+		VkDeviceSize levelInstanceBufferSize = sizeof(uint32_t) * static_cast<VkDeviceSize>(m_LevelInstanceCapacity);
+		VkDeviceSize levelBufferSize = sizeof(CullLevel) * static_cast<VkDeviceSize>(m_MaxDraws);
+		VkDeviceSize meshletBufferSize = sizeof(CullMeshlet) * static_cast<VkDeviceSize>(m_MaxDraws);
+
+		// Without culling the draws index the list with their own first instance, see DrawBatcher::record
+		Scoped<Buffer> identityBuffer{ nullptr };
+		if (!m_Culling)
+		{
+			std::vector<uint32_t> identity(instanceBuffers.front()->getCapacity());
+			std::iota(identity.begin(), identity.end(), 0u);
+			identityBuffer = CreateScoped<Buffer>(sizeof(uint32_t) * identity.size(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			identityBuffer->copyData(identity.data(), sizeof(uint32_t) * identity.size());
+		}
+
+		size_t frameCount = instanceBuffers.size();
+		m_VisibleInstanceBuffers.resize(frameCount);
+		m_OccludedInstanceBuffers.resize(frameCount);
+		m_LevelInstanceBuffers.resize(frameCount);
+		m_MeshletDispatchBuffers.resize(frameCount);
+		m_LevelBuffers.resize(frameCount);
+		m_MeshletBuffers.resize(frameCount);
+		m_MappedLevels.resize(frameCount);
+		m_MappedMeshlets.resize(frameCount);
+		m_FrameDataBuffers.resize(frameCount);
+		m_StatsBuffers.resize(frameCount);
+		m_MappedStats.resize(frameCount);
+		m_DescriptorData.resize(frameCount);
+		m_DescriptorSets.resize(frameCount);
+		for (size_t i = 0; i < frameCount; i++)
+		{
+			m_VisibleInstanceBuffers[i] = CreateScoped<Buffer>(getVisibleInstanceBufferSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			if (identityBuffer)
+				m_VisibleInstanceBuffers[i]->copyBuffer(identityBuffer->getBuffer(), sizeof(uint32_t) * static_cast<VkDeviceSize>(instanceBuffers.front()->getCapacity()));
+			m_OccludedInstanceBuffers[i] = CreateScoped<Buffer>(occludedInstanceBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			m_LevelInstanceBuffers[i] = CreateScoped<Buffer>(levelInstanceBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			m_MeshletDispatchBuffers[i] = CreateScoped<Buffer>(sizeof(VkDispatchIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			m_LevelBuffers[i] = CreateScoped<Buffer>(levelBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			m_MeshletBuffers[i] = CreateScoped<Buffer>(meshletBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			m_MappedLevels[i] = mapBuffer<CullLevel>(*m_LevelBuffers[i]);
+			m_MappedMeshlets[i] = mapBuffer<CullMeshlet>(*m_MeshletBuffers[i]);
+			m_FrameDataBuffers[i] = CreateScoped<UniformBuffer>(sizeof(CullFrameData));
+			m_FrameDataBuffers[i]->mapMemory();
+			m_StatsBuffers[i] = CreateScoped<Buffer>(sizeof(CullStats), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			m_MappedStats[i] = mapBuffer<CullStats>(*m_StatsBuffers[i]);
+			*m_MappedStats[i] = {};
+
+			std::vector<DescriptorData>& data = m_DescriptorData[i];
+			data = updateTemplate.createData();
+			data[instancesSlot].buffer = { instanceBuffers[i]->getBuffer(), 0, instanceBuffers[i]->getSize() };
+			data[visibleInstancesSlot].buffer = { m_VisibleInstanceBuffers[i]->getBuffer(), 0, getVisibleInstanceBufferSize() };
+			data[drawCommandsSlot].buffer = { batcher.getIndirectBuffer(static_cast<uint32_t>(i)), 0, batcher.getIndirectBufferSize() };
+			data[statsSlot].buffer = { m_StatsBuffers[i]->getBuffer(), 0, sizeof(CullStats) };
+			data[frameSlot].buffer = { m_FrameDataBuffers[i]->getBuffer(), 0, sizeof(CullFrameData) };
+			data[occludedInstancesSlot].buffer = { m_OccludedInstanceBuffers[i]->getBuffer(), 0, occludedInstanceBufferSize };
+			data[levelsSlot].buffer = { m_LevelBuffers[i]->getBuffer(), 0, levelBufferSize };
+			data[meshletsSlot].buffer = { m_MeshletBuffers[i]->getBuffer(), 0, meshletBufferSize };
+			data[levelInstancesSlot].buffer = { m_LevelInstanceBuffers[i]->getBuffer(), 0, levelInstanceBufferSize };
+			data[meshletDispatchSlot].buffer = { m_MeshletDispatchBuffers[i]->getBuffer(), 0, sizeof(VkDispatchIndirectCommand) };
+		}
+
+		updateDepthPyramid();
+	}
+
+	InstanceCuller::~InstanceCuller()
+	{
+		for (size_t i = 0; i < m_StatsBuffers.size(); i++)
+		{
+			vkUnmapMemory(VulkanContext::getDevice(), m_StatsBuffers[i]->getMemory());
+			vkUnmapMemory(VulkanContext::getDevice(), m_LevelBuffers[i]->getMemory());
+			vkUnmapMemory(VulkanContext::getDevice(), m_MeshletBuffers[i]->getMemory());
+		}
+	}
+
+	void InstanceCuller::updateDepthPyramid()
+	{
+		// The pyramid is bound even when not occlusion culling, descriptors the shader declares must be valid
+		m_DescriptorSetCache.clear();
+		const DescriptorUpdateTemplate& updateTemplate = VulkanContext::getPipelineLayoutCache()->getUpdateTemplate(m_Pipeline.getLayoutInfo(), 0);
+		for (size_t i = 0; i < m_DescriptorData.size(); i++)
+		{
+			m_DescriptorData[i][m_DepthPyramidSlot].image = { m_DepthPyramid->getSampler(), m_DepthPyramid->getImageView(), VK_IMAGE_LAYOUT_GENERAL };
+			m_DescriptorSets[i] = m_DescriptorSetCache.getSet(updateTemplate, m_DescriptorData[i]);
+		}
+	}
+
+	bool InstanceCuller::supportsOcclusionCulling(bool occlusionCulling)
+	{
+		// Late draws need GPU written counts like the early ones
+		return occlusionCulling && VulkanContext::getPhysicalDevice()->getCapabilities().multiDrawIndirect;
+	}
+
+	void InstanceCuller::begin(uint32_t frameIndex)
+	{
+		m_FrameIndex = frameIndex;
+		m_Stats = *m_MappedStats[m_FrameIndex];
+		*m_MappedStats[m_FrameIndex] = {};
+		m_Meshlets.clear();
+	}
+
+	void InstanceCuller::record(VkCommandBuffer commandBuffer, const DrawBatcher& batcher, const glm::mat4& viewProjection, const glm::vec3& cameraPosition,
+		float lodErrorScale)
+	{
+		if (!m_Culling || batcher.getBatchCount() == 0)
+			return;
+
+		uint32_t visibleInstanceCount = writeDraws(batcher);
+		ENGINE_ASSERT(visibleInstanceCount <= m_VisibleInstanceCapacity, "Visible instance list is too small for %u instances", visibleInstanceCount);
+
+		Frustum frustum = Frustum::fromViewProjection(viewProjection);
+		VkExtent2D viewport = m_DepthPyramid->getDepthExtent();
+
+		CullFrameData frameData{};
+		std::copy(frustum.planes.begin(), frustum.planes.end(), frameData.frustumPlanes);
+		frameData.viewProjection = viewProjection;
+		frameData.cameraPosition = glm::vec4(cameraPosition, 1.0f);
+		frameData.viewportSize = { static_cast<float>(viewport.width), static_cast<float>(viewport.height) };
+		frameData.pyramidLevelCount = m_DepthPyramid->getLevelCount();
+		if (m_OcclusionCulling)
+			frameData.flags |= FLAG_LATE_PASS;
+		if (m_OcclusionCulling && m_DepthPyramid->hasHistory())
+			frameData.flags |= FLAG_OCCLUSION_HISTORY;
+		frameData.lateVisibleOffset = m_VisibleInstanceCapacity;
+		frameData.lodErrorScale = lodErrorScale;
+		frameData.levelCount = static_cast<uint32_t>(m_Levels.size());
+		frameData.meshletCount = static_cast<uint32_t>(m_Meshlets.size());
+		memcpy(m_FrameDataBuffers[m_FrameIndex]->getMappedMemory(), &frameData, sizeof(frameData));
+
+		m_Pipeline.bind(commandBuffer);
+		DescriptorBinding::bindSet(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline.getLayout(), 0, m_DescriptorSets[m_FrameIndex]);
+
+		// Every mesh's instances pick their levels, then the levels' lists place the draws in the visible list
+		const VkPushConstantRange& range = m_Pipeline.getLayoutInfo().pushConstantRanges[0];
+		CullPushConstants constants{};
+		constants.step = STEP_SELECT_LEVELS;
+		for (const CullGroup& group : m_Groups)
+		{
+			constants.lodSphere = group.lodSphere;
+			constants.firstInstance = group.firstInstance;
+			constants.instanceCount = group.instanceCount;
+			constants.firstLevel = group.firstLevel;
+			constants.levelCount = group.levelCount;
+			vkCmdPushConstants(commandBuffer, m_Pipeline.getLayout(), range.stageFlags, range.offset, sizeof(constants), &constants);
+			vkCmdDispatch(commandBuffer, (group.instanceCount + s_WorkgroupSize - 1) / s_WorkgroupSize, 1, 1);
+		}
+		recordBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+		constants = {};
+		constants.step = STEP_PLACE_DRAWS;
+		vkCmdPushConstants(commandBuffer, m_Pipeline.getLayout(), range.stageFlags, range.offset, sizeof(constants), &constants);
+		vkCmdDispatch(commandBuffer, 1, 1, 1);
+		recordBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+		dispatchMeshlets(commandBuffer, EarlyPass);
+	}
+
+	void InstanceCuller::recordLate(VkCommandBuffer commandBuffer)
+	{
+		ENGINE_ASSERT(m_OcclusionCulling, "The late cull pass only runs with occlusion culling");
+		if (m_Meshlets.empty())
+			return;
+
+		m_Pipeline.bind(commandBuffer);
+		DescriptorBinding::bindSet(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline.getLayout(), 0, m_DescriptorSets[m_FrameIndex]);
+		dispatchMeshlets(commandBuffer, LatePass);
+	}
+
+	// Sized on the GPU by the early pass, the late pass retests the same meshlet instances
+	void InstanceCuller::dispatchMeshlets(VkCommandBuffer commandBuffer, Pass pass)
+	{
+		const VkPushConstantRange& range = m_Pipeline.getLayoutInfo().pushConstantRanges[0];
+		CullPushConstants constants{};
+		constants.step = STEP_CULL_MESHLETS;
+		constants.pass = pass;
+		vkCmdPushConstants(commandBuffer, m_Pipeline.getLayout(), range.stageFlags, range.offset, sizeof(constants), &constants);
+		vkCmdDispatchIndirect(commandBuffer, m_MeshletDispatchBuffers[m_FrameIndex]->getBuffer(), 0);
+
+		// Counts are read as indirect parameters, the lists by the vertex shaders, the occlusion results and stats
+		// by the late pass and the stats by the host after the fence
+		recordBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+			VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_HOST_READ_BIT);
+	}
+
+	uint32_t InstanceCuller::writeDraws(const DrawBatcher& batcher)
+	{
+		// Draws of the same instances belong to one mesh, its levels are ordered by their error
+		const std::vector<DrawBatch>& batches = batcher.getBatches();
+		m_DrawOrder.clear();
+		for (uint32_t batch = 0; batch < batches.size(); batch++)
+		{
+			for (uint32_t command = 0; command < batches[batch].commands.size(); command++)
+			{
+				m_DrawOrder.push_back({ batch, command });
+			}
+		}
+		std::sort(m_DrawOrder.begin(), m_DrawOrder.end(), [&batches](const DrawRef& a, const DrawRef& b)
+			{
+				uint32_t firstInstanceA = batches[a.batch].commands[a.command].firstInstance, firstInstanceB = batches[b.batch].commands[b.command].firstInstance;
+				if (firstInstanceA != firstInstanceB)
+					return firstInstanceA < firstInstanceB;
+				return batches[a.batch].lodErrors[a.command].x < batches[b.batch].lodErrors[b.command].x;
+			});
+
+		m_Groups.clear();
+		m_Levels.clear();
+		m_Meshlets.clear();
+		uint32_t listEntryCount = 0;
+		for (const DrawRef& draw : m_DrawOrder)
+		{
+			const DrawBatch& batch = batches[draw.batch];
+			const VkDrawIndexedIndirectCommand& command = batch.commands[draw.command];
+			if (m_Groups.empty() || m_Groups.back().firstInstance != command.firstInstance)
+				m_Groups.push_back({ batch.lodSpheres[draw.command], command.firstInstance, command.instanceCount, static_cast<uint32_t>(m_Levels.size()), 0 });
+			CullGroup& group = m_Groups.back();
+			ENGINE_ASSERT(group.instanceCount == command.instanceCount, "Draws starting at instance %u draw different instance counts", command.firstInstance);
+
+			if (group.levelCount == 0 || m_Levels.back().lodErrors != batch.lodErrors[draw.command])
+			{
+				m_Levels.push_back({ batch.lodErrors[draw.command], static_cast<uint32_t>(m_Meshlets.size()), 0, listEntryCount });
+				listEntryCount += group.instanceCount;
+				group.levelCount++;
+			}
+			m_Levels.back().meshletCount++;
+
+			// Draws whose back faces are drawn never face away
+			CullMeshlet& meshlet = m_Meshlets.emplace_back();
+			meshlet.boundingSphere = batch.boundingSpheres[draw.command];
+			meshlet.normalCone = batch.cullMode & VK_CULL_MODE_BACK_BIT ? batch.normalCones[draw.command] : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+			meshlet.level = static_cast<uint32_t>(m_Levels.size() - 1);
+			meshlet.firstInstanceWord = batch.indexed ? INDEXED_FIRST_INSTANCE_WORD : FIRST_INSTANCE_WORD;
+			for (size_t pass = 0; pass < batch.commandOffsets.size(); pass++)
+			{
+				meshlet.commandWords[pass] = static_cast<uint32_t>((batch.commandOffsets[pass] + batch.commandStride * draw.command) / sizeof(uint32_t));
+			}
+		}
+		ENGINE_ASSERT(listEntryCount <= m_LevelInstanceCapacity, "Level instance lists are too small for %u entries", listEntryCount);
+		ENGINE_ASSERT(m_Levels.size() <= m_MaxDraws && m_Meshlets.size() <= m_MaxDraws, "More cull levels or meshlets than draws");
+		std::copy(m_Levels.begin(), m_Levels.end(), m_MappedLevels[m_FrameIndex]);
+		std::copy(m_Meshlets.begin(), m_Meshlets.end(), m_MappedMeshlets[m_FrameIndex]);
+
+		// Every instance of a mesh may pick its level with the most meshlets
+		uint32_t visibleInstanceCount = 0;
+		for (const CullGroup& group : m_Groups)
+		{
+			uint32_t maxMeshletCount = 0;
+			for (uint32_t level = group.firstLevel; level < group.firstLevel + group.levelCount; level++)
+			{
+				maxMeshletCount = std::max(maxMeshletCount, m_Levels[level].meshletCount);
+			}
+			visibleInstanceCount += group.instanceCount * maxMeshletCount;
+		}
+		return visibleInstanceCount;
+	}
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "Core.h"
+#include "Buffers/InstanceBuffer.h"
+#include "Camera/Frustum.h"
+#include "Descriptors/DescriptorSetCache.h"
+#include "Buffers/UniformBuffer.h"
+#include "Pipeline/ComputePipeline.h"
+#include "Renderer/DepthPyramid.h"
+#include "Renderer/DrawBatcher.h"
+
+namespace vkEngine
+{
+	// Instances that passed and failed culling in one frame. Past the instance step every meshlet of an instance counts once
+	struct CullStats
+	{
+		uint32_t visible = 0; // Meshlet instances drawn
+		uint32_t culled = 0; // Instances outside the frustum, and meshlet instances of the rest
+		uint32_t backFacing = 0; // Every triangle of the meshlet faces away, see MeshAllocation::normalCone
+		uint32_t occluded = 0; // Hidden behind the depth pyramid in both passes
+	};
+
+	// Culls the batched draws on the GPU in a compute pass recorded ahead of rendering. Draws of the same instances are the
+	// meshlets of one mesh's levels of detail. Every instance is first culled against the frustum as a whole and listed
+	// under the level it picks, see MeshAllocation::lodErrors, one dispatch per mesh. The level lists then size the draws'
+	// ranges of the visible instance list, and a single indirect dispatch culls only the picked level's meshlets of every
+	// listed instance, against the frustum and, for draws whose back faces are culled, against the camera.
+	// Visible instances are compacted into the frame's visible instance list and counted straight into the indirect
+	// commands, so the draw counts never travel back to the CPU. Without multi draw indirect nothing is dispatched, the
+	// CPU culls and draws with its own counts and the list maps every instance to itself.
+	//
+	// With occlusion culling the frame is drawn in two passes. The early pass also tests meshlets against the depth
+	// pyramid of the previous frame and draws what it does not hide. Once the pyramid is rebuilt from that depth, the late
+	// pass tests the hidden meshlets again and draws those that became visible, so nothing the previous frame's depth
+	// wrongly hides goes missing. Each pass has its own draw commands and part of the visible list, see DrawBatcher::build.
+	class InstanceCuller
+	{
+	public:
+		static constexpr uint32_t s_WorkgroupSize = 64; // local_size_x of the cull shader
+
+		// Matches EARLY_PASS and LATE_PASS in the cull shader
+		enum Pass : uint32_t
+		{
+			EarlyPass,
+			LatePass
+		};
+
+		// The lists are sized for every instance of the instance buffers picking a level of maxLevelMeshlets meshlets, out of
+		// at most maxLevelCount levels of detail per mesh
+		InstanceCuller(const std::vector<Shared<InstanceBuffer>>& instanceBuffers, const DrawBatcher& batcher, const DepthPyramid& depthPyramid,
+			uint32_t maxLevelMeshlets, uint32_t maxLevelCount, bool occlusionCulling);
+		~InstanceCuller();
+
+		// Whether an InstanceCuller created with occlusionCulling set would cull by occlusion on this device
+		static bool supportsOcclusionCulling(bool occlusionCulling);
+
+		InstanceCuller(const InstanceCuller&) = delete;
+		InstanceCuller& operator=(const InstanceCuller&) = delete;
+
+		// Reads back the stats of the frame slot's previous use, call once its fence has signaled
+		void begin(uint32_t frameIndex);
+		// Dispatches the (early) pass over every built batch when culling. The batches must have been built with zeroed
+		// instance counts and getPassCount() passes, the pass writes the first instances of their commands. Levels of detail
+		// are picked with lodErrorScale, see MeshLodChain::getErrorScale
+		void record(VkCommandBuffer commandBuffer, const DrawBatcher& batcher, const glm::mat4& viewProjection, const glm::vec3& cameraPosition,
+			float lodErrorScale);
+		// Dispatches the late pass, once the depth pyramid was built from the early pass's depth
+		void recordLate(VkCommandBuffer commandBuffer);
+		// Points the sets at the recreated depth pyramid after a resize, the GPU must be done with every frame
+		void updateDepthPyramid();
+
+		// Whether draw instance counts are written by the GPU
+		bool isCulling() const { return m_Culling; }
+		bool isOcclusionCulling() const { return m_OcclusionCulling; }
+		uint32_t getPassCount() const { return m_OcclusionCulling ? 2 : 1; }
+		uint32_t getVisibleInstanceCapacity() const { return m_VisibleInstanceCapacity; }
+		const CullStats& getStats() const { return m_Stats; }
+		VkBuffer getVisibleInstanceBuffer(uint32_t frameIndex) const { return m_VisibleInstanceBuffers[frameIndex]->getBuffer(); }
+		VkDeviceSize getVisibleInstanceBufferSize() const { return sizeof(uint32_t) * static_cast<VkDeviceSize>(m_VisibleInstanceCapacity) * getPassCount(); }
+
+	private:
+		// Matches CullLevel in the cull shader
+		struct CullLevel
+		{
+			glm::vec2 lodErrors;
+			uint32_t firstMeshlet;
+			uint32_t meshletCount;
+			uint32_t firstListEntry;
+			uint32_t instanceCount;
+			uint32_t firstVisible;
+			uint32_t padding;
+		};
+
+		// Matches CullMeshlet in the cull shader
+		struct CullMeshlet
+		{
+			glm::vec4 boundingSphere;
+			glm::vec4 normalCone;
+			uint32_t level;
+			uint32_t firstInstanceWord;
+			uint32_t commandWords[2];
+		};
+
+		// Instances of one mesh, their levels follow each other in the level list
+		struct CullGroup
+		{
+			glm::vec4 lodSphere;
+			uint32_t firstInstance;
+			uint32_t instanceCount;
+			uint32_t firstLevel;
+			uint32_t levelCount;
+		};
+
+		struct DrawRef
+		{
+			uint32_t batch;
+			uint32_t command;
+		};
+
+		// Groups the batches' draws by mesh and level, returns the length of a pass's part of the visible list at worst
+		uint32_t writeDraws(const DrawBatcher& batcher);
+		void dispatchMeshlets(VkCommandBuffer commandBuffer, Pass pass);
+
+	private:
+		ComputePipeline m_Pipeline;
+		DescriptorSetCache m_DescriptorSetCache;
+		std::vector<DescriptorHandle> m_DescriptorSets{};
+		std::vector<std::vector<DescriptorData>> m_DescriptorData{}; // Per frame, kept to rewrite the sets on resize
+		uint32_t m_DepthPyramidSlot = 0;
+		const DepthPyramid* m_DepthPyramid = nullptr;
+
+		std::vector<Scoped<Buffer>> m_VisibleInstanceBuffers{};
+		std::vector<Scoped<Buffer>> m_OccludedInstanceBuffers{}; // Early pass results read by the late pass, indexed like the visible list
+		std::vector<Scoped<Buffer>> m_LevelInstanceBuffers{};
+		std::vector<Scoped<Buffer>> m_MeshletDispatchBuffers{};
+		std::vector<Scoped<Buffer>> m_LevelBuffers{}; // Host visible like the meshlets, rewritten every frame
+		std::vector<Scoped<Buffer>> m_MeshletBuffers{};
+		std::vector<CullLevel*> m_MappedLevels{};
+		std::vector<CullMeshlet*> m_MappedMeshlets{};
+		std::vector<Scoped<UniformBuffer>> m_FrameDataBuffers{};
+		std::vector<Scoped<Buffer>> m_StatsBuffers{}; // Host visible, read back once the frame has completed
+		std::vector<CullStats*> m_MappedStats{};
+
+		std::vector<DrawRef> m_DrawOrder{};
+		std::vector<CullGroup> m_Groups{};
+		std::vector<CullLevel> m_Levels{};
+		std::vector<CullMeshlet> m_Meshlets{};
+
+		uint32_t m_VisibleInstanceCapacity = 0;
+		uint32_t m_LevelInstanceCapacity = 0;
+		uint32_t m_MaxDraws = 0;
+		uint32_t m_FrameIndex = 0;
+		bool m_Culling = false;
+		bool m_OcclusionCulling = false;
+		CullStats m_Stats{};
+	};
+}
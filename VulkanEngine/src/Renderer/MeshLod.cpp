@@ -0,0 +1,368 @@
+#include "pch.h"
+#include "MeshLod.h"
+
+#include <functional>
+#include <numeric>
+#include <unordered_map>
+
+#include "Buffers/GeometryPool.h"
+
+namespace vkEngine
+{
+	namespace
+	{
+		// A level keeping more of the previous level's triangles than this ends the chain, seams and borders stopped it
+		constexpr float MAX_LEVEL_KEPT_RATIO = 0.85f;
+		// Collapses turning a triangle's normal by more than about 75 degrees fold the surface and are rejected
+		constexpr float MIN_NORMAL_DOT = 0.25f;
+		// Collapses of a pass may cost this much more than the one that would reach the pass's goal
+		constexpr double COST_LIMIT_SCALE = 1.5;
+
+		// How far a position may move, ordered by restriction
+		constexpr uint8_t INTERIOR = 0;
+		constexpr uint8_t BORDER = 1; // Only along its border edges
+		constexpr uint8_t LOCKED = 2;
+
+		// Sum of squared distances to a set of planes, as the symmetric matrix A, vector b and constant c of
+		// p * A * p + 2 * b * p + c
+		struct Quadric
+		{
+			double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+			double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+			double c = 0.0;
+
+			static Quadric fromPlane(const glm::vec3& normal, float distance)
+			{
+				double x = normal.x, y = normal.y, z = normal.z, d = distance;
+				return { x * x, x * y, x * z, y * y, y * z, z * z, x * d, y * d, z * d, d * d };
+			}
+
+			Quadric& operator+=(const Quadric& other)
+			{
+				a00 += other.a00; a01 += other.a01; a02 += other.a02; a11 += other.a11; a12 += other.a12; a22 += other.a22;
+				b0 += other.b0; b1 += other.b1; b2 += other.b2;
+				c += other.c;
+				return *this;
+			}
+
+			double evaluate(const glm::vec3& point) const
+			{
+				double x = point.x, y = point.y, z = point.z;
+				double result = x * x * a00 + y * y * a11 + z * z * a22 + 2.0 * (x * y * a01 + x * z * a02 + y * z * a12)
+					+ 2.0 * (x * b0 + y * b1 + z * b2) + c;
+				return std::max(result, 0.0);
+			}
+		};
+
+		// Moves source onto target, the edge between them and the triangles sharing it disappear
+		struct Collapse
+		{
+			uint32_t source;
+			uint32_t target;
+			double cost;
+		};
+
+		uint64_t edgeKey(uint32_t a, uint32_t b)
+		{
+			return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+		}
+
+		// Simplifies towards every target in turn, targets decreasing, and hands each result with its error to onLevel.
+		// Collapses continue from one target to the next, so all errors stay relative to the full detail mesh.
+		// Ends early once no collapse is left
+		void simplifyLevels(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::vector<size_t>& targetIndexCounts,
+			const std::function<void(const std::vector<uint32_t>&, float)>& onLevel)
+		{
+			ENGINE_ASSERT(indices.size() % 3 == 0, "Meshes are simplified as triangle lists");
+
+			// Collapses move positions. Vertices sharing a position are the sides of a texture seam and move together
+			std::vector<uint32_t> welded = GeometryPool::weldPositions(vertices);
+			std::vector<uint32_t> positionOffsets(vertices.size() + 1, 0);
+			for (uint32_t position : welded)
+			{
+				positionOffsets[position + 1]++;
+			}
+			std::partial_sum(positionOffsets.begin(), positionOffsets.end(), positionOffsets.begin());
+			std::vector<uint32_t> positionVertices(vertices.size());
+			{
+				std::vector<uint32_t> fill(positionOffsets.begin(), positionOffsets.end() - 1);
+				for (uint32_t v = 0; v < vertices.size(); v++)
+				{
+					positionVertices[fill[welded[v]]++] = v;
+				}
+			}
+
+			auto countEdgeUses = [&welded](const std::vector<uint32_t>& triangles, std::unordered_map<uint64_t, uint32_t>& edgeUses)
+				{
+					edgeUses.clear();
+					for (size_t i = 0; i < triangles.size(); i += 3)
+					{
+						for (size_t k = 0; k < 3; k++)
+						{
+							edgeUses[edgeKey(welded[triangles[i + k]], welded[triangles[i + (k + 1) % 3]])]++;
+						}
+					}
+				};
+			std::unordered_map<uint64_t, uint32_t> edgeUses;
+			edgeUses.reserve(indices.size());
+			countEdgeUses(indices, edgeUses);
+
+			// Planes of the triangles around each position, border edges add a plane standing on the edge to hold the outline
+			std::vector<Quadric> quadrics(vertices.size());
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				const glm::vec3& p0 = vertices[indices[i]].position;
+				glm::vec3 normal = glm::cross(vertices[indices[i + 1]].position - p0, vertices[indices[i + 2]].position - p0);
+				float length = glm::length(normal);
+				if (length <= 0.0f)
+					continue;
+
+				normal /= length;
+				Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, p0));
+				for (size_t k = 0; k < 3; k++)
+				{
+					uint32_t a = welded[indices[i + k]], b = welded[indices[i + (k + 1) % 3]];
+					quadrics[a] += plane;
+					if (edgeUses[edgeKey(a, b)] != 1)
+						continue;
+
+					glm::vec3 edge = vertices[b].position - vertices[a].position;
+					glm::vec3 borderNormal = glm::cross(edge, normal);
+					float borderLength = glm::length(borderNormal);
+					if (borderLength <= 0.0f)
+						continue;
+
+					borderNormal /= borderLength;
+					Quadric border = Quadric::fromPlane(borderNormal, -glm::dot(borderNormal, vertices[a].position));
+					quadrics[a] += border;
+					quadrics[b] += border;
+				}
+			}
+
+			std::vector<uint32_t> result = indices;
+			std::vector<uint32_t> remap(vertices.size());
+			std::iota(remap.begin(), remap.end(), 0);
+			std::vector<uint8_t> kinds(vertices.size());
+			std::vector<bool> touched(vertices.size());
+			std::vector<uint32_t> triangleOffsets(vertices.size() + 1);
+			std::vector<uint32_t> vertexTriangles;
+			std::vector<Collapse> collapses;
+			std::vector<std::pair<uint32_t, uint32_t>> moves; // Vertex and the one it collapses onto
+			double maxCost = 0.0;
+
+			// Every pass collapses the cheapest edges whose positions no earlier collapse of the pass touched
+			bool stuck = false;
+			for (size_t targetIndexCount : targetIndexCounts)
+			{
+				while (!stuck && result.size() > targetIndexCount)
+				{
+					// Edges of a single triangle are borders, positions on one only move along it. Edges of more than two
+					// triangles are not manifold and stay where they are
+					countEdgeUses(result, edgeUses);
+					std::fill(kinds.begin(), kinds.end(), INTERIOR);
+					for (const auto& [key, uses] : edgeUses)
+					{
+						uint8_t kind = uses == 1 ? BORDER : uses > 2 ? LOCKED : INTERIOR;
+						uint32_t a = static_cast<uint32_t>(key >> 32), b = static_cast<uint32_t>(key);
+						kinds[a] = std::max(kinds[a], kind);
+						kinds[b] = std::max(kinds[b], kind);
+					}
+
+					collapses.clear();
+					for (size_t i = 0; i < result.size(); i += 3)
+					{
+						for (size_t k = 0; k < 3; k++)
+						{
+							uint32_t a = welded[result[i + k]], b = welded[result[i + (k + 1) % 3]];
+							bool borderEdge = edgeUses[edgeKey(a, b)] == 1;
+							Quadric quadric = quadrics[a];
+							quadric += quadrics[b];
+							if (kinds[a] == INTERIOR || (kinds[a] == BORDER && borderEdge))
+								collapses.push_back({ a, b, quadric.evaluate(vertices[b].position) });
+							if (kinds[b] == INTERIOR || (kinds[b] == BORDER && borderEdge))
+								collapses.push_back({ b, a, quadric.evaluate(vertices[a].position) });
+						}
+					}
+					if (collapses.empty())
+					{
+						stuck = true;
+						break;
+					}
+					std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+					std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+					for (uint32_t index : result)
+					{
+						triangleOffsets[index + 1]++;
+					}
+					std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+					vertexTriangles.resize(result.size());
+					std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+					for (size_t i = 0; i < result.size(); i++)
+					{
+						vertexTriangles[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+					}
+
+					// Every edge is listed about four times, once per triangle and direction. Collapses far costlier than the one
+					// the goal would reach wait for a later pass, where the quadrics have caught up with the cheaper ones
+					size_t removeGoal = (result.size() - targetIndexCount) / 3;
+					double costLimit = collapses[std::min(removeGoal * 2, collapses.size() - 1)].cost * COST_LIMIT_SCALE;
+
+					std::fill(touched.begin(), touched.end(), false);
+					size_t removed = 0;
+					for (const Collapse& collapse : collapses)
+					{
+						if (removed >= removeGoal || (removed > 0 && collapse.cost > costLimit))
+							break;
+
+						uint32_t source = collapse.source, target = collapse.target;
+						if (touched[source] || touched[target])
+							continue;
+
+						// Every side of a seam moves onto the vertex it shares an edge with, sides without exactly one such
+						// vertex would lose their texture mapping. The other triangles around the source must keep facing the
+						// same way, those sharing the edge disappear
+						const glm::vec3& targetPosition = vertices[target].position;
+						bool valid = true;
+						size_t removes = 0;
+						moves.clear();
+						for (uint32_t p = positionOffsets[source]; p < positionOffsets[source + 1] && valid; p++)
+						{
+							uint32_t vertex = positionVertices[p];
+							if (triangleOffsets[vertex] == triangleOffsets[vertex + 1])
+								continue;
+
+							uint32_t moveTarget = UINT32_MAX;
+							for (uint32_t i = triangleOffsets[vertex]; i < triangleOffsets[vertex + 1] && valid; i++)
+							{
+								const uint32_t* triangle = &result[vertexTriangles[i] * 3];
+								glm::vec3 corners[3], moved[3];
+								bool sharesEdge = false;
+								for (uint32_t k = 0; k < 3; k++)
+								{
+									uint32_t corner = remap[triangle[k]];
+									if (welded[corner] == target)
+									{
+										sharesEdge = true;
+										valid &= moveTarget == UINT32_MAX || moveTarget == corner;
+										moveTarget = corner;
+									}
+									corners[k] = vertices[corner].position;
+									moved[k] = corner == vertex ? targetPosition : corners[k];
+								}
+								if (sharesEdge)
+								{
+									removes++;
+									continue;
+								}
+
+								glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+								glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+								valid &= glm::dot(before, after) > MIN_NORMAL_DOT * glm::length(before) * glm::length(after);
+							}
+
+							valid &= moveTarget != UINT32_MAX;
+							moves.emplace_back(vertex, moveTarget);
+						}
+						if (!valid || moves.empty())
+							continue;
+
+						for (const auto& [vertex, moveTarget] : moves)
+						{
+							remap[vertex] = moveTarget;
+						}
+						quadrics[target] += quadrics[source];
+						touched[source] = true;
+						touched[target] = true;
+						maxCost = std::max(maxCost, collapse.cost);
+						removed += removes;
+					}
+
+					if (removed == 0)
+					{
+						stuck = true;
+						break;
+					}
+
+					// Triangles left with two corners at one position have collapsed
+					size_t kept = 0;
+					for (size_t i = 0; i < result.size(); i += 3)
+					{
+						uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+						if (welded[a] == welded[b] || welded[b] == welded[c] || welded[a] == welded[c])
+							continue;
+
+						result[kept++] = a;
+						result[kept++] = b;
+						result[kept++] = c;
+					}
+					result.resize(kept);
+				}
+
+				// The quadrics sum squared distances to every plane merged into a position, so the root bounds the farthest one
+				onLevel(result, static_cast<float>(std::sqrt(maxCost)));
+				if (stuck)
+					break;
+			}
+		}
+	}
+
+	MeshLodChain MeshLodChain::build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t maxLevels, float triangleRatio)
+	{
+		ENGINE_ASSERT(maxLevels >= 1 && triangleRatio > 0.0f && triangleRatio < 1.0f, "Invalid level of detail settings");
+
+		MeshLodChain chain;
+		chain.indices = indices;
+		chain.levels.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+
+		std::vector<size_t> targetIndexCounts;
+		for (size_t triangles = indices.size() / 3; targetIndexCounts.size() + 1 < maxLevels; )
+		{
+			triangles = static_cast<size_t>(static_cast<float>(triangles) * triangleRatio);
+			if (triangles == 0)
+				break;
+			targetIndexCounts.push_back(triangles * 3);
+		}
+
+		bool ended = false;
+		simplifyLevels(vertices, indices, targetIndexCounts, [&chain, &ended](const std::vector<uint32_t>& levelIndices, float error)
+			{
+				const MeshLod& previous = chain.levels.back();
+				ended |= levelIndices.empty() || levelIndices.size() > previous.indexCount * MAX_LEVEL_KEPT_RATIO;
+				if (ended)
+					return;
+
+				chain.levels.push_back({ static_cast<uint32_t>(chain.indices.size()), static_cast<uint32_t>(levelIndices.size()), std::max(error, previous.error) });
+				chain.indices.insert(chain.indices.end(), levelIndices.begin(), levelIndices.end());
+			});
+
+		return chain;
+	}
+
+	std::vector<uint32_t> MeshLodChain::simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float& error)
+	{
+		std::vector<uint32_t> result;
+		simplifyLevels(vertices, indices, { targetIndexCount }, [&result, &error](const std::vector<uint32_t>& levelIndices, float levelError)
+			{
+				result = levelIndices;
+				error = levelError;
+			});
+		return result;
+	}
+
+	float MeshLodChain::getErrorScale(float verticalFov, float viewportHeight, float pixelError)
+	{
+		return viewportHeight / (2.0f * std::tan(verticalFov * 0.5f)) / pixelError;
+	}
+
+	uint32_t MeshLodChain::selectLevel(const std::vector<MeshLod>& levels, float distance, float errorScale)
+	{
+		float maxError = distance / errorScale;
+		uint32_t level = 0;
+		while (level + 1 < levels.size() && levels[level + 1].error <= maxError)
+		{
+			level++;
+		}
+		return level;
+	}
+}
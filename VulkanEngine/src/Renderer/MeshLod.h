@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Buffers/Buffer.h"
+
+namespace vkEngine
+{
+	// One level of detail, a range of MeshLodChain::indices
+	struct MeshLod
+	{
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		float error = 0.0f; // Approximate mesh space distance the level deviates from the full detail surface by, 0 for level 0
+	};
+
+	// Levels of detail of a mesh, simplified one after the other from the full detail indices and drawn with the same
+	// vertices. Level 0 is the full detail mesh, the errors grow with the level.
+	struct MeshLodChain
+	{
+		static constexpr uint32_t s_MaxLevels = 6;
+		static constexpr float s_TriangleRatio = 0.5f; // Triangles each level aims to keep of the previous one
+
+		std::vector<uint32_t> indices{};
+		std::vector<MeshLod> levels{};
+
+		// Meant for load or cook time. The chain ends early once a level cannot be reduced enough any more
+		static MeshLodChain build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+			uint32_t maxLevels = s_MaxLevels, float triangleRatio = s_TriangleRatio);
+
+		// Quadric error metric edge collapse towards targetIndexCount indices. Positions collapse onto a neighbouring one, so
+		// the result indexes the same vertices. Texture seams only collapse along the seam and open borders along the border,
+		// which keeps the texture mapping and outlines but may leave the result above the target.
+		// error receives the mesh space error of the result
+		static std::vector<uint32_t> simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+			size_t targetIndexCount, float& error);
+
+		// Pixels per unit of mesh space error seen from a distance of 1, divided by the pixel error allowed on screen
+		static float getErrorScale(float verticalFov, float viewportHeight, float pixelError);
+		// Coarsest level whose error, seen from distance, stays within the allowed pixel error. Matches the cull shader
+		static uint32_t selectLevel(const std::vector<MeshLod>& levels, float distance, float errorScale);
+	};
+}
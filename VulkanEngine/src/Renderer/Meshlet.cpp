@@ -0,0 +1,248 @@
+#include "pch.h"
+#include "Meshlet.h"
+
+#include <cfloat>
+
+namespace vkEngine
+{
+	namespace
+	{
+		constexpr uint32_t NO_MESHLET = UINT32_MAX;
+		constexpr float MIN_CONE_AXIS_LENGTH = 1e-6f;
+		// Triangles spreading further than this from the average normal leave the cone too wide to ever cull the meshlet
+		constexpr float MIN_CONE_DOT = 0.1f;
+		// Unused triangles following the seed that are considered once a meshlet runs out of neighbours
+		constexpr uint32_t FALLBACK_WINDOW = 256;
+		// How much a candidate's distance grows as its normal turns away from the meshlet's, narrows the normal cones
+		constexpr float NORMAL_WEIGHT = 4.0f;
+
+		glm::vec3 triangleNormal(const std::vector<Vertex>& vertices, const uint32_t* triangle)
+		{
+			const glm::vec3& p0 = vertices[triangle[0]].position;
+			glm::vec3 normal = glm::cross(vertices[triangle[1]].position - p0, vertices[triangle[2]].position - p0);
+			float length = glm::length(normal);
+			return length > 0.0f ? normal / length : glm::vec3{ 0.0f };
+		}
+
+		// Triangles using each welded vertex, as offsets into one shared list
+		struct VertexTriangles
+		{
+			std::vector<uint32_t> offsets{};
+			std::vector<uint32_t> triangles{};
+
+			VertexTriangles(const std::vector<uint32_t>& welded, const std::vector<uint32_t>& indices)
+				: offsets(welded.size() + 1, 0),
+				triangles(indices.size())
+			{
+				for (uint32_t index : indices)
+				{
+					offsets[welded[index] + 1]++;
+				}
+				for (size_t v = 0; v < welded.size(); v++)
+				{
+					offsets[v + 1] += offsets[v];
+				}
+
+				std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+				for (size_t i = 0; i < indices.size(); i++)
+				{
+					triangles[fill[welded[indices[i]]]++] = static_cast<uint32_t>(i / 3);
+				}
+			}
+		};
+
+		// Sphere around the center of the bounding box, like GeometryPool::computeBoundingSphere
+		glm::vec4 computeBoundingSphere(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& meshletVertices)
+		{
+			glm::vec3 min{ FLT_MAX }, max{ -FLT_MAX };
+			for (uint32_t v : meshletVertices)
+			{
+				min = glm::min(min, vertices[v].position);
+				max = glm::max(max, vertices[v].position);
+			}
+
+			glm::vec3 center = (min + max) * 0.5f;
+			float radiusSquared = 0.0f;
+			for (uint32_t v : meshletVertices)
+			{
+				glm::vec3 offset = vertices[v].position - center;
+				radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+			}
+			return glm::vec4{ center, std::sqrt(radiusSquared) };
+		}
+
+		// Cone holding every front face normal. The cutoff is the sine of the widest angle to the axis, so the meshlet faces
+		// away from a viewer once dot(center - viewer, axis) >= cutoff * length(center - viewer) + radius
+		glm::vec4 computeNormalCone(const std::vector<Vertex>& vertices, const uint32_t* indices, uint32_t triangleCount)
+		{
+			std::vector<glm::vec3> normals;
+			normals.reserve(triangleCount);
+			glm::vec3 axis{ 0.0f };
+			for (uint32_t t = 0; t < triangleCount; t++)
+			{
+				glm::vec3 normal = triangleNormal(vertices, indices + t * 3);
+				if (normal == glm::vec3{ 0.0f })
+					continue;
+
+				normals.push_back(normal);
+				axis += normal;
+			}
+
+			float axisLength = glm::length(axis);
+			if (axisLength < MIN_CONE_AXIS_LENGTH)
+				return { 0.0f, 0.0f, 0.0f, 1.0f };
+			axis /= axisLength;
+
+			float minDot = 1.0f;
+			for (const glm::vec3& normal : normals)
+			{
+				minDot = std::min(minDot, glm::dot(normal, axis));
+			}
+			if (minDot <= MIN_CONE_DOT)
+				return { 0.0f, 0.0f, 0.0f, 1.0f };
+
+			return { axis, std::sqrt(1.0f - minDot * minDot) };
+		}
+	}
+
+	MeshletMesh MeshletMesh::build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t maxVertices, uint32_t maxTriangles)
+	{
+		ENGINE_ASSERT(indices.size() % 3 == 0, "Meshlets are built from triangle lists");
+		ENGINE_ASSERT(maxVertices >= 3 && maxTriangles >= 1, "Meshlet limits must fit at least one triangle");
+
+		uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+		std::vector<uint32_t> welded = GeometryPool::weldPositions(vertices);
+		VertexTriangles vertexTriangles(welded, indices);
+		std::vector<bool> usedTriangles(triangleCount, false);
+		std::vector<uint32_t> vertexMeshlet(vertices.size(), NO_MESHLET); // Meshlet that last took each vertex
+
+		MeshletMesh mesh;
+		mesh.indices.reserve(indices.size());
+
+		std::vector<uint32_t> meshletVertices;
+		uint32_t nextSeed = 0;
+		uint32_t placedTriangles = 0;
+		while (placedTriangles < triangleCount)
+		{
+			uint32_t meshletIndex = static_cast<uint32_t>(mesh.meshlets.size());
+			Meshlet meshlet{};
+			meshlet.firstIndex = static_cast<uint32_t>(mesh.indices.size());
+			meshletVertices.clear();
+			glm::vec3 centroidSum{ 0.0f };
+			glm::vec3 normalSum{ 0.0f };
+
+			auto newVertexCount = [&](uint32_t triangle)
+				{
+					uint32_t count = 0;
+					for (uint32_t k = 0; k < 3; k++)
+					{
+						count += vertexMeshlet[indices[triangle * 3 + k]] != meshletIndex ? 1 : 0;
+					}
+					return count;
+				};
+
+			auto addTriangle = [&](uint32_t triangle)
+				{
+					for (uint32_t k = 0; k < 3; k++)
+					{
+						uint32_t vertex = indices[triangle * 3 + k];
+						if (vertexMeshlet[vertex] != meshletIndex)
+						{
+							vertexMeshlet[vertex] = meshletIndex;
+							meshletVertices.push_back(vertex);
+						}
+						mesh.indices.push_back(vertex);
+						centroidSum += vertices[vertex].position;
+					}
+					normalSum += triangleNormal(vertices, &indices[triangle * 3]);
+					usedTriangles[triangle] = true;
+					meshlet.triangleCount++;
+					placedTriangles++;
+				};
+
+			while (usedTriangles[nextSeed])
+			{
+				nextSeed++;
+			}
+			addTriangle(nextSeed);
+
+			// Triangles touching the meshlet are preferred, then the nearest of the unused ones following the seed.
+			// The meshlet ends when no candidate fits
+			while (meshlet.triangleCount < maxTriangles)
+			{
+				glm::vec3 center = centroidSum / static_cast<float>(meshlet.triangleCount * 3);
+				float normalLength = glm::length(normalSum);
+				glm::vec3 averageNormal = normalLength > 0.0f ? normalSum / normalLength : glm::vec3{ 0.0f };
+				uint32_t bestTriangle = UINT32_MAX, bestNewVertices = UINT32_MAX;
+				float bestDistance = FLT_MAX;
+				auto consider = [&](uint32_t triangle)
+					{
+						uint32_t newVertices = newVertexCount(triangle);
+						if (meshletVertices.size() + newVertices > maxVertices || newVertices > bestNewVertices)
+							return;
+
+						glm::vec3 triangleCenter = (vertices[indices[triangle * 3]].position + vertices[indices[triangle * 3 + 1]].position + vertices[indices[triangle * 3 + 2]].position) / 3.0f;
+						glm::vec3 offset = triangleCenter - center;
+						float spread = 1.0f - glm::dot(triangleNormal(vertices, &indices[triangle * 3]), averageNormal);
+						float distance = glm::dot(offset, offset) * (1.0f + NORMAL_WEIGHT * spread);
+						if (newVertices < bestNewVertices || distance < bestDistance)
+						{
+							bestTriangle = triangle;
+							bestNewVertices = newVertices;
+							bestDistance = distance;
+						}
+					};
+
+				for (uint32_t vertex : meshletVertices)
+				{
+					uint32_t weldedVertex = welded[vertex];
+					for (uint32_t i = vertexTriangles.offsets[weldedVertex]; i < vertexTriangles.offsets[weldedVertex + 1]; i++)
+					{
+						if (!usedTriangles[vertexTriangles.triangles[i]])
+							consider(vertexTriangles.triangles[i]);
+					}
+				}
+
+				if (bestTriangle == UINT32_MAX)
+				{
+					for (uint32_t triangle = nextSeed, checked = 0; triangle < triangleCount && checked < FALLBACK_WINDOW; triangle++)
+					{
+						if (usedTriangles[triangle])
+							continue;
+						consider(triangle);
+						checked++;
+					}
+				}
+
+				if (bestTriangle == UINT32_MAX)
+					break;
+				addTriangle(bestTriangle);
+			}
+
+			meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+			meshlet.boundingSphere = computeBoundingSphere(vertices, meshletVertices);
+			meshlet.normalCone = computeNormalCone(vertices, mesh.indices.data() + meshlet.firstIndex, meshlet.triangleCount);
+			mesh.meshlets.push_back(meshlet);
+		}
+
+		return mesh;
+	}
+
+	std::vector<MeshAllocation> MeshletMesh::getAllocations(const MeshAllocation& mesh) const
+	{
+		ENGINE_ASSERT(mesh.indexCount == indices.size(), "Mesh was not allocated from the meshlet indices");
+
+		std::vector<MeshAllocation> allocations;
+		allocations.reserve(meshlets.size());
+		for (const Meshlet& meshlet : meshlets)
+		{
+			MeshAllocation allocation = mesh;
+			allocation.firstIndex = mesh.firstIndex + meshlet.firstIndex;
+			allocation.indexCount = meshlet.triangleCount * 3;
+			allocation.boundingSphere = meshlet.boundingSphere;
+			allocation.normalCone = meshlet.normalCone;
+			allocations.push_back(allocation);
+		}
+		return allocations;
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "Buffers/Buffer.h"
+#include "Buffers/GeometryPool.h"
+
+namespace vkEngine
+{
+	// Cluster of neighbouring triangles drawn as its own range of MeshletMesh::indices
+	struct Meshlet
+	{
+		uint32_t firstIndex = 0;
+		uint32_t triangleCount = 0;
+		uint32_t vertexCount = 0; // Distinct vertices the triangles reference
+		glm::vec4 boundingSphere{ 0.0f }; // Mesh space center in xyz and radius in w
+		glm::vec4 normalCone{ 0.0f, 0.0f, 0.0f, 1.0f }; // Average normal in xyz and cutoff in w, see MeshAllocation::normalCone
+	};
+
+	// A mesh's triangles reordered meshlet after meshlet. The indices still address the original vertices, so the mesh is
+	// uploaded as usual with these indices and every meshlet becomes a draw of its own index range.
+	struct MeshletMesh
+	{
+		static constexpr uint32_t s_MaxVertices = 64;
+		static constexpr uint32_t s_MaxTriangles = 124;
+
+		std::vector<uint32_t> indices{};
+		std::vector<Meshlet> meshlets{};
+
+		// Meant for load or cook time. Meshlets grow greedily from a seed triangle over neighbours that add the fewest
+		// new vertices, nearest to the meshlet's center and closest to its normal first, until either limit is reached.
+		// Neighbours share a vertex position, so texture seams do not split meshlets
+		static MeshletMesh build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+			uint32_t maxVertices = s_MaxVertices, uint32_t maxTriangles = s_MaxTriangles);
+
+		// Places every meshlet within mesh, which must have been allocated from vertices and this mesh's indices
+		std::vector<MeshAllocation> getAllocations(const MeshAllocation& mesh) const;
+	};
+}
@@ -0,0 +1,641 @@
+#include "pch.h"
+#include "RenderGraph.h"
+#include "VulkanContext.h"
+
+#include <numeric>
+
+namespace vkEngine
+{
+	namespace
+	{
+		constexpr VkAccessFlags WRITE_ACCESS = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+			| VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+		constexpr VkPipelineStageFlags DEPTH_TEST_STAGES = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		// The usage VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT may be combined with
+		constexpr VkImageUsageFlags ATTACHMENT_USAGE = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
+			| VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+		VkImageAspectFlags getAspectFlags(VkFormat format)
+		{
+			switch (format)
+			{
+			case VK_FORMAT_D16_UNORM:
+			case VK_FORMAT_X8_D24_UNORM_PACK32:
+			case VK_FORMAT_D32_SFLOAT:
+				return VK_IMAGE_ASPECT_DEPTH_BIT;
+			case VK_FORMAT_D16_UNORM_S8_UINT:
+			case VK_FORMAT_D24_UNORM_S8_UINT:
+			case VK_FORMAT_D32_SFLOAT_S8_UINT:
+				return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+			case VK_FORMAT_S8_UINT:
+				return VK_IMAGE_ASPECT_STENCIL_BIT;
+			default:
+				return VK_IMAGE_ASPECT_COLOR_BIT;
+			}
+		}
+
+		VkImage createTransientImage(const RenderGraphImageDesc& desc, VkImageUsageFlags usage)
+		{
+			VkImageCreateInfo imageInfo{};
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.extent = { desc.extent.width, desc.extent.height, 1 };
+			imageInfo.mipLevels = desc.mipLevels;
+			imageInfo.arrayLayers = 1;
+			imageInfo.format = desc.format;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageInfo.usage = usage;
+			imageInfo.samples = desc.sampleCount;
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			VkImage image = VK_NULL_HANDLE;
+			ENGINE_ASSERT(vkCreateImage(VulkanContext::getDevice(), &imageInfo, nullptr, &image) == VK_SUCCESS, "Failed to create a render graph image");
+			return image;
+		}
+
+		struct UseAccess
+		{
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags stages = 0;
+			VkAccessFlags access = 0;
+		};
+	}
+
+	RenderGraphPass& RenderGraphPass::writeColor(RenderGraphImage image, VkAttachmentLoadOp loadOp, VkClearColorValue clearValue, RenderGraphImage resolveTarget)
+	{
+		ImageUse use{ image, UseType::ColorAttachment, loadOp };
+		use.clearValue.color = clearValue;
+		use.resolveTarget = resolveTarget;
+		addUse(use);
+		if (resolveTarget != s_NoImage)
+			addUse({ resolveTarget, UseType::Resolve });
+		return *this;
+	}
+
+	RenderGraphPass& RenderGraphPass::writeDepth(RenderGraphImage image, VkAttachmentLoadOp loadOp, VkClearDepthStencilValue clearValue)
+	{
+		ImageUse use{ image, UseType::DepthAttachment, loadOp };
+		use.clearValue.depthStencil = clearValue;
+		return addUse(use);
+	}
+
+	RenderGraphPass& RenderGraphPass::sample(RenderGraphImage image)
+	{
+		return addUse({ image, UseType::Sampled });
+	}
+
+	RenderGraphPass& RenderGraphPass::readStorage(RenderGraphImage image)
+	{
+		return addUse({ image, UseType::StorageRead });
+	}
+
+	RenderGraphPass& RenderGraphPass::writeStorage(RenderGraphImage image)
+	{
+		return addUse({ image, UseType::StorageWrite });
+	}
+
+	RenderGraphPass& RenderGraphPass::addUse(const ImageUse& use)
+	{
+		ENGINE_ASSERT(use.image != s_NoImage, "Pass %s uses an image that was not declared", m_Name.c_str());
+		ENGINE_ASSERT(m_Type == RenderGraphPassType::Graphics || (use.type != UseType::ColorAttachment && use.type != UseType::DepthAttachment),
+			"Compute pass %s cannot have attachments", m_Name.c_str());
+		m_Uses.push_back(use);
+		return *this;
+	}
+
+	RenderGraph::RenderGraph(DeletionQueue& deletionQueue)
+		: m_DeletionQueue(deletionQueue)
+	{
+	}
+
+	RenderGraph::~RenderGraph()
+	{
+		VkDevice device = VulkanContext::getDevice();
+		for (const PhysicalImage& physicalImage : m_PhysicalImages)
+		{
+			vkDestroyImageView(device, physicalImage.view, nullptr);
+			vkDestroyImage(device, physicalImage.image, nullptr);
+		}
+		for (const MemoryBlock& block : m_MemoryBlocks)
+		{
+			vkFreeMemory(device, block.memory, nullptr);
+		}
+	}
+
+	void RenderGraph::begin()
+	{
+		m_Passes.clear();
+		m_KeptPasses.clear();
+		m_Images.clear();
+		m_Compiled = false;
+	}
+
+	RenderGraphImage RenderGraph::importImage(const std::string& name, VkImage image, VkImageView view, const RenderGraphImageDesc& desc,
+		const RenderGraphImageState& initialState, const RenderGraphImageState& finalState)
+	{
+		Image& imported = m_Images.emplace_back();
+		imported.name = name;
+		imported.desc = desc;
+		imported.aspect = getAspectFlags(desc.format);
+		imported.imported = true;
+		imported.finalState = finalState;
+		imported.image = image;
+		imported.view = view;
+
+		// Pending writes are waited for by any later use, finished reads only by writes
+		if (initialState.access != 0)
+			imported.state = { initialState.layout, initialState.stages, initialState.access, 0, 0 };
+		else
+			imported.state = { initialState.layout, 0, 0, initialState.stages, 0 };
+		return static_cast<RenderGraphImage>(m_Images.size() - 1);
+	}
+
+	RenderGraphImage RenderGraph::createImage(const std::string& name, const RenderGraphImageDesc& desc)
+	{
+		Image& transient = m_Images.emplace_back();
+		transient.name = name;
+		transient.desc = desc;
+		transient.aspect = getAspectFlags(desc.format);
+		return static_cast<RenderGraphImage>(m_Images.size() - 1);
+	}
+
+	RenderGraphPass& RenderGraph::addPass(const std::string& name, RenderGraphPassType type)
+	{
+		ENGINE_ASSERT(!m_Compiled, "Pass %s added after the frame's graph was compiled", name.c_str());
+		return m_Passes.emplace_back(name, type);
+	}
+
+	void RenderGraph::compile(uint64_t lastSubmittedFrame)
+	{
+		m_Stats = {};
+		cullPasses();
+		placeTransientImages(lastSubmittedFrame);
+		m_Compiled = true;
+	}
+
+	// Walks back from the outputs. A pass is kept when it writes something still needed, what it reads is needed from then
+	// on, while what it overwrites without loading is not needed before it
+	void RenderGraph::cullPasses()
+	{
+		using UseType = RenderGraphPass::UseType;
+
+		std::vector<bool> needed(m_Images.size(), false);
+		for (size_t i = 0; i < m_Images.size(); i++)
+		{
+			needed[i] = m_Images[i].imported && m_Images[i].finalState.layout != VK_IMAGE_LAYOUT_UNDEFINED;
+		}
+
+		m_KeptPasses.assign(m_Passes.size(), false);
+		for (size_t p = m_Passes.size(); p-- > 0;)
+		{
+			RenderGraphPass& pass = m_Passes[p];
+			auto writes = [](const RenderGraphPass::ImageUse& use) { return use.type != UseType::Sampled && use.type != UseType::StorageRead; };
+			auto overwrites = [](const RenderGraphPass::ImageUse& use)
+				{
+					return use.type == UseType::Resolve || ((use.type == UseType::ColorAttachment || use.type == UseType::DepthAttachment) && use.loadOp != VK_ATTACHMENT_LOAD_OP_LOAD);
+				};
+
+			bool kept = pass.m_SideEffects;
+			for (const RenderGraphPass::ImageUse& use : pass.m_Uses)
+			{
+				kept = kept || (writes(use) && needed[use.image]);
+			}
+			if (!kept)
+			{
+				m_Stats.culledPasses++;
+				continue;
+			}
+
+			m_KeptPasses[p] = true;
+			m_Stats.passes++;
+			for (RenderGraphPass::ImageUse& use : pass.m_Uses)
+			{
+				use.store = needed[use.image];
+			}
+			for (const RenderGraphPass::ImageUse& use : pass.m_Uses)
+			{
+				if (overwrites(use))
+					needed[use.image] = false;
+			}
+			for (const RenderGraphPass::ImageUse& use : pass.m_Uses)
+			{
+				if (!overwrites(use))
+					needed[use.image] = true;
+			}
+		}
+
+		for (uint32_t p = 0; p < m_Passes.size(); p++)
+		{
+			if (!m_KeptPasses[p])
+				continue;
+
+			for (const RenderGraphPass::ImageUse& use : m_Passes[p].m_Uses)
+			{
+				Image& image = m_Images[use.image];
+				image.firstPass = std::min(image.firstPass, p);
+				image.lastPass = std::max(image.lastPass, p);
+				switch (use.type)
+				{
+				case UseType::ColorAttachment:
+				case UseType::Resolve:
+					image.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+					break;
+				case UseType::DepthAttachment:
+					image.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+					break;
+				case UseType::Sampled:
+					image.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+					break;
+				case UseType::StorageRead:
+				case UseType::StorageWrite:
+					image.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+					break;
+				}
+			}
+		}
+	}
+
+	const VkMemoryRequirements& RenderGraph::getMemoryRequirements(const RenderGraphImageDesc& desc, VkImageUsageFlags usage)
+	{
+		for (const MemoryRequirements& entry : m_MemoryRequirements)
+		{
+			if (entry.desc == desc && entry.usage == usage)
+				return entry.requirements;
+		}
+
+		VkImage image = createTransientImage(desc, usage);
+		MemoryRequirements& entry = m_MemoryRequirements.emplace_back();
+		entry.desc = desc;
+		entry.usage = usage;
+		vkGetImageMemoryRequirements(VulkanContext::getDevice(), image, &entry.requirements);
+		vkDestroyImage(VulkanContext::getDevice(), image, nullptr);
+		return entry.requirements;
+	}
+
+	// Largest images first, each joins the first block it fits whose images are all done before it starts or start after
+	// it is done, and gets a block of its own otherwise. Every image sits at the start of its block
+	void RenderGraph::placeTransientImages(uint64_t lastSubmittedFrame)
+	{
+		std::vector<uint32_t> transients;
+		for (uint32_t i = 0; i < m_Images.size(); i++)
+		{
+			if (!m_Images[i].imported && m_Images[i].firstPass != UINT32_MAX)
+				transients.push_back(i);
+		}
+
+		std::vector<PhysicalImage> plannedImages(transients.size());
+		std::vector<MemoryBlock> plannedBlocks;
+		std::vector<std::vector<uint32_t>> blockImages; // Images placed in each planned block
+		std::vector<uint32_t> order(transients.size());
+		std::iota(order.begin(), order.end(), 0);
+
+		std::vector<const VkMemoryRequirements*> requirements(transients.size());
+		for (size_t t = 0; t < transients.size(); t++)
+		{
+			const Image& image = m_Images[transients[t]];
+			plannedImages[t].desc = image.desc;
+			plannedImages[t].usage = image.usage | image.desc.extraUsage;
+			// Images only ever used as attachments may live in lazily allocated memory, on chip where the GPU has tiles. Not
+			// when a later pass loads them, the stored attachment would commit that memory anyway
+			if ((plannedImages[t].usage & ~ATTACHMENT_USAGE) == 0 && image.firstPass == image.lastPass)
+				plannedImages[t].usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+			requirements[t] = &getMemoryRequirements(plannedImages[t].desc, plannedImages[t].usage);
+		}
+		std::stable_sort(order.begin(), order.end(), [&requirements](uint32_t a, uint32_t b) { return requirements[a]->size > requirements[b]->size; });
+
+		for (uint32_t t : order)
+		{
+			const Image& image = m_Images[transients[t]];
+			const VkMemoryRequirements& requirement = *requirements[t];
+			m_Stats.aliasedMemory += requirement.size;
+
+			uint32_t block = 0;
+			for (; block < plannedBlocks.size(); block++)
+			{
+				if (plannedBlocks[block].size < requirement.size || (plannedBlocks[block].memoryTypeBits & requirement.memoryTypeBits) == 0)
+					continue;
+
+				bool overlaps = std::any_of(blockImages[block].begin(), blockImages[block].end(), [&](uint32_t other)
+					{
+						const Image& placed = m_Images[transients[other]];
+						return placed.firstPass <= image.lastPass && image.firstPass <= placed.lastPass;
+					});
+				if (!overlaps)
+					break;
+			}
+
+			if (block == plannedBlocks.size())
+			{
+				MemoryBlock& newBlock = plannedBlocks.emplace_back();
+				newBlock.size = requirement.size;
+				newBlock.memoryTypeBits = requirement.memoryTypeBits;
+				blockImages.emplace_back();
+			}
+			plannedBlocks[block].memoryTypeBits &= requirement.memoryTypeBits;
+			blockImages[block].push_back(t);
+			plannedImages[t].memoryBlock = block;
+		}
+
+		bool unchanged = plannedImages.size() == m_PhysicalImages.size() && plannedBlocks.size() == m_MemoryBlocks.size();
+		for (size_t i = 0; unchanged && i < plannedImages.size(); i++)
+		{
+			unchanged = plannedImages[i].desc == m_PhysicalImages[i].desc && plannedImages[i].usage == m_PhysicalImages[i].usage
+				&& plannedImages[i].memoryBlock == m_PhysicalImages[i].memoryBlock;
+		}
+		for (size_t i = 0; unchanged && i < plannedBlocks.size(); i++)
+		{
+			unchanged = plannedBlocks[i].size == m_MemoryBlocks[i].size && plannedBlocks[i].memoryTypeBits == m_MemoryBlocks[i].memoryTypeBits;
+		}
+
+		if (!unchanged)
+		{
+			releaseTransientImages(lastSubmittedFrame);
+
+			VkDevice device = VulkanContext::getDevice();
+			for (MemoryBlock& block : plannedBlocks)
+			{
+				VkMemoryAllocateInfo allocInfo{};
+				allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+				allocInfo.allocationSize = block.size;
+				allocInfo.memoryTypeIndex = VulkanContext::getPhysicalDevice()->findMemoryType(block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+					VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+				ENGINE_ASSERT(vkAllocateMemory(device, &allocInfo, nullptr, &block.memory) == VK_SUCCESS, "Failed to allocate render graph memory");
+			}
+
+			for (size_t t = 0; t < plannedImages.size(); t++)
+			{
+				PhysicalImage& physicalImage = plannedImages[t];
+				const Image& image = m_Images[transients[t]];
+				physicalImage.image = createTransientImage(physicalImage.desc, physicalImage.usage);
+				vkBindImageMemory(device, physicalImage.image, plannedBlocks[physicalImage.memoryBlock].memory, 0);
+
+				VkImageViewCreateInfo viewInfo{};
+				viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+				viewInfo.image = physicalImage.image;
+				viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+				viewInfo.format = physicalImage.desc.format;
+				viewInfo.subresourceRange = { image.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+				ENGINE_ASSERT(vkCreateImageView(device, &viewInfo, nullptr, &physicalImage.view) == VK_SUCCESS, "Failed to create a render graph image view");
+			}
+
+			m_PhysicalImages = std::move(plannedImages);
+			m_MemoryBlocks = std::move(plannedBlocks);
+		}
+
+		for (uint32_t t = 0; t < transients.size(); t++)
+		{
+			Image& image = m_Images[transients[t]];
+			image.physicalImage = t;
+			image.image = m_PhysicalImages[t].image;
+			image.view = m_PhysicalImages[t].view;
+		}
+
+		m_Stats.transientImages = static_cast<uint32_t>(m_PhysicalImages.size());
+		for (const MemoryBlock& block : m_MemoryBlocks)
+		{
+			m_Stats.transientMemory += block.size;
+		}
+	}
+
+	void RenderGraph::releaseTransientImages(uint64_t lastSubmittedFrame)
+	{
+		if (m_PhysicalImages.empty() && m_MemoryBlocks.empty())
+			return;
+
+		m_DeletionQueue.push(lastSubmittedFrame, [images = std::move(m_PhysicalImages), blocks = std::move(m_MemoryBlocks)]()
+			{
+				VkDevice device = VulkanContext::getDevice();
+				for (const PhysicalImage& physicalImage : images)
+				{
+					vkDestroyImageView(device, physicalImage.view, nullptr);
+					vkDestroyImage(device, physicalImage.image, nullptr);
+				}
+				for (const MemoryBlock& block : blocks)
+				{
+					vkFreeMemory(device, block.memory, nullptr);
+				}
+			});
+		m_PhysicalImages.clear();
+		m_MemoryBlocks.clear();
+	}
+
+	void RenderGraph::execute(CommandList& commandList)
+	{
+		ENGINE_ASSERT(m_Compiled, "Render graph executed before it was compiled");
+
+		const DeviceExtensionFunctions& functions = VulkanContext::getLogicalDevice()->getExtensionFunctions();
+		std::vector<VkImageMemoryBarrier> barriers;
+		for (size_t p = 0; p < m_Passes.size(); p++)
+		{
+			if (!m_KeptPasses[p])
+				continue;
+
+			const RenderGraphPass& pass = m_Passes[p];
+			recordBarriers(commandList, pass, barriers);
+
+			if (pass.m_Type == RenderGraphPassType::Graphics)
+				beginRendering(commandList, pass);
+			if (pass.m_Execute)
+			{
+				pass.m_Execute(commandList);
+				// State recorded around the list, such as a compute layout's push constants, would make it skip calls the
+				// next pass still needs
+				commandList.invalidate();
+			}
+			if (pass.m_Type == RenderGraphPassType::Graphics)
+				functions.cmdEndRendering(commandList.getCommandBuffer());
+		}
+
+		// Outputs move to the layout the caller expects them in, whoever uses them next waits for the writes
+		barriers.clear();
+		VkPipelineStageFlags srcStages = 0, dstStages = 0;
+		for (const Image& image : m_Images)
+		{
+			if (!image.imported || image.finalState.layout == VK_IMAGE_LAYOUT_UNDEFINED || image.finalState.layout == image.state.layout)
+				continue;
+
+			VkImageMemoryBarrier& barrier = barriers.emplace_back();
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = image.state.writeAccess;
+			barrier.dstAccessMask = image.finalState.access;
+			barrier.oldLayout = image.state.layout;
+			barrier.newLayout = image.finalState.layout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = image.image;
+			barrier.subresourceRange = { image.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+			srcStages |= image.state.writeStages | image.state.readStages;
+			dstStages |= image.finalState.stages;
+		}
+		if (!barriers.empty())
+		{
+			vkCmdPipelineBarrier(commandList.getCommandBuffer(), srcStages ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStages, 0, 0, nullptr, 0, nullptr,
+				static_cast<uint32_t>(barriers.size()), barriers.data());
+			m_Stats.imageBarriers += static_cast<uint32_t>(barriers.size());
+		}
+	}
+
+	// Layout changes and writes wait for every earlier use, reads only for the last write and only once per stage
+	void RenderGraph::recordBarriers(CommandList& commandList, const RenderGraphPass& pass, std::vector<VkImageMemoryBarrier>& barriers)
+	{
+		using UseType = RenderGraphPass::UseType;
+
+		VkPipelineStageFlags shaderStages = pass.m_Type == RenderGraphPassType::Compute ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+			: VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+		barriers.clear();
+		VkPipelineStageFlags srcStages = 0, dstStages = 0;
+		for (const RenderGraphPass::ImageUse& use : pass.m_Uses)
+		{
+			Image& image = m_Images[use.image];
+			bool load = use.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD;
+			bool depth = (image.aspect & VK_IMAGE_ASPECT_DEPTH_BIT) != 0;
+
+			UseAccess access{};
+			bool write = true, discard = false;
+			switch (use.type)
+			{
+			case UseType::ColorAttachment:
+				access = { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+					VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | (load ? VK_ACCESS_COLOR_ATTACHMENT_READ_BIT : 0u) };
+				discard = !load;
+				break;
+			case UseType::Resolve:
+				access = { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT };
+				discard = true;
+				break;
+			case UseType::DepthAttachment:
+				access = { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, DEPTH_TEST_STAGES,
+					VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT };
+				discard = !load;
+				break;
+			case UseType::Sampled:
+				access = { depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, shaderStages, VK_ACCESS_SHADER_READ_BIT };
+				write = false;
+				break;
+			case UseType::StorageRead:
+				access = { VK_IMAGE_LAYOUT_GENERAL, shaderStages, VK_ACCESS_SHADER_READ_BIT };
+				write = false;
+				break;
+			case UseType::StorageWrite:
+				access = { VK_IMAGE_LAYOUT_GENERAL, shaderStages, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT };
+				break;
+			}
+
+			// A transient image starts out undefined, after whatever used its memory before
+			MemoryBlock* block = image.physicalImage != UINT32_MAX ? &m_MemoryBlocks[m_PhysicalImages[image.physicalImage].memoryBlock] : nullptr;
+			if (block && !image.started)
+				image.state = { VK_IMAGE_LAYOUT_UNDEFINED, block->lastStages, block->lastAccess, 0, 0 };
+			image.started = true;
+
+			ImageState& state = image.state;
+			bool layoutChange = state.layout != access.layout;
+			VkPipelineStageFlags waitStages = 0;
+			VkAccessFlags waitAccess = 0;
+			if (layoutChange || write)
+			{
+				waitStages = state.writeStages | state.readStages;
+				waitAccess = state.writeAccess;
+			}
+			else if (state.writeStages != 0 && ((access.stages & ~state.readStages) != 0 || (access.access & ~state.readAccess) != 0))
+			{
+				waitStages = state.writeStages;
+				waitAccess = state.writeAccess;
+			}
+
+			if (layoutChange || waitStages != 0)
+			{
+				VkImageMemoryBarrier& barrier = barriers.emplace_back();
+				barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				barrier.srcAccessMask = waitAccess;
+				barrier.dstAccessMask = access.access;
+				barrier.oldLayout = layoutChange && discard ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+				barrier.newLayout = access.layout;
+				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.image = image.image;
+				barrier.subresourceRange = { image.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+				srcStages |= waitStages;
+				dstStages |= access.stages;
+			}
+
+			if (write || layoutChange)
+				state = { access.layout, access.stages, access.access & WRITE_ACCESS, write ? 0u : access.stages, write ? 0u : access.access };
+			else
+			{
+				state.readStages |= access.stages;
+				state.readAccess |= access.access;
+			}
+
+			if (block)
+			{
+				block->lastStages = state.writeStages | state.readStages;
+				block->lastAccess = state.writeAccess;
+			}
+		}
+
+		if (barriers.empty())
+			return;
+
+		vkCmdPipelineBarrier(commandList.getCommandBuffer(), srcStages ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStages, 0, 0, nullptr, 0, nullptr,
+			static_cast<uint32_t>(barriers.size()), barriers.data());
+		m_Stats.imageBarriers += static_cast<uint32_t>(barriers.size());
+	}
+
+	void RenderGraph::beginRendering(CommandList& commandList, const RenderGraphPass& pass)
+	{
+		using UseType = RenderGraphPass::UseType;
+
+		std::vector<VkRenderingAttachmentInfoKHR> colorAttachments;
+		VkRenderingAttachmentInfoKHR depthAttachment{};
+		bool hasDepth = false, hasStencil = false;
+		VkExtent2D extent{};
+
+		for (const RenderGraphPass::ImageUse& use : pass.m_Uses)
+		{
+			if (use.type != UseType::ColorAttachment && use.type != UseType::DepthAttachment)
+				continue;
+
+			const Image& image = m_Images[use.image];
+			extent = image.desc.extent;
+
+			VkRenderingAttachmentInfoKHR attachment{};
+			attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+			attachment.imageView = image.view;
+			attachment.loadOp = use.loadOp;
+			attachment.storeOp = use.store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachment.clearValue = use.clearValue;
+
+			if (use.type == UseType::DepthAttachment)
+			{
+				attachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+				depthAttachment = attachment;
+				hasDepth = true;
+				hasStencil = (image.aspect & VK_IMAGE_ASPECT_STENCIL_BIT) != 0;
+				continue;
+			}
+
+			attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			if (use.resolveTarget != RenderGraphPass::s_NoImage)
+			{
+				attachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT_KHR;
+				attachment.resolveImageView = m_Images[use.resolveTarget].view;
+				attachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			}
+			colorAttachments.push_back(attachment);
+		}
+
+		VkRenderingInfoKHR renderingInfo{};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+		renderingInfo.renderArea.offset = { 0, 0 };
+		renderingInfo.renderArea.extent = extent;
+		renderingInfo.layerCount = 1;
+		renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorAttachments.size());
+		renderingInfo.pColorAttachments = colorAttachments.data();
+		renderingInfo.pDepthAttachment = hasDepth ? &depthAttachment : nullptr;
+		renderingInfo.pStencilAttachment = hasStencil ? &depthAttachment : nullptr;
+
+		VulkanContext::getLogicalDevice()->getExtensionFunctions().cmdBeginRendering(commandList.getCommandBuffer(), &renderingInfo);
+	}
+}
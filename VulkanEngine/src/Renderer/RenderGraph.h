@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "CommandList.h"
+#include "Utility/DeletionQueue.h"
+
+namespace vkEngine
+{
+	// Index of an image declared for the current frame, valid until the next RenderGraph::begin
+	using RenderGraphImage = uint32_t;
+
+	struct RenderGraphImageDesc
+	{
+		VkExtent2D extent{};
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkSampleCountFlagBits sampleCount = VK_SAMPLE_COUNT_1_BIT;
+		uint32_t mipLevels = 1;
+		// Added to the usage the passes declare, for transient images that are also used outside the graph
+		VkImageUsageFlags extraUsage = 0;
+
+		bool operator==(const RenderGraphImageDesc& other) const
+		{
+			return extent.width == other.extent.width && extent.height == other.extent.height && format == other.format
+				&& sampleCount == other.sampleCount && mipLevels == other.mipLevels && extraUsage == other.extraUsage;
+		}
+	};
+
+	// Layout and last access of an imported image where the frame picks it up or leaves it. access lists the writes
+	// still to be made visible, stages the stages of the last use whether it wrote or read
+	struct RenderGraphImageState
+	{
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		VkAccessFlags access = 0;
+	};
+
+	struct RenderGraphStats
+	{
+		uint32_t passes = 0;
+		uint32_t culledPasses = 0;
+		uint32_t imageBarriers = 0;
+		uint32_t transientImages = 0;
+		VkDeviceSize transientMemory = 0; // Bytes allocated for the transient images
+		VkDeviceSize aliasedMemory = 0; // Bytes the transient images would take without sharing memory
+	};
+
+	enum class RenderGraphPassType
+	{
+		Graphics,
+		Compute
+	};
+
+	// One pass of the frame and the images it uses. Graphics passes record inside a dynamic rendering instance the graph
+	// begins over their attachments, compute passes outside of one
+	class RenderGraphPass
+	{
+	public:
+		using Execute = std::function<void(CommandList&)>;
+
+		RenderGraphPass(std::string name, RenderGraphPassType type)
+			: m_Name(std::move(name)), m_Type(type) {}
+
+		// LOAD keeps what earlier passes drew, CLEAR and DONT_CARE discard it. A resolve target receives the
+		// multisampled attachment's average at the end of the pass
+		RenderGraphPass& writeColor(RenderGraphImage image, VkAttachmentLoadOp loadOp, VkClearColorValue clearValue = {},
+			RenderGraphImage resolveTarget = s_NoImage);
+		RenderGraphPass& writeDepth(RenderGraphImage image, VkAttachmentLoadOp loadOp, VkClearDepthStencilValue clearValue = { 1.0f, 0 });
+		// Read through a sampler by the pass's shaders, in a read only layout
+		RenderGraphPass& sample(RenderGraphImage image);
+		// Storage image access, or sampling without leaving VK_IMAGE_LAYOUT_GENERAL
+		RenderGraphPass& readStorage(RenderGraphImage image);
+		RenderGraphPass& writeStorage(RenderGraphImage image);
+		// Results the graph does not track, such as buffers, keep the pass from being culled
+		RenderGraphPass& setSideEffects() { m_SideEffects = true; return *this; }
+		// May record straight into the list's command buffer, the list forgets its state once the pass returns
+		RenderGraphPass& setExecute(Execute execute) { m_Execute = std::move(execute); return *this; }
+
+		static constexpr RenderGraphImage s_NoImage = UINT32_MAX;
+
+	private:
+		friend class RenderGraph;
+
+		enum class UseType
+		{
+			ColorAttachment,
+			DepthAttachment,
+			Resolve,
+			Sampled,
+			StorageRead,
+			StorageWrite
+		};
+
+		struct ImageUse
+		{
+			RenderGraphImage image = s_NoImage;
+			UseType type = UseType::Sampled;
+			VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			VkClearValue clearValue{};
+			RenderGraphImage resolveTarget = s_NoImage;
+			bool store = true; // Set by compile, whether anything after the pass needs what it wrote
+		};
+
+		RenderGraphPass& addUse(const ImageUse& use);
+
+	private:
+		std::string m_Name;
+		RenderGraphPassType m_Type;
+		std::vector<ImageUse> m_Uses{};
+		bool m_SideEffects = false;
+		Execute m_Execute{};
+	};
+
+	// Frame graph rebuilt every frame: passes declare the images they read and write, and the graph
+	//  - culls passes whose results nothing needs, that is no output image, side effect or later pass that is kept
+	//  - runs the rest in declaration order, which already follows the dependencies as passes only use declared images
+	//  - batches one barrier per pass with the layout transitions and hazards between uses, no more
+	//  - allocates transient images and places those whose lifetimes do not overlap in the same memory.
+	// Transient images and their memory persist while the frame's transient images stay the same and are retired through
+	// the deletion queue otherwise. Those only used as attachments of a single pass are created as transient attachments in
+	// lazily allocated memory where the device has it. Imported images belong to the caller, who describes their state at
+	// frame start and end.
+	class RenderGraph
+	{
+	public:
+		RenderGraph(DeletionQueue& deletionQueue);
+		~RenderGraph();
+
+		RenderGraph(const RenderGraph&) = delete;
+		RenderGraph& operator=(const RenderGraph&) = delete;
+
+		// Drops the previous frame's passes and images, transient images are kept for reuse
+		void begin();
+
+		// An image with a defined finalState.layout is an output: passes writing it are kept and it is left in that
+		// layout. Otherwise its contents may be discarded once the frame has no further use for them
+		RenderGraphImage importImage(const std::string& name, VkImage image, VkImageView view, const RenderGraphImageDesc& desc,
+			const RenderGraphImageState& initialState, const RenderGraphImageState& finalState = {});
+		// Image owned by the graph, alive and valid from its first to its last use in the frame
+		RenderGraphImage createImage(const std::string& name, const RenderGraphImageDesc& desc);
+
+		RenderGraphPass& addPass(const std::string& name, RenderGraphPassType type);
+
+		// Culls the passes and places the transient images. lastSubmittedFrame tags images retired by a changed frame
+		void compile(uint64_t lastSubmittedFrame);
+		void execute(CommandList& commandList);
+
+		// Valid once compiled, also inside the passes
+		VkImage getImage(RenderGraphImage image) const { return m_Images[image].image; }
+		VkImageView getImageView(RenderGraphImage image) const { return m_Images[image].view; }
+		const RenderGraphStats& getStats() const { return m_Stats; }
+
+	private:
+		struct ImageState
+		{
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags writeStages = 0; // Of the last write or layout transition
+			VkAccessFlags writeAccess = 0;
+			VkPipelineStageFlags readStages = 0; // Reads since then, which already waited for it
+			VkAccessFlags readAccess = 0;
+		};
+
+		struct Image
+		{
+			std::string name;
+			RenderGraphImageDesc desc{};
+			VkImageAspectFlags aspect = 0;
+			bool imported = false;
+			RenderGraphImageState finalState{};
+
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			VkImageUsageFlags usage = 0; // Declared by the passes
+			uint32_t firstPass = UINT32_MAX; // Kept passes using the image
+			uint32_t lastPass = 0;
+			uint32_t physicalImage = UINT32_MAX; // Transient images only
+			ImageState state{};
+			bool started = false; // Whether a pass used it yet while executing
+		};
+
+		// Transient image with memory of its own or shared with others, see compile
+		struct PhysicalImage
+		{
+			RenderGraphImageDesc desc{};
+			VkImageUsageFlags usage = 0;
+			uint32_t memoryBlock = 0;
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+		};
+
+		struct MemoryBlock
+		{
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize size = 0;
+			uint32_t memoryTypeBits = 0; // Memory types every image placed in the block accepts
+			// Last access of whichever image used the block last, waited for by the next one. Persists across frames
+			VkPipelineStageFlags lastStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+			VkAccessFlags lastAccess = 0;
+		};
+
+		struct MemoryRequirements
+		{
+			RenderGraphImageDesc desc{};
+			VkImageUsageFlags usage = 0;
+			VkMemoryRequirements requirements{};
+		};
+
+		void cullPasses();
+		const VkMemoryRequirements& getMemoryRequirements(const RenderGraphImageDesc& desc, VkImageUsageFlags usage);
+		void placeTransientImages(uint64_t lastSubmittedFrame);
+		void releaseTransientImages(uint64_t lastSubmittedFrame);
+		void recordBarriers(CommandList& commandList, const RenderGraphPass& pass, std::vector<VkImageMemoryBarrier>& barriers);
+		void beginRendering(CommandList& commandList, const RenderGraphPass& pass);
+
+	private:
+		DeletionQueue& m_DeletionQueue;
+		std::deque<RenderGraphPass> m_Passes{}; // Passes handed out stay in place while more are added
+		std::vector<bool> m_KeptPasses{};
+		std::vector<Image> m_Images{};
+		bool m_Compiled = false;
+
+		std::vector<PhysicalImage> m_PhysicalImages{};
+		std::vector<MemoryBlock> m_MemoryBlocks{};
+		std::vector<MemoryRequirements> m_MemoryRequirements{}; // Queried once per description and usage
+		RenderGraphStats m_Stats{};
+	};
+}
@@ -0,0 +1,169 @@
+#include "pch.h"
+#include "RenderQueue.h"
+
+#include <bit>
+
+namespace vkEngine
+{
+	namespace
+	{
+		// Large queues take wider digits, every pass saved is a scattered write of all entries while the larger counts only
+		// cost a fixed amount per pass
+		constexpr uint32_t RADIX_BITS = 8;
+		constexpr uint32_t WIDE_RADIX_BITS = 13;
+		constexpr size_t WIDE_RADIX_THRESHOLD = 1u << 16;
+		constexpr uint32_t MAX_DIGIT_COUNT = 64 / RADIX_BITS;
+		// Chunks smaller than this cost more to schedule than they save
+		constexpr size_t MIN_CHUNK_SIZE = 1u << 14;
+
+		constexpr uint64_t fieldMask(uint32_t bits)
+		{
+			return (uint64_t{ 1 } << bits) - 1;
+		}
+
+		static_assert(RenderQueue::s_PassBits + 1 + RenderQueue::s_PipelineBits + RenderQueue::s_GeometryBits + RenderQueue::s_MaterialBits
+			+ RenderQueue::s_DepthBits == 64, "Sort key fields must fill 64 bits");
+	}
+
+	RenderQueue::RenderQueue(ThreadPool* threadPool)
+		: m_ThreadPool(threadPool)
+	{
+	}
+
+	uint64_t RenderQueue::makeKey(const DrawSortInfo& info)
+	{
+		ENGINE_ASSERT(info.pass <= fieldMask(s_PassBits) && info.pipeline <= fieldMask(s_PipelineBits) && info.geometry <= fieldMask(s_GeometryBits)
+			&& info.material <= fieldMask(s_MaterialBits), "Draw sort ids exceed their key fields");
+
+		uint64_t depth = static_cast<uint64_t>(std::clamp(info.depth, 0.0f, 1.0f) * static_cast<float>(fieldMask(s_DepthBits)) + 0.5f);
+		uint64_t state = (static_cast<uint64_t>(info.pipeline) << (s_GeometryBits + s_MaterialBits))
+			| (static_cast<uint64_t>(info.geometry) << s_MaterialBits) | info.material;
+
+		uint64_t key = (static_cast<uint64_t>(info.pass) << (64 - s_PassBits)) | (static_cast<uint64_t>(info.transparent) << (63 - s_PassBits));
+		if (info.transparent)
+			return key | ((fieldMask(s_DepthBits) - depth) << (63 - s_PassBits - s_DepthBits)) | state;
+		return key | (state << s_DepthBits) | depth;
+	}
+
+	void RenderQueue::clear()
+	{
+		m_Entries.clear();
+		m_VaryingBits = 0;
+	}
+
+	void RenderQueue::reserve(size_t count)
+	{
+		m_Entries.reserve(count);
+	}
+
+	void RenderQueue::push(uint64_t key, uint32_t item)
+	{
+		if (!m_Entries.empty())
+			m_VaryingBits |= key ^ m_Entries.front().key;
+		m_Entries.push_back({ key, item });
+	}
+
+	void RenderQueue::sort()
+	{
+		size_t count = m_Entries.size();
+		if (count < 2 || m_VaryingBits == 0)
+			return;
+
+		uint32_t radixBits = count >= WIDE_RADIX_THRESHOLD ? WIDE_RADIX_BITS : RADIX_BITS;
+		uint32_t radixSize = 1u << radixBits;
+		uint64_t radixMask = radixSize - 1;
+
+		// Each digit starts at the lowest varying bit above the previous one, bits no key differs in need no pass
+		std::array<uint32_t, MAX_DIGIT_COUNT> shifts{};
+		uint32_t digitCount = 0;
+		for (uint32_t bit = 0; bit < 64 && (m_VaryingBits >> bit) != 0; bit += radixBits)
+		{
+			bit += static_cast<uint32_t>(std::countr_zero(m_VaryingBits >> bit));
+			shifts[digitCount++] = bit;
+		}
+
+		size_t chunkSize = count;
+		if (m_ThreadPool && count >= s_ParallelThreshold)
+		{
+			size_t threads = m_ThreadPool->getWorkerCount() + 1;
+			chunkSize = std::max((count + threads - 1) / threads, MIN_CHUNK_SIZE);
+		}
+		size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+		m_Scratch.resize(count);
+		m_DigitCounts.resize(chunkCount * digitCount * radixSize);
+		m_Histograms.resize(chunkCount * radixSize);
+
+		// A single read counts every digit of every chunk. Until the first pass moves keys between chunks, or with a single
+		// chunk at all, these are the counts the passes need
+		run(count, chunkSize, [this, chunkSize, digitCount, &shifts, radixSize, radixMask](size_t begin, size_t end)
+			{
+				uint32_t* counts = &m_DigitCounts[begin / chunkSize * digitCount * radixSize];
+				std::fill(counts, counts + digitCount * radixSize, 0);
+				for (size_t i = begin; i < end; i++)
+				{
+					uint64_t key = m_Entries[i].key;
+					for (uint32_t digit = 0; digit < digitCount; digit++)
+					{
+						counts[digit * radixSize + ((key >> shifts[digit]) & radixMask)]++;
+					}
+				}
+			});
+
+		for (uint32_t digit = 0; digit < digitCount; digit++)
+		{
+			uint32_t shift = shifts[digit];
+			if (digit > 0 && chunkCount > 1)
+			{
+				run(count, chunkSize, [this, chunkSize, shift, radixSize, radixMask](size_t begin, size_t end)
+					{
+						uint32_t* histogram = &m_Histograms[begin / chunkSize * radixSize];
+						std::fill(histogram, histogram + radixSize, 0);
+						for (size_t i = begin; i < end; i++)
+						{
+							histogram[(m_Entries[i].key >> shift) & radixMask]++;
+						}
+					});
+			}
+			else
+			{
+				for (size_t chunk = 0; chunk < chunkCount; chunk++)
+				{
+					const uint32_t* counts = &m_DigitCounts[(chunk * digitCount + digit) * radixSize];
+					std::copy(counts, counts + radixSize, &m_Histograms[chunk * radixSize]);
+				}
+			}
+
+			// Digit after digit, the chunks in order, which keeps equal digits in their current order
+			uint32_t offset = 0;
+			for (uint32_t value = 0; value < radixSize; value++)
+			{
+				for (size_t chunk = 0; chunk < chunkCount; chunk++)
+				{
+					uint32_t valueCount = m_Histograms[chunk * radixSize + value];
+					m_Histograms[chunk * radixSize + value] = offset;
+					offset += valueCount;
+				}
+			}
+
+			run(count, chunkSize, [this, chunkSize, shift, radixSize, radixMask](size_t begin, size_t end)
+				{
+					uint32_t* next = &m_Histograms[begin / chunkSize * radixSize];
+					const Entry* entries = m_Entries.data();
+					Entry* scratch = m_Scratch.data();
+					for (size_t i = begin; i < end; i++)
+					{
+						scratch[next[(entries[i].key >> shift) & radixMask]++] = entries[i];
+					}
+				});
+			m_Entries.swap(m_Scratch);
+		}
+	}
+
+	void RenderQueue::run(size_t count, size_t chunkSize, const ThreadPool::ChunkTask& task) const
+	{
+		if (!m_ThreadPool || chunkSize >= count)
+			task(0, count);
+		else
+			m_ThreadPool->parallelFor(count, chunkSize, task);
+	}
+}
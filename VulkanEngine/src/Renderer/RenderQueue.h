@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Utility/ThreadPool.h"
+
+namespace vkEngine
+{
+	// What a draw is ordered by, packed into a key by RenderQueue::makeKey. The ids are small integers handed out by the
+	// caller, such as DrawBatcher for pipelines and geometry
+	struct DrawSortInfo
+	{
+		uint32_t pass = 0;
+		bool transparent = false; // Drawn after the opaque draws of its pass, back to front
+		uint32_t pipeline = 0;
+		uint32_t geometry = 0;
+		uint32_t material = 0;
+		float depth = 0.0f; // View distance normalized to [0, 1]
+	};
+
+	// Draws of a frame ordered by 64 bit sort keys. From the most significant bit, opaque keys hold the pass, a clear
+	// transparency bit, the pipeline, geometry, material and depth, so state changes as rarely as possible and draws sharing
+	// all of it go front to back for early depth rejection. Transparent keys move the inverted depth right after the set
+	// transparency bit, which orders them back to front across all state as blending requires.
+	// Keys are sorted with a stable LSD radix sort, 8 bits per pass or 13 for large queues, each pass split into chunks over
+	// the thread pool. Digits only start at bits some keys differ in, so the unused high bits of the id fields cost no
+	// passes. Keys and items move together as entries, one scattered write per key.
+	class RenderQueue
+	{
+	public:
+		struct Entry
+		{
+			uint64_t key;
+			uint32_t item;
+		};
+
+		static constexpr uint32_t s_PassBits = 4;
+		static constexpr uint32_t s_PipelineBits = 12;
+		static constexpr uint32_t s_GeometryBits = 12;
+		static constexpr uint32_t s_MaterialBits = 11;
+		static constexpr uint32_t s_DepthBits = 24;
+		static constexpr size_t s_ParallelThreshold = 1u << 16; // Smaller queues are sorted on the calling thread
+
+		// threadPool may be null, everything then runs on the calling thread
+		RenderQueue(ThreadPool* threadPool = nullptr);
+
+		RenderQueue(const RenderQueue&) = delete;
+		RenderQueue& operator=(const RenderQueue&) = delete;
+
+		static uint64_t makeKey(const DrawSortInfo& info);
+
+		void clear();
+		void reserve(size_t count);
+		// item is the caller's handle of the draw, getItems lists them in key order once sorted
+		void push(uint64_t key, uint32_t item);
+		// Equal keys keep the order they were pushed in
+		void sort();
+
+		size_t size() const { return m_Entries.size(); }
+		// In key order once sorted
+		const std::vector<Entry>& getEntries() const { return m_Entries; }
+
+	private:
+		void run(size_t count, size_t chunkSize, const ThreadPool::ChunkTask& task) const;
+
+	private:
+		ThreadPool* m_ThreadPool = nullptr;
+
+		std::vector<Entry> m_Entries{};
+		std::vector<Entry> m_Scratch{}; // Destination of the passes, swapped with the entries after each one
+		uint64_t m_VaryingBits = 0; // Bits some pushed key differs from the first one in
+		std::vector<uint32_t> m_DigitCounts{}; // Per chunk and digit, the keys with every value of the digit
+		std::vector<uint32_t> m_Histograms{}; // Per chunk, the count and then the next slot of every value of the pass's digit
+	};
+}
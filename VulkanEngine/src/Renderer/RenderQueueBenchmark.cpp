@@ -0,0 +1,86 @@
+#include "pch.h"
+#include "RenderQueueBenchmark.h"
+#include "RenderQueue.h"
+
+#include <random>
+
+namespace vkEngine
+{
+	namespace
+	{
+		const uint32_t WARMUP_ITERATIONS = 3, MEASURED_ITERATIONS = 20;
+		// State of a busy frame, a few passes over many pipelines, meshes and materials
+		const uint32_t PASS_COUNT = 4, PIPELINE_COUNT = 64, GEOMETRY_COUNT = 1024, MATERIAL_COUNT = 2048;
+		const float TRANSPARENT_RATIO = 0.1f;
+
+		// Average time of one sort over the measured iterations, refilling the queue is not measured
+		float measure(RenderQueue& queue, const std::vector<uint64_t>& keys)
+		{
+			float totalTime = 0.0f;
+			for (uint32_t i = 0; i < WARMUP_ITERATIONS + MEASURED_ITERATIONS; i++)
+			{
+				queue.clear();
+				for (size_t item = 0; item < keys.size(); item++)
+				{
+					queue.push(keys[item], static_cast<uint32_t>(item));
+				}
+
+				Timer timer("RenderQueueBenchmark");
+				timer.Start();
+				queue.sort();
+				timer.Stop();
+				if (i >= WARMUP_ITERATIONS)
+					totalTime += timer.GetTimeMilliseconds();
+			}
+			return totalTime / MEASURED_ITERATIONS;
+		}
+	}
+
+	void runRenderQueueBenchmark(uint32_t keyCount)
+	{
+		std::mt19937 random(1234);
+		std::uniform_int_distribution<uint32_t> pass(0, PASS_COUNT - 1), pipeline(0, PIPELINE_COUNT - 1), geometry(0, GEOMETRY_COUNT - 1), material(0, MATERIAL_COUNT - 1);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		std::vector<uint64_t> keys;
+		keys.reserve(keyCount);
+		for (uint32_t i = 0; i < keyCount; i++)
+		{
+			DrawSortInfo info{ pass(random), unit(random) < TRANSPARENT_RATIO, pipeline(random), geometry(random), material(random), unit(random) };
+			keys.push_back(RenderQueue::makeKey(info));
+		}
+
+		// Reference order, equal keys keep their push order
+		std::vector<std::pair<uint64_t, uint32_t>> expected;
+		expected.reserve(keyCount);
+		for (uint32_t i = 0; i < keyCount; i++)
+		{
+			expected.emplace_back(keys[i], i);
+		}
+		Timer timer("RenderQueueBenchmark");
+		timer.Start();
+		std::stable_sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+		timer.Stop();
+		float referenceTime = timer.GetTimeMilliseconds();
+
+		ThreadPool threadPool;
+		ENGINE_INFO("Render queue benchmark: %u keys, %u worker threads", keyCount, threadPool.getWorkerCount());
+		ENGINE_INFO("  std::stable_sort %.3f ms", referenceTime);
+
+		for (ThreadPool* pool : { static_cast<ThreadPool*>(nullptr), &threadPool })
+		{
+			RenderQueue queue(pool);
+			queue.reserve(keyCount);
+			float sortTime = measure(queue, keys);
+			ENGINE_INFO("  radix  %-8s %.3f ms, %.0f keys/ms", pool ? "threaded" : "single", sortTime, keyCount / sortTime);
+
+			bool matches = true;
+			for (size_t i = 0; i < expected.size() && matches; i++)
+			{
+				matches = queue.getEntries()[i].key == expected[i].first && queue.getEntries()[i].item == expected[i].second;
+			}
+			if (!matches)
+				ENGINE_WARN("Render queue benchmark: %s order differs from std::stable_sort", pool ? "threaded" : "single");
+		}
+	}
+}
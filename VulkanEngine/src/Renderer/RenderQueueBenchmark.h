@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+namespace vkEngine
+{
+	// Sorts keyCount random draw keys with the render queue, on the calling thread and on a thread pool, and logs the time
+	// per sort next to std::stable_sort. Warns when the order differs from it
+	void runRenderQueueBenchmark(uint32_t keyCount);
+}
@@ -0,0 +1,103 @@
+#include "pch.h"
+#include "Shader.h"
+#include "VulkanContext.h"
+
+namespace vkEngine
+{
+	namespace
+	{
+		const uint32_t SPIRV_MAGIC = 0x07230203;
+	}
+
+	Shader::Shader(const std::string& spirvPath, VkShaderStageFlagBits stage)
+		: Shader(spirvPath, stage, readFile(spirvPath))
+	{
+		ENGINE_ASSERT(m_Module != VK_NULL_HANDLE, "Shader module creation failed");
+	}
+
+	Shader::Shader(const std::string& spirvPath, VkShaderStageFlagBits stage, std::vector<char> code)
+		: m_Path(spirvPath), m_Code(std::move(code)), m_Stage(stage)
+	{
+		if (createShaderModule() != VK_SUCCESS)
+			m_Module = VK_NULL_HANDLE;
+	}
+
+	Shader::~Shader()
+	{
+		vkDestroyShaderModule(VulkanContext::getDevice(), m_Module, nullptr);
+	}
+
+	Scoped<Shader> Shader::tryCreate(const std::string& spirvPath, VkShaderStageFlagBits stage)
+	{
+		std::vector<char> code;
+		if (!tryReadFile(spirvPath, code))
+		{
+			ENGINE_WARN("Failed to open file at this path: %s", spirvPath.c_str());
+			return nullptr;
+		}
+
+		uint32_t magic = 0;
+		if (code.size() % sizeof(uint32_t) == 0 && code.size() >= sizeof(magic))
+			memcpy(&magic, code.data(), sizeof(magic));
+		if (magic != SPIRV_MAGIC)
+		{
+			ENGINE_WARN("%s is not a SPIR-V binary", spirvPath.c_str());
+			return nullptr;
+		}
+
+		Scoped<Shader> shader(new Shader(spirvPath, stage, std::move(code)));
+		if (shader->m_Module == VK_NULL_HANDLE)
+		{
+			ENGINE_WARN("Shader module creation failed for %s", spirvPath.c_str());
+			return nullptr;
+		}
+		return shader;
+	}
+
+	VkPipelineShaderStageCreateInfo Shader::getStageCreateInfo(const VkSpecializationInfo* specialization) const
+	{
+		VkPipelineShaderStageCreateInfo stageInfo{};
+		stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		stageInfo.stage = m_Stage;
+		stageInfo.module = m_Module;
+		stageInfo.pName = "main";
+		stageInfo.pSpecializationInfo = specialization; // Values for the constant_id constants of the stage
+		return stageInfo;
+	}
+
+	std::vector<char> Shader::readFile(const std::string& filename)
+	{
+		std::vector<char> buffer;
+		ENGINE_ASSERT(tryReadFile(filename, buffer), (std::string("Failed to open file at this path: ") + filename).c_str());
+		return buffer;
+	}
+
+	bool Shader::tryReadFile(const std::string& filename, std::vector<char>& buffer)
+	{
+		std::ifstream file(filename, std::ios::ate | std::ios::binary);
+		if (!file.is_open())
+		{
+			buffer.clear();
+			return false;
+		}
+
+		size_t fileSize = (size_t)file.tellg();
+		buffer.resize(fileSize);
+
+		file.seekg(0);
+		file.read(buffer.data(), fileSize);
+		file.close();
+
+		return true;
+	}
+
+	VkResult Shader::createShaderModule()
+	{
+		VkShaderModuleCreateInfo moduleInfo{};
+		moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		moduleInfo.pCode = reinterpret_cast<const uint32_t*>(m_Code.data());
+		moduleInfo.codeSize = m_Code.size();
+
+		return vkCreateShaderModule(VulkanContext::getDevice(), &moduleInfo, nullptr, &m_Module);
+	}
+}
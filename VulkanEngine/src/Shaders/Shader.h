@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <vulkan/vulkan.h>
+
+#include "Core.h"
+
+namespace vkEngine
+{
+	class Shader
+	{
+	public:
+		Shader(const std::string& spirvPath, VkShaderStageFlagBits stage);
+		~Shader();
+
+		// Logs and returns null instead of asserting when the file cannot be read, holds no SPIR-V or the module fails
+		static Scoped<Shader> tryCreate(const std::string& spirvPath, VkShaderStageFlagBits stage);
+
+		Shader(const Shader&) = delete;
+		Shader& operator=(const Shader&) = delete;
+
+		VkShaderModule getModule() const { return m_Module; }
+		VkShaderStageFlagBits getStage() const { return m_Stage; }
+		const std::string& getPath() const { return m_Path; }
+		const std::vector<char>& getCode() const { return m_Code; }
+
+		VkPipelineShaderStageCreateInfo getStageCreateInfo(const VkSpecializationInfo* specialization = nullptr) const;
+
+		static std::vector<char> readFile(const std::string& filename);
+		// False with an empty buffer when the file cannot be opened
+		static bool tryReadFile(const std::string& filename, std::vector<char>& buffer);
+	private:
+		Shader(const std::string& spirvPath, VkShaderStageFlagBits stage, std::vector<char> code);
+
+		VkResult createShaderModule();
+
+	private:
+		std::string m_Path{};
+		std::vector<char> m_Code{};
+		VkShaderStageFlagBits m_Stage;
+		VkShaderModule m_Module = VK_NULL_HANDLE;
+	};
+}
@@ -0,0 +1,81 @@
+#include "pch.h"
+#include "ShaderCompiler.h"
+
+#include <cstdio>
+
+#ifdef _WIN32
+#define SHADER_COMPILER_POPEN _popen
+#define SHADER_COMPILER_PCLOSE _pclose
+#else
+#define SHADER_COMPILER_POPEN popen
+#define SHADER_COMPILER_PCLOSE pclose
+#endif
+
+namespace vkEngine
+{
+	namespace
+	{
+#ifdef _WIN32
+		const char* GLSL_COMPILER = "glslc.exe";
+#else
+		const char* GLSL_COMPILER = "glslc";
+#endif
+		const std::array<const char*, 3> SHADER_EXTENSIONS = { ".vert", ".frag", ".comp" };
+	}
+
+	bool ShaderCompiler::isShaderSource(const std::filesystem::path& path)
+	{
+		const std::string extension = path.extension().string();
+		return std::find(SHADER_EXTENSIONS.begin(), SHADER_EXTENSIONS.end(), extension) != SHADER_EXTENSIONS.end();
+	}
+
+	std::filesystem::path ShaderCompiler::getSpirvPath(const std::filesystem::path& sourcePath, const std::filesystem::path& binaryDir)
+	{
+		// Matches CompileShaders.bat and the premake rule: <name><ext>.spv
+		return binaryDir / (sourcePath.filename().string() + ".spv");
+	}
+
+	bool ShaderCompiler::compileToSpirv(const std::filesystem::path& sourcePath, const std::filesystem::path& outputPath, std::string& errorLog)
+	{
+		std::filesystem::path tempPath = outputPath;
+		tempPath += ".tmp";
+
+		std::string command = std::string(GLSL_COMPILER) + " \"" + sourcePath.string() + "\" -o \"" + tempPath.string() + "\" 2>&1";
+#ifdef _WIN32
+		// cmd.exe strips the outer quotes of the whole command line
+		command = "\"" + command + "\"";
+#endif
+
+		FILE* pipe = SHADER_COMPILER_POPEN(command.c_str(), "r");
+		if (!pipe)
+		{
+			errorLog = "Failed to launch shader compiler";
+			return false;
+		}
+
+		errorLog.clear();
+		std::array<char, 256> buffer{};
+		while (fgets(buffer.data(), static_cast<int>(buffer.size()), pipe))
+		{
+			errorLog += buffer.data();
+		}
+
+		int exitCode = SHADER_COMPILER_PCLOSE(pipe);
+		if (exitCode != 0)
+		{
+			std::error_code ec;
+			std::filesystem::remove(tempPath, ec);
+			return false;
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(tempPath, outputPath, ec);
+		if (ec)
+		{
+			errorLog = "Failed to replace " + outputPath.string() + ": " + ec.message();
+			return false;
+		}
+
+		return true;
+	}
+}
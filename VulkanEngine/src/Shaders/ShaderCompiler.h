@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+#include <filesystem>
+
+namespace vkEngine
+{
+	namespace ShaderCompiler
+	{
+		bool isShaderSource(const std::filesystem::path& path);
+		std::filesystem::path getSpirvPath(const std::filesystem::path& sourcePath, const std::filesystem::path& binaryDir);
+
+		// Compiles GLSL to SPIR-V with glslc. The output is written to a temporary file first and renamed on success,
+		// so readers never observe a partially written binary. Compiler output is returned through errorLog.
+		bool compileToSpirv(const std::filesystem::path& sourcePath, const std::filesystem::path& outputPath, std::string& errorLog);
+	}
+}
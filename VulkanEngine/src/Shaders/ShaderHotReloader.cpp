@@ -0,0 +1,187 @@
+#include "pch.h"
+#include "ShaderHotReloader.h"
+#include "ShaderCompiler.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace vkEngine
+{
+	namespace
+	{
+		constexpr std::chrono::milliseconds WATCH_INTERVAL{ 250 };
+		// Editors usually save through several writes/renames, give them time to settle before compiling
+		constexpr std::chrono::milliseconds DEBOUNCE_INTERVAL{ 50 };
+	}
+
+	ShaderHotReloader::ShaderHotReloader(const std::filesystem::path& sourceDir, const std::filesystem::path& binaryDir)
+		: m_SourceDir(sourceDir), m_BinaryDir(binaryDir)
+	{
+		if (!std::filesystem::is_directory(m_SourceDir))
+		{
+			ENGINE_WARN("Shader hot reload disabled, source directory %s was not found", m_SourceDir.string().c_str());
+			return;
+		}
+
+		if (!initWatcher())
+		{
+			ENGINE_WARN("Shader hot reload disabled, failed to watch %s", m_SourceDir.string().c_str());
+			return;
+		}
+
+		m_Running = true;
+		m_WatchThread = std::thread(&ShaderHotReloader::watchLoop, this);
+		ENGINE_INFO("Watching %s for shader changes", m_SourceDir.string().c_str());
+	}
+
+	ShaderHotReloader::~ShaderHotReloader()
+	{
+		m_Running = false;
+		if (m_WatchThread.joinable())
+			m_WatchThread.join();
+
+		shutdownWatcher();
+	}
+
+	std::vector<std::string> ShaderHotReloader::pollRecompiledShaders()
+	{
+		std::lock_guard<std::mutex> lock(m_RecompiledMutex);
+		std::vector<std::string> recompiled;
+		recompiled.swap(m_RecompiledShaders);
+		return recompiled;
+	}
+
+	void ShaderHotReloader::watchLoop()
+	{
+		std::vector<std::filesystem::path> changedSources;
+
+		while (m_Running)
+		{
+			changedSources.clear();
+			waitForChanges(changedSources);
+
+			if (changedSources.empty())
+				continue;
+
+			std::this_thread::sleep_for(DEBOUNCE_INTERVAL);
+			waitForChanges(changedSources);
+
+			std::sort(changedSources.begin(), changedSources.end());
+			changedSources.erase(std::unique(changedSources.begin(), changedSources.end()), changedSources.end());
+
+			for (const auto& source : changedSources)
+			{
+				recompile(source);
+			}
+		}
+	}
+
+	void ShaderHotReloader::recompile(const std::filesystem::path& sourcePath)
+	{
+		std::filesystem::path spirvPath = ShaderCompiler::getSpirvPath(sourcePath, m_BinaryDir);
+
+		std::string log;
+		if (!ShaderCompiler::compileToSpirv(sourcePath, spirvPath, log))
+		{
+			ENGINE_ERROR("Shader %s failed to compile, keeping the previous binary\n%s", sourcePath.filename().string().c_str(), log.c_str());
+			return;
+		}
+
+		ENGINE_INFO("Shader %s recompiled", sourcePath.filename().string().c_str());
+
+		std::lock_guard<std::mutex> lock(m_RecompiledMutex);
+		m_RecompiledShaders.push_back(spirvPath.generic_string());
+	}
+
+#ifdef __linux__
+	bool ShaderHotReloader::initWatcher()
+	{
+		m_InotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (m_InotifyFd < 0)
+			return false;
+
+		m_WatchDescriptor = inotify_add_watch(m_InotifyFd, m_SourceDir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		return m_WatchDescriptor >= 0;
+	}
+
+	void ShaderHotReloader::shutdownWatcher()
+	{
+		if (m_InotifyFd < 0)
+			return;
+
+		if (m_WatchDescriptor >= 0)
+			inotify_rm_watch(m_InotifyFd, m_WatchDescriptor);
+
+		close(m_InotifyFd);
+		m_InotifyFd = -1;
+		m_WatchDescriptor = -1;
+	}
+
+	void ShaderHotReloader::waitForChanges(std::vector<std::filesystem::path>& changedSources)
+	{
+		pollfd descriptor{};
+		descriptor.fd = m_InotifyFd;
+		descriptor.events = POLLIN;
+
+		if (poll(&descriptor, 1, static_cast<int>(WATCH_INTERVAL.count())) <= 0)
+			return;
+
+		alignas(inotify_event) char buffer[4096];
+		ssize_t length = 0;
+		while ((length = read(m_InotifyFd, buffer, sizeof(buffer))) > 0)
+		{
+			for (char* ptr = buffer; ptr < buffer + length; ptr += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(ptr)->len)
+			{
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+				if (event->len == 0 || (event->mask & IN_ISDIR))
+					continue;
+
+				std::filesystem::path source = m_SourceDir / event->name;
+				if (ShaderCompiler::isShaderSource(source))
+					changedSources.push_back(source);
+			}
+		}
+	}
+#else
+	bool ShaderHotReloader::initWatcher()
+	{
+		for (const auto& entry : std::filesystem::directory_iterator(m_SourceDir))
+		{
+			if (entry.is_regular_file() && ShaderCompiler::isShaderSource(entry.path()))
+				m_WriteTimes[entry.path().string()] = entry.last_write_time();
+		}
+		return true;
+	}
+
+	void ShaderHotReloader::shutdownWatcher()
+	{
+		m_WriteTimes.clear();
+	}
+
+	void ShaderHotReloader::waitForChanges(std::vector<std::filesystem::path>& changedSources)
+	{
+		std::this_thread::sleep_for(WATCH_INTERVAL);
+
+		std::error_code ec;
+		for (const auto& entry : std::filesystem::directory_iterator(m_SourceDir, ec))
+		{
+			if (!entry.is_regular_file() || !ShaderCompiler::isShaderSource(entry.path()))
+				continue;
+
+			auto writeTime = entry.last_write_time(ec);
+			if (ec)
+				continue;
+
+			auto [it, inserted] = m_WriteTimes.try_emplace(entry.path().string(), writeTime);
+			if (inserted || it->second != writeTime)
+			{
+				it->second = writeTime;
+				changedSources.push_back(entry.path());
+			}
+		}
+	}
+#endif
+}
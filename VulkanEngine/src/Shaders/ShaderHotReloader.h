@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace vkEngine
+{
+	// Watches a GLSL source directory and recompiles changed shaders on a background thread.
+	// Linux uses inotify, other platforms fall back to polling file write times.
+	// The render thread collects the SPIR-V paths that were successfully rebuilt through pollRecompiledShaders().
+	class ShaderHotReloader
+	{
+	public:
+		ShaderHotReloader(const std::filesystem::path& sourceDir, const std::filesystem::path& binaryDir);
+		~ShaderHotReloader();
+
+		ShaderHotReloader(const ShaderHotReloader&) = delete;
+		ShaderHotReloader& operator=(const ShaderHotReloader&) = delete;
+
+		std::vector<std::string> pollRecompiledShaders();
+		bool isWatching() const { return m_Running; }
+
+	private:
+		bool initWatcher();
+		void shutdownWatcher();
+		void watchLoop();
+		void waitForChanges(std::vector<std::filesystem::path>& changedSources);
+		void recompile(const std::filesystem::path& sourcePath);
+
+	private:
+		const std::filesystem::path m_SourceDir;
+		const std::filesystem::path m_BinaryDir;
+
+		std::thread m_WatchThread;
+		std::atomic<bool> m_Running = false;
+
+		std::mutex m_RecompiledMutex;
+		std::vector<std::string> m_RecompiledShaders{};
+
+#ifdef __linux__
+		int m_InotifyFd = -1;
+		int m_WatchDescriptor = -1;
+#else
+		std::unordered_map<std::string, std::filesystem::file_time_type> m_WriteTimes{};
+#endif
+	};
+}
@@ -0,0 +1,480 @@
+#include "pch.h"
+#include "ShaderReflection.h"
+
+#include <unordered_map>
+
+namespace vkEngine
+{
+	namespace
+	{
+		// Subset of the SPIR-V specification (unified1) used by the reflection pass
+		constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+		constexpr size_t SPIRV_HEADER_WORDS = 5;
+
+		enum SpirvOp : uint32_t
+		{
+			OpName = 5,
+			OpEntryPoint = 15,
+			OpTypeBool = 20,
+			OpTypeInt = 21,
+			OpTypeFloat = 22,
+			OpTypeVector = 23,
+			OpTypeMatrix = 24,
+			OpTypeImage = 25,
+			OpTypeSampler = 26,
+			OpTypeSampledImage = 27,
+			OpTypeArray = 28,
+			OpTypeRuntimeArray = 29,
+			OpTypeStruct = 30,
+			OpTypePointer = 32,
+			OpConstant = 43,
+			OpSpecConstantTrue = 48,
+			OpSpecConstantFalse = 49,
+			OpSpecConstant = 50,
+			OpVariable = 59,
+			OpDecorate = 71,
+			OpMemberDecorate = 72,
+			OpTypeAccelerationStructureKHR = 5341
+		};
+
+		enum SpirvDecoration : uint32_t
+		{
+			DecorationSpecId = 1,
+			DecorationBlock = 2,
+			DecorationBufferBlock = 3,
+			DecorationArrayStride = 6,
+			DecorationMatrixStride = 7,
+			DecorationBuiltIn = 11,
+			DecorationLocation = 30,
+			DecorationBinding = 33,
+			DecorationDescriptorSet = 34,
+			DecorationOffset = 35
+		};
+
+		enum SpirvStorageClass : uint32_t
+		{
+			StorageClassUniformConstant = 0,
+			StorageClassInput = 1,
+			StorageClassUniform = 2,
+			StorageClassPushConstant = 9,
+			StorageClassStorageBuffer = 12
+		};
+
+		enum SpirvExecutionModel : uint32_t
+		{
+			ExecutionModelVertex = 0,
+			ExecutionModelTessellationControl = 1,
+			ExecutionModelTessellationEvaluation = 2,
+			ExecutionModelGeometry = 3,
+			ExecutionModelFragment = 4,
+			ExecutionModelGLCompute = 5
+		};
+
+		enum SpirvImageDim : uint32_t
+		{
+			DimBuffer = 5,
+			DimSubpassData = 6
+		};
+
+		struct SpirvType
+		{
+			uint32_t opcode = 0;
+			uint32_t elementType = 0;  // vector/matrix/array/pointer/sampled image
+			uint32_t count = 0;        // vector components, matrix columns, array length id
+			uint32_t width = 0;        // scalar bit width
+			uint32_t signedness = 0;
+			uint32_t storageClass = 0; // pointer
+			uint32_t dim = 0;          // image
+			uint32_t sampled = 0;      // image: 1 sampled, 2 storage
+			std::vector<uint32_t> members{};
+		};
+
+		struct SpirvDecorations
+		{
+			std::optional<uint32_t> set{};
+			std::optional<uint32_t> binding{};
+			std::optional<uint32_t> location{};
+			std::optional<uint32_t> specId{};
+			uint32_t arrayStride = 0;
+			bool block = false;
+			bool bufferBlock = false;
+			bool builtIn = false;
+		};
+
+		struct SpirvMemberDecorations
+		{
+			uint32_t offset = 0;
+			uint32_t matrixStride = 0;
+		};
+
+		struct SpirvVariable
+		{
+			uint32_t id = 0;
+			uint32_t pointerType = 0;
+			uint32_t storageClass = 0;
+		};
+
+		struct SpirvSpecConstant
+		{
+			uint32_t id = 0;
+			uint32_t type = 0;
+			uint32_t defaultValue = 0;
+		};
+
+		struct SpirvModule
+		{
+			std::unordered_map<uint32_t, SpirvType> types{};
+			std::unordered_map<uint32_t, SpirvDecorations> decorations{};
+			std::unordered_map<uint64_t, SpirvMemberDecorations> memberDecorations{};
+			std::unordered_map<uint32_t, std::string> names{};
+			std::unordered_map<uint32_t, uint32_t> constants{};
+			std::vector<SpirvVariable> variables{};
+			std::vector<SpirvSpecConstant> specConstants{};
+
+			static uint64_t memberKey(uint32_t structId, uint32_t member) { return (static_cast<uint64_t>(structId) << 32) | member; }
+
+			const SpirvType& type(uint32_t id) const
+			{
+				auto it = types.find(id);
+				ENGINE_ASSERT(it != types.end(), "SPIR-V reflection: unknown type id");
+				return it->second;
+			}
+
+			SpirvDecorations decoration(uint32_t id) const
+			{
+				auto it = decorations.find(id);
+				return it != decorations.end() ? it->second : SpirvDecorations{};
+			}
+
+			SpirvMemberDecorations memberDecoration(uint32_t structId, uint32_t member) const
+			{
+				auto it = memberDecorations.find(memberKey(structId, member));
+				return it != memberDecorations.end() ? it->second : SpirvMemberDecorations{};
+			}
+
+			std::string name(uint32_t id) const
+			{
+				auto it = names.find(id);
+				return it != names.end() ? it->second : std::string{};
+			}
+
+			uint32_t typeSize(uint32_t typeId, uint32_t matrixStride = 0) const
+			{
+				const SpirvType& t = type(typeId);
+				switch (t.opcode)
+				{
+				case OpTypeBool:
+					return 4;
+				case OpTypeInt:
+				case OpTypeFloat:
+					return t.width / 8;
+				case OpTypeVector:
+					return t.count * typeSize(t.elementType);
+				case OpTypeMatrix:
+					return t.count * (matrixStride ? matrixStride : typeSize(t.elementType));
+				case OpTypeArray:
+				{
+					uint32_t stride = decoration(typeId).arrayStride;
+					return constants.at(t.count) * (stride ? stride : typeSize(t.elementType));
+				}
+				case OpTypePointer:
+					return 8; // physical storage buffer reference
+				case OpTypeStruct:
+				{
+					uint32_t size = 0;
+					for (uint32_t i = 0; i < t.members.size(); i++)
+					{
+						SpirvMemberDecorations member = memberDecoration(typeId, i);
+						size = std::max(size, member.offset + typeSize(t.members[i], member.matrixStride));
+					}
+					return size;
+				}
+				default:
+					return 0;
+				}
+			}
+		};
+
+		std::string readString(const uint32_t* words)
+		{
+			return std::string(reinterpret_cast<const char*>(words));
+		}
+
+		VkShaderStageFlagBits toShaderStage(uint32_t executionModel)
+		{
+			switch (executionModel)
+			{
+			case ExecutionModelVertex: return VK_SHADER_STAGE_VERTEX_BIT;
+			case ExecutionModelTessellationControl: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+			case ExecutionModelTessellationEvaluation: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+			case ExecutionModelGeometry: return VK_SHADER_STAGE_GEOMETRY_BIT;
+			case ExecutionModelFragment: return VK_SHADER_STAGE_FRAGMENT_BIT;
+			case ExecutionModelGLCompute: return VK_SHADER_STAGE_COMPUTE_BIT;
+			default: return VK_SHADER_STAGE_ALL;
+			}
+		}
+
+		VkFormat toVertexFormat(const SpirvModule& module, const SpirvType& type)
+		{
+			const SpirvType& scalar = type.opcode == OpTypeVector ? module.type(type.elementType) : type;
+			uint32_t components = type.opcode == OpTypeVector ? type.count : 1;
+
+			if (scalar.width != 32)
+				return VK_FORMAT_UNDEFINED;
+
+			static const VkFormat floatFormats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+			static const VkFormat intFormats[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+			static const VkFormat uintFormats[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+			if (scalar.opcode == OpTypeFloat)
+				return floatFormats[components - 1];
+			if (scalar.opcode == OpTypeInt)
+				return scalar.signedness ? intFormats[components - 1] : uintFormats[components - 1];
+
+			return VK_FORMAT_UNDEFINED;
+		}
+
+		VkDescriptorType toDescriptorType(const SpirvModule& module, uint32_t storageClass, uint32_t typeId)
+		{
+			const SpirvType& type = module.type(typeId);
+
+			if (storageClass == StorageClassStorageBuffer)
+				return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+			if (storageClass == StorageClassUniform)
+				return module.decoration(typeId).bufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+			switch (type.opcode)
+			{
+			case OpTypeSampler:
+				return VK_DESCRIPTOR_TYPE_SAMPLER;
+			case OpTypeSampledImage:
+				return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			case OpTypeImage:
+				if (type.dim == DimBuffer)
+					return type.sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+				if (type.dim == DimSubpassData)
+					return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+				return type.sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			case OpTypeAccelerationStructureKHR:
+				return VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+			default:
+				return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+			}
+		}
+	}
+
+	ShaderReflection::ShaderReflection(const std::vector<char>& spirv)
+	{
+		ENGINE_ASSERT(spirv.size() % sizeof(uint32_t) == 0 && spirv.size() >= SPIRV_HEADER_WORDS * sizeof(uint32_t), "SPIR-V reflection: invalid binary size");
+
+		std::vector<uint32_t> words(spirv.size() / sizeof(uint32_t));
+		memcpy(words.data(), spirv.data(), spirv.size());
+
+		parse(words.data(), words.size());
+	}
+
+	const ReflectedSpecConstant* ShaderReflection::findSpecConstant(const std::string& name) const
+	{
+		auto it = std::find_if(m_SpecConstants.begin(), m_SpecConstants.end(), [&name](const ReflectedSpecConstant& constant) { return constant.name == name; });
+		return it != m_SpecConstants.end() ? &(*it) : nullptr;
+	}
+
+	void ShaderReflection::parse(const uint32_t* words, size_t wordCount)
+	{
+		ENGINE_ASSERT(words[0] == SPIRV_MAGIC, "SPIR-V reflection: invalid magic number");
+
+		SpirvModule module;
+
+		for (size_t i = SPIRV_HEADER_WORDS; i < wordCount;)
+		{
+			const uint32_t opcode = words[i] & 0xFFFF;
+			const uint32_t length = words[i] >> 16;
+			const uint32_t* op = &words[i];
+
+			ENGINE_ASSERT(length > 0 && i + length <= wordCount, "SPIR-V reflection: malformed instruction");
+
+			switch (opcode)
+			{
+			case OpEntryPoint:
+				if (m_Stage == VK_SHADER_STAGE_ALL)
+					m_Stage = toShaderStage(op[1]);
+				break;
+			case OpName:
+				module.names[op[1]] = readString(&op[2]);
+				break;
+			case OpDecorate:
+			{
+				SpirvDecorations& decoration = module.decorations[op[1]];
+				switch (op[2])
+				{
+				case DecorationBlock: decoration.block = true; break;
+				case DecorationBufferBlock: decoration.bufferBlock = true; break;
+				case DecorationBuiltIn: decoration.builtIn = true; break;
+				case DecorationArrayStride: decoration.arrayStride = op[3]; break;
+				case DecorationLocation: decoration.location = op[3]; break;
+				case DecorationBinding: decoration.binding = op[3]; break;
+				case DecorationDescriptorSet: decoration.set = op[3]; break;
+				case DecorationSpecId: decoration.specId = op[3]; break;
+				default: break;
+				}
+				break;
+			}
+			case OpMemberDecorate:
+			{
+				SpirvMemberDecorations& decoration = module.memberDecorations[SpirvModule::memberKey(op[1], op[2])];
+				if (op[3] == DecorationOffset)
+					decoration.offset = op[4];
+				else if (op[3] == DecorationMatrixStride)
+					decoration.matrixStride = op[4];
+				break;
+			}
+			case OpTypeBool:
+			case OpTypeSampler:
+			case OpTypeAccelerationStructureKHR:
+				module.types[op[1]] = { .opcode = opcode };
+				break;
+			case OpTypeInt:
+				module.types[op[1]] = { .opcode = opcode, .width = op[2], .signedness = op[3] };
+				break;
+			case OpTypeFloat:
+				module.types[op[1]] = { .opcode = opcode, .width = op[2] };
+				break;
+			case OpTypeVector:
+			case OpTypeMatrix:
+			case OpTypeArray:
+				module.types[op[1]] = { .opcode = opcode, .elementType = op[2], .count = op[3] };
+				break;
+			case OpTypeRuntimeArray:
+			case OpTypeSampledImage:
+				module.types[op[1]] = { .opcode = opcode, .elementType = op[2] };
+				break;
+			case OpTypeImage:
+				module.types[op[1]] = { .opcode = opcode, .elementType = op[2], .dim = op[3], .sampled = op[7] };
+				break;
+			case OpTypeStruct:
+				module.types[op[1]] = { .opcode = opcode, .members = std::vector<uint32_t>(op + 2, op + length) };
+				break;
+			case OpTypePointer:
+				module.types[op[1]] = { .opcode = opcode, .elementType = op[3], .storageClass = op[2] };
+				break;
+			case OpConstant:
+				module.constants[op[2]] = op[3];
+				break;
+			case OpSpecConstantTrue:
+			case OpSpecConstantFalse:
+			case OpSpecConstant:
+			{
+				// Array sizes that depend on a specialization constant are reflected with its default value
+				uint32_t defaultValue = opcode == OpSpecConstant ? op[3] : (opcode == OpSpecConstantTrue ? 1 : 0);
+				module.constants[op[2]] = defaultValue;
+				module.specConstants.push_back({ .id = op[2], .type = op[1], .defaultValue = defaultValue });
+				break;
+			}
+			case OpVariable:
+				module.variables.push_back({ .id = op[2], .pointerType = op[1], .storageClass = op[3] });
+				break;
+			default:
+				break;
+			}
+
+			i += length;
+		}
+
+		for (const SpirvVariable& variable : module.variables)
+		{
+			const SpirvDecorations decoration = module.decoration(variable.id);
+			uint32_t typeId = module.type(variable.pointerType).elementType;
+
+			switch (variable.storageClass)
+			{
+			case StorageClassUniformConstant:
+			case StorageClassUniform:
+			case StorageClassStorageBuffer:
+			{
+				if (!decoration.binding.has_value())
+					break;
+
+				ReflectedBinding binding{};
+				binding.name = module.name(variable.id);
+				binding.set = decoration.set.value_or(0);
+				binding.binding = decoration.binding.value();
+				binding.stageFlags = m_Stage;
+
+				const SpirvType* type = &module.type(typeId);
+				if (type->opcode == OpTypeArray)
+				{
+					binding.count = module.constants.at(type->count);
+					typeId = type->elementType;
+				}
+				else if (type->opcode == OpTypeRuntimeArray)
+				{
+					binding.count = 0;
+					typeId = type->elementType;
+				}
+
+				binding.type = toDescriptorType(module, variable.storageClass, typeId);
+				ENGINE_ASSERT(binding.type != VK_DESCRIPTOR_TYPE_MAX_ENUM, "SPIR-V reflection: unsupported descriptor type");
+
+				m_Bindings.push_back(binding);
+				break;
+			}
+			case StorageClassPushConstant:
+			{
+				const SpirvType& block = module.type(typeId);
+				uint32_t offset = UINT32_MAX;
+				for (uint32_t member = 0; member < block.members.size(); member++)
+				{
+					offset = std::min(offset, module.memberDecoration(typeId, member).offset);
+				}
+				if (offset == UINT32_MAX)
+					offset = 0;
+
+				VkPushConstantRange range{};
+				range.stageFlags = m_Stage;
+				range.offset = offset;
+				range.size = module.typeSize(typeId) - offset;
+				m_PushConstantRange = range;
+				break;
+			}
+			case StorageClassInput:
+			{
+				if (m_Stage != VK_SHADER_STAGE_VERTEX_BIT || decoration.builtIn || !decoration.location.has_value())
+					break;
+
+				ReflectedVertexInput input{};
+				input.name = module.name(variable.id);
+				input.location = decoration.location.value();
+				input.format = toVertexFormat(module, module.type(typeId));
+				m_VertexInputs.push_back(input);
+				break;
+			}
+			default:
+				break;
+			}
+		}
+
+		for (const SpirvSpecConstant& constant : module.specConstants)
+		{
+			const SpirvDecorations decoration = module.decoration(constant.id);
+			if (!decoration.specId.has_value())
+				continue;
+
+			ReflectedSpecConstant specConstant{};
+			specConstant.name = module.name(constant.id);
+			specConstant.constantId = decoration.specId.value();
+			specConstant.size = module.typeSize(constant.type);
+			specConstant.defaultValue = constant.defaultValue;
+			m_SpecConstants.push_back(specConstant);
+		}
+
+		std::sort(m_Bindings.begin(), m_Bindings.end(), [](const ReflectedBinding& a, const ReflectedBinding& b)
+			{
+				return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+			});
+		std::sort(m_VertexInputs.begin(), m_VertexInputs.end(), [](const ReflectedVertexInput& a, const ReflectedVertexInput& b)
+			{
+				return a.location < b.location;
+			});
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vkEngine
+{
+	struct ReflectedBinding
+	{
+		std::string name{};
+		uint32_t set = 0;
+		uint32_t binding = 0;
+		VkDescriptorType type = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+		uint32_t count = 1; // 0 for runtime sized arrays
+		VkShaderStageFlags stageFlags = 0;
+	};
+
+	struct ReflectedVertexInput
+	{
+		std::string name{};
+		uint32_t location = 0;
+		VkFormat format = VK_FORMAT_UNDEFINED;
+	};
+
+	struct ReflectedSpecConstant
+	{
+		std::string name{};
+		uint32_t constantId = 0;
+		uint32_t size = 4; // bool constants are 32 bit as well
+		uint32_t defaultValue = 0;
+	};
+
+	// Minimal SPIR-V reader that extracts what is needed to build pipeline state:
+	// descriptor bindings, push constant block size, vertex stage inputs and specialization constants.
+	class ShaderReflection
+	{
+	public:
+		ShaderReflection(const std::vector<char>& spirv);
+
+		VkShaderStageFlagBits getStage() const { return m_Stage; }
+		const std::vector<ReflectedBinding>& getBindings() const { return m_Bindings; }
+		const std::vector<ReflectedVertexInput>& getVertexInputs() const { return m_VertexInputs; }
+		const std::optional<VkPushConstantRange>& getPushConstantRange() const { return m_PushConstantRange; }
+		const std::vector<ReflectedSpecConstant>& getSpecConstants() const { return m_SpecConstants; }
+		const ReflectedSpecConstant* findSpecConstant(const std::string& name) const;
+
+	private:
+		void parse(const uint32_t* words, size_t wordCount);
+
+	private:
+		VkShaderStageFlagBits m_Stage = VK_SHADER_STAGE_ALL;
+		std::vector<ReflectedBinding> m_Bindings{};
+		std::vector<ReflectedVertexInput> m_VertexInputs{};
+		std::optional<VkPushConstantRange> m_PushConstantRange{};
+		std::vector<ReflectedSpecConstant> m_SpecConstants{};
+	};
+}
@@ -0,0 +1,37 @@
+#include "pch.h"
+#include "ShaderSpecialization.h"
+#include "ShaderReflection.h"
+
+namespace vkEngine
+{
+	ShaderSpecialization::ShaderSpecialization(const ShaderReflection& reflection, const SpecializationConstants& constants)
+	{
+		for (const auto& [name, value] : constants)
+		{
+			const ReflectedSpecConstant* constant = reflection.findSpecConstant(name);
+			if (!constant)
+				continue;
+
+			ENGINE_ASSERT(constant->size == sizeof(uint32_t), "Specialization constant %s must be a 32 bit scalar", name.c_str());
+
+			VkSpecializationMapEntry entry{};
+			entry.constantID = constant->constantId;
+			entry.offset = static_cast<uint32_t>(m_Data.size() * sizeof(uint32_t));
+			entry.size = sizeof(uint32_t);
+
+			m_Names.push_back(name);
+			m_Entries.push_back(entry);
+			m_Data.push_back(value);
+		}
+
+		m_Info.mapEntryCount = static_cast<uint32_t>(m_Entries.size());
+		m_Info.pMapEntries = m_Entries.data();
+		m_Info.dataSize = m_Data.size() * sizeof(uint32_t);
+		m_Info.pData = m_Data.data();
+	}
+
+	bool ShaderSpecialization::isSpecialized(const std::string& name) const
+	{
+		return std::find(m_Names.begin(), m_Names.end(), name) != m_Names.end();
+	}
+}
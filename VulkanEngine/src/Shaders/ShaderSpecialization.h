@@ -0,0 +1,35 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace vkEngine
+{
+	class ShaderReflection;
+
+	// Specialization constant values keyed by their name in GLSL, e.g. layout(constant_id = 0) const bool USE_TEXTURE
+	using SpecializationConstants = std::map<std::string, uint32_t>;
+
+	// Resolves named constant values to the constant ids declared by one shader stage.
+	// Constants the stage does not declare are skipped, so one set of values can be shared by every stage of a pipeline.
+	class ShaderSpecialization
+	{
+	public:
+		ShaderSpecialization(const ShaderReflection& reflection, const SpecializationConstants& constants);
+
+		ShaderSpecialization(const ShaderSpecialization&) = delete;
+		ShaderSpecialization& operator=(const ShaderSpecialization&) = delete;
+
+		// nullptr when the stage uses only default values
+		const VkSpecializationInfo* getInfo() const { return m_Entries.empty() ? nullptr : &m_Info; }
+		bool isSpecialized(const std::string& name) const;
+
+	private:
+		std::vector<std::string> m_Names{};
+		std::vector<VkSpecializationMapEntry> m_Entries{};
+		std::vector<uint32_t> m_Data{};
+		VkSpecializationInfo m_Info{};
+	};
+}
@@ -5,12 +5,15 @@
 #include "QueueHandler.h"
 #include "Window/Window.h"
 #include <Images/Image2D.h>
+#include <Images/RenderTargetPool.h>
 
 namespace vkEngine
 {
-	Swapchain::Swapchain(const Shared<Window>& window, VkSurfaceKHR surface, Shared<LogicalDevice>& device, Shared<PhysicalDevice>& phyDevice, Shared<QueueHandler>& qHandler, uint32_t maxFramesInFlight)
+	Swapchain::Swapchain(const Shared<Window>& window, VkSurfaceKHR surface, Shared<LogicalDevice>& device, Shared<PhysicalDevice>& phyDevice, Shared<QueueHandler>& qHandler,
+		const Shared<RenderTargetPool>& renderTargetPool, uint32_t maxFramesInFlight)
 		:
 		m_Device(device),
+		m_RenderTargetPool(renderTargetPool),
 		m_Window(window),
 		m_Surface(surface),
 		m_PhysicalDevice(phyDevice),
@@ -66,10 +69,16 @@ namespace vkEngine
 
 		cleanupSwapchain();
 		initSwapchain();
-		m_DepthBuffer->resize(m_SwapchainExtent.width, m_SwapchainExtent.height);
-		m_MultisampledColorBuffer->resize(m_SwapchainExtent.width, m_SwapchainExtent.height);
+		// The previous size's attachments wait in the pool, resizing back to it reuses them instead of allocating
+		m_RenderTargetPool->release(std::move(m_DepthBuffer));
+		m_RenderTargetPool->release(std::move(m_MultisampledColorBuffer));
+		if (m_UsedMSAABuffer)
+			initMSAAColorBuffer();
+		initDepthBuffer();
 		initImageViews();
-		initFramebuffers(renderpass);
+		// Dynamic rendering has no render pass and needs no framebuffers
+		if (renderpass != VK_NULL_HANDLE)
+			initFramebuffers(renderpass);
 		initSemaphores();
 	}
 
@@ -135,20 +144,49 @@ namespace vkEngine
 		}
 	}
 
+	void Swapchain::setDepthBufferSampled(bool sampled)
+	{
+		if (sampled == m_SampledDepthBuffer)
+			return;
+
+		m_SampledDepthBuffer = sampled;
+		m_RenderTargetPool->release(std::move(m_DepthBuffer));
+		initDepthBuffer();
+	}
+
+	void Swapchain::setMSAABufferUsed(bool used)
+	{
+		if (used == m_UsedMSAABuffer)
+			return;
+
+		m_UsedMSAABuffer = used;
+		m_MultisampledColorBuffer.reset();
+		if (used)
+			initMSAAColorBuffer();
+	}
+
+	// The attachments are only written and read within a single draw pass. As transient attachments in lazily allocated
+	// memory, tile based GPUs keep them on chip and never back the multisampled samples with memory. With occlusion culling
+	// the late draw loads what the early draw stored, which would commit that memory: the depth buffer is sampled then, and
+	// the multisampled color is the render graph's, see RenderGraph
 	void Swapchain::initDepthBuffer()
 	{
 		VkFormat depthFormat = m_PhysicalDevice->findDepthFormat();
+		// Sampled to build the depth pyramid, transient usage excludes any use outside of attachments
+		VkImageUsageFlags usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		usage |= m_SampledDepthBuffer ? VK_IMAGE_USAGE_SAMPLED_BIT : VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
 		Image2DConfig config =
 		{
 			.extent = {m_SwapchainExtent},
 			.format = depthFormat,
 			.memoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			.usageFlags = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+			.usageFlags = usage,
 			.aspectFlags = VK_IMAGE_ASPECT_DEPTH_BIT,
 			.mipmapLevel = 1,
-			.sampleCount = m_PhysicalDevice->getMaxUsableSampleCount()
+			.sampleCount = m_PhysicalDevice->getMaxUsableSampleCount(),
+			.preferredMemoryProperties = m_SampledDepthBuffer ? 0u : VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT
 		};
-		m_DepthBuffer = CreateScoped<DepthImage>(m_PhysicalDevice, m_Device, config);
+		m_DepthBuffer = m_RenderTargetPool->acquireDepth(config);
 	}
 
 	void Swapchain::initMSAAColorBuffer()
@@ -158,12 +196,13 @@ namespace vkEngine
 			.extent = {m_SwapchainExtent},
 			.format = m_SwapchainImageFormat,
 			.memoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			.usageFlags = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+			.usageFlags = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
 			.aspectFlags = VK_IMAGE_ASPECT_COLOR_BIT,
 			.mipmapLevel = 1,
-			.sampleCount = m_PhysicalDevice->getMaxUsableSampleCount()
+			.sampleCount = m_PhysicalDevice->getMaxUsableSampleCount(),
+			.preferredMemoryProperties = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT
 		};
-		m_MultisampledColorBuffer = CreateScoped<Image2D>(m_PhysicalDevice, m_Device, config);
+		m_MultisampledColorBuffer = m_RenderTargetPool->acquire(config);
 	}
 
 	VkPresentModeKHR Swapchain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& abailableModes)
@@ -15,6 +15,7 @@ namespace vkEngine
 	class PhysicalDevice;
 	class DepthImage;
 	class Image2D;
+	class RenderTargetPool;
 
 
 	struct QueueFamilyIndices;
@@ -31,7 +32,8 @@ namespace vkEngine
 		friend Window;
 
 	public:
-		Swapchain(const Shared<Window>& window, VkSurfaceKHR surface, Shared<LogicalDevice>& device, Shared<PhysicalDevice>& physicalD, Shared<QueueHandler>& qHandler, uint32_t maxFramesInFlight);
+		Swapchain(const Shared<Window>& window, VkSurfaceKHR surface, Shared<LogicalDevice>& device, Shared<PhysicalDevice>& physicalD, Shared<QueueHandler>& qHandler,
+			const Shared<RenderTargetPool>& renderTargetPool, uint32_t maxFramesInFlight);
 		Swapchain() = delete;
 		~Swapchain();
 		void resize(uint32_t newWidth, uint32_t newHeight);
@@ -39,6 +41,12 @@ namespace vkEngine
 		void present(VkSemaphore* signalSemaphores, uint32_t count);
 		void recreateSwapchain(VkRenderPass renderpass);
 		void cleanupSwapchain();
+		// Only a depth buffer something samples after its pass keeps SAMPLED usage. Otherwise it is a transient attachment
+		// like the multisampled color buffer. Recreates the depth buffer, call it before creating framebuffers
+		void setDepthBufferSampled(bool sampled);
+		// Only the render pass path draws into the multisampled color buffer, through the framebuffers. With dynamic
+		// rendering the render graph creates its own and the swapchain keeps none
+		void setMSAABufferUsed(bool used);
 
 
 
@@ -48,6 +56,8 @@ namespace vkEngine
 		VkFormat getImagesFormat() const { return m_SwapchainImageFormat; }
 		VkExtent2D getExtent() const { return m_SwapchainExtent; }
 		VkFramebuffer getFramebuffer(uint32_t index) const { return m_SwapchainFramebuffers[index]; }
+		VkImage getImage(uint32_t index) const { return m_SwapchainImages[index]; }
+		VkImageView getImageView(uint32_t index) const { return m_SwapchainImageViews[index]; }
 		void initFramebuffers(VkRenderPass renderpass);
 		uint32_t getImageIndex() const { return m_ImageIndex; }
 	private:
@@ -66,6 +76,7 @@ namespace vkEngine
 		const Shared<QueueHandler> m_QueueHandler;
 		const Shared<PhysicalDevice> m_PhysicalDevice;
 		const Shared<LogicalDevice> m_Device;
+		const Shared<RenderTargetPool> m_RenderTargetPool; // Holds the attachments of previous sizes
 
 	private:
 		VkSurfaceKHR m_Surface = nullptr;
@@ -74,6 +85,8 @@ namespace vkEngine
 		std::vector<VkFramebuffer> m_SwapchainFramebuffers{};
 		Scoped<DepthImage> m_DepthBuffer;
 		Scoped<Image2D> m_MultisampledColorBuffer;
+		bool m_SampledDepthBuffer = true;
+		bool m_UsedMSAABuffer = true;
 
 
 		//TODO: should I go with different image class aka swapchainImage?
@@ -0,0 +1,34 @@
+#include "pch.h"
+#include "DeletionQueue.h"
+
+namespace vkEngine
+{
+	DeletionQueue::~DeletionQueue()
+	{
+		flushAll();
+	}
+
+	void DeletionQueue::push(uint64_t lastUsedFrame, std::function<void()>&& deleter)
+	{
+		m_Deleters.push_back({ lastUsedFrame, std::move(deleter) });
+	}
+
+	void DeletionQueue::flush(uint64_t completedFrame)
+	{
+		// Frames are pushed in submission order, so the front is always the oldest entry
+		while (!m_Deleters.empty() && m_Deleters.front().lastUsedFrame <= completedFrame)
+		{
+			m_Deleters.front().deleter();
+			m_Deleters.pop_front();
+		}
+	}
+
+	void DeletionQueue::flushAll()
+	{
+		for (auto& pending : m_Deleters)
+		{
+			pending.deleter();
+		}
+		m_Deleters.clear();
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <cstdint>
+
+namespace vkEngine
+{
+	// Defers destruction of GPU objects until every frame that may still reference them has completed.
+	// Deleters are tagged with the last submitted frame number and released once that frame's fence was waited on.
+	class DeletionQueue
+	{
+	public:
+		DeletionQueue() = default;
+		~DeletionQueue();
+
+		DeletionQueue(const DeletionQueue&) = delete;
+		DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+		void push(uint64_t lastUsedFrame, std::function<void()>&& deleter);
+		void flush(uint64_t completedFrame);
+		void flushAll();
+
+		bool isEmpty() const { return m_Deleters.empty(); }
+
+	private:
+		struct PendingDeleter
+		{
+			uint64_t lastUsedFrame = 0;
+			std::function<void()> deleter;
+		};
+
+		std::deque<PendingDeleter> m_Deleters{};
+	};
+}
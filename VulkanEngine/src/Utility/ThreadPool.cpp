@@ -0,0 +1,111 @@
+#include "pch.h"
+#include "ThreadPool.h"
+
+namespace vkEngine
+{
+	ThreadPool::ThreadPool(uint32_t workerCount)
+	{
+		m_Workers.reserve(workerCount);
+		for (uint32_t i = 0; i < workerCount; i++)
+		{
+			m_Workers.emplace_back(&ThreadPool::workerLoop, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stop = true;
+		}
+		m_WorkAvailable.notify_all();
+
+		for (std::thread& worker : m_Workers)
+		{
+			worker.join();
+		}
+	}
+
+	uint32_t ThreadPool::getDefaultWorkerCount()
+	{
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	void ThreadPool::parallelFor(size_t count, size_t chunkSize, const ChunkTask& task)
+	{
+		if (count == 0)
+			return;
+
+		ENGINE_ASSERT(chunkSize > 0, "Thread pool chunk size must not be zero");
+		size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+		if (m_Workers.empty() || chunkCount == 1)
+		{
+			for (size_t begin = 0; begin < count; begin += chunkSize)
+			{
+				task(begin, std::min(begin + chunkSize, count));
+			}
+			return;
+		}
+
+		{
+			// A worker that woke up late for the previous loop may still be leaving it
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_WorkDone.wait(lock, [this]() { return m_ActiveWorkers == 0; });
+
+			m_Task = &task;
+			m_Count = count;
+			m_ChunkSize = chunkSize;
+			m_ChunkCount = chunkCount;
+			m_NextChunk = 0;
+			m_CompletedChunks = 0;
+			m_Generation++;
+		}
+		m_WorkAvailable.notify_all();
+
+		runChunks();
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_WorkDone.wait(lock, [this]() { return m_CompletedChunks == m_ChunkCount; });
+	}
+
+	void ThreadPool::workerLoop()
+	{
+		uint64_t generation = 0;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_WorkAvailable.wait(lock, [this, generation]() { return m_Stop || m_Generation != generation; });
+				if (m_Stop)
+					return;
+
+				generation = m_Generation;
+				m_ActiveWorkers++;
+			}
+
+			runChunks();
+
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_ActiveWorkers--;
+			}
+			m_WorkDone.notify_all();
+		}
+	}
+
+	void ThreadPool::runChunks()
+	{
+		for (size_t chunk = m_NextChunk++; chunk < m_ChunkCount; chunk = m_NextChunk++)
+		{
+			size_t begin = chunk * m_ChunkSize;
+			(*m_Task)(begin, std::min(begin + m_ChunkSize, m_Count));
+
+			if (++m_CompletedChunks == m_ChunkCount)
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_WorkDone.notify_all();
+			}
+		}
+	}
+}
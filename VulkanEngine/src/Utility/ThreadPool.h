@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vkEngine
+{
+	// Fixed set of worker threads for data parallel loops. The calling thread works on the loop as well,
+	// so a pool of N workers runs N + 1 chunks at a time. Loops are not reentrant, one runs at a time.
+	class ThreadPool
+	{
+	public:
+		using ChunkTask = std::function<void(size_t begin, size_t end)>;
+
+		// Defaults to one worker less than the hardware threads, the caller takes the last one
+		ThreadPool(uint32_t workerCount = getDefaultWorkerCount());
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		// Splits [0, count) into chunks of chunkSize and returns once task has run on all of them
+		void parallelFor(size_t count, size_t chunkSize, const ChunkTask& task);
+
+		uint32_t getWorkerCount() const { return static_cast<uint32_t>(m_Workers.size()); }
+		static uint32_t getDefaultWorkerCount();
+
+	private:
+		void workerLoop();
+		void runChunks();
+
+	private:
+		std::vector<std::thread> m_Workers{};
+
+		std::mutex m_Mutex;
+		std::condition_variable m_WorkAvailable;
+		std::condition_variable m_WorkDone;
+		uint64_t m_Generation = 0; // Bumped for every loop, wakes the workers
+		uint32_t m_ActiveWorkers = 0;
+		bool m_Stop = false;
+
+		// Current loop, only written while no worker is active
+		const ChunkTask* m_Task = nullptr;
+		size_t m_Count = 0;
+		size_t m_ChunkSize = 0;
+		size_t m_ChunkCount = 0;
+		std::atomic<size_t> m_NextChunk{ 0 };
+		std::atomic<size_t> m_CompletedChunks{ 0 };
+	};
+}
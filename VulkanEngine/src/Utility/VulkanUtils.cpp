@@ -20,4 +20,27 @@ namespace vkEngine
 		ENGINE_ASSERT(false, "There is no suitable type of memory for buffer allocation");
 		return 0;
 	}
+
+	void VulkanUtils::insertImageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageAspectFlags aspectMask,
+		VkImageLayout oldLayout, VkImageLayout newLayout,
+		VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+		VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+	{
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = aspectMask;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+
+		vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
 }
@@ -8,5 +8,11 @@ namespace vkEngine
     namespace VulkanUtils
     {
         uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+        // Layout transition covering every mip level and layer of the image
+        void insertImageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageAspectFlags aspectMask,
+            VkImageLayout oldLayout, VkImageLayout newLayout,
+            VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+            VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
     }
 }
@@ -3,6 +3,7 @@
 
 #include "Application.h"
 #include "QueueHandler.h"
+#include "Images/RenderTargetPool.h"
 
 namespace vkEngine
 {
@@ -15,13 +16,14 @@ namespace vkEngine
 
 	void VulkanContext::initializeInstance(const Engine& engine, const std::vector<const char*>& deviceExtensions)
 	{
-		m_ContextInstance = ScopedVulkanContext(new VulkanContext(engine, deviceExtensions), &vulkanContextDeleterFunc);
+		// Services created during initialization query the context through the static getters, so it is published first
+		m_ContextInstance = ScopedVulkanContext(new VulkanContext(engine), &vulkanContextDeleterFunc);
+		m_ContextInstance->initialize(deviceExtensions);
 	}
 
-	VulkanContext::VulkanContext(const Engine& engine, const std::vector<const char*>& deviceExtensions)
+	VulkanContext::VulkanContext(const Engine& engine)
 		: m_Engine(engine)
 	{
-		initialize(deviceExtensions);
 	}
 
 	VulkanContext::~VulkanContext()
@@ -40,8 +42,12 @@ namespace vkEngine
 		initPhysicalDevice(deviceExtensions);
 		initLogicalDevice(deviceExtensions);
 		initQueueHandler();
+		initRenderTargetPool();
 		initSwapchain();
 		initCommandBufferHandler();
+		initPipelineLayoutCache();
+		initDescriptorBuffer();
+		initBindlessRegistry();
 	}
 
 	inline void VulkanContext::initCommandBufferHandler()
@@ -58,10 +64,16 @@ namespace vkEngine
 				m_Device,
 				m_PhysicalDevice,
 				m_QueueHandler,
+				m_RenderTargetPool,
 				m_Engine.s_MaxFramesInFlight
 			);
 	}
 
+	inline void VulkanContext::initRenderTargetPool()
+	{
+		m_RenderTargetPool = CreateShared<RenderTargetPool>(m_PhysicalDevice, m_Device);
+	}
+
 	void VulkanContext::initQueueHandler()
 	{
 		m_QueueHandler = CreateScoped<QueueHandler>(m_Device, m_PhysicalDevice);
@@ -78,9 +90,30 @@ namespace vkEngine
 	}
 
 
+	inline void VulkanContext::initPipelineLayoutCache()
+	{
+		m_PipelineLayoutCache = CreateShared<PipelineLayoutCache>(m_Device->logicalDevice());
+	}
+
+
+	inline void VulkanContext::initDescriptorBuffer()
+	{
+		if (m_PhysicalDevice->getCapabilities().descriptorBuffer)
+			m_DescriptorBuffer = CreateShared<DescriptorBuffer>(m_Device->logicalDevice());
+	}
+
+	inline void VulkanContext::initBindlessRegistry()
+	{
+		m_BindlessRegistry = CreateShared<BindlessRegistry>(m_Device->logicalDevice());
+	}
+
 	void VulkanContext::cleanup()
 	{
+		m_BindlessRegistry.reset();
+		m_DescriptorBuffer.reset();
+		m_PipelineLayoutCache.reset();
 		m_Swapchain.reset();
+		m_RenderTargetPool.reset();
 		m_CommandHandler.reset();
 		m_QueueHandler.reset();
 		m_Device.reset();
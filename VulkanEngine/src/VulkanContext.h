@@ -7,6 +7,9 @@
 #include "Devices/PhysicalDevice.h"
 #include "Devices/LogicalDevice.h"
 #include "CommandBufferHandler.h"
+#include "Pipeline/PipelineLayoutCache.h"
+#include "Descriptors/BindlessRegistry.h"
+#include "Descriptors/DescriptorBuffer.h"
 
 #include "Core.h"
 
@@ -16,6 +19,7 @@ namespace vkEngine
 	class Engine;
 	class Application;
 	class QueueHandler;
+	class RenderTargetPool;
 
 	using QueueFamilyIndex = uint32_t;
 
@@ -31,6 +35,11 @@ namespace vkEngine
 		static inline const Shared<Swapchain>& getSwapchain() { return m_ContextInstance->m_Swapchain; }
 		static inline const Shared<LogicalDevice>& getLogicalDevice() { return m_ContextInstance->m_Device; };
 		static inline const Shared<CommandBufferHandler>& getCommandHandler() { return m_ContextInstance->m_CommandHandler; };
+		static inline const Shared<PipelineLayoutCache>& getPipelineLayoutCache() { return m_ContextInstance->m_PipelineLayoutCache; };
+		static inline const Shared<BindlessRegistry>& getBindlessRegistry() { return m_ContextInstance->m_BindlessRegistry; };
+		static inline const Shared<RenderTargetPool>& getRenderTargetPool() { return m_ContextInstance->m_RenderTargetPool; };
+		// Null when descriptors are allocated from pools
+		static inline const Shared<DescriptorBuffer>& getDescriptorBuffer() { return m_ContextInstance->m_DescriptorBuffer; };
 
 
 		static inline VkDevice getDevice() { return m_ContextInstance->m_Device->logicalDevice(); }
@@ -40,7 +49,7 @@ namespace vkEngine
 		using ScopedVulkanContext = Scoped<VulkanContext, decltype(&vulkanContextDeleterFunc)>;
 	private:
 		~VulkanContext();
-		VulkanContext(const Engine& engine, const std::vector<const char*>& deviceExtensions);
+		VulkanContext(const Engine& engine);
 		void initialize(const std::vector<const char*>& deviceExtensions);
 
 		static void initializeInstance(const Engine& engine, const std::vector<const char*>& deviceExtensions);
@@ -55,12 +64,20 @@ namespace vkEngine
 		Shared<QueueHandler> m_QueueHandler = nullptr;
 		Shared<PhysicalDevice> m_PhysicalDevice = nullptr;
 		Shared<LogicalDevice> m_Device = nullptr;
+		Shared<PipelineLayoutCache> m_PipelineLayoutCache = nullptr;
+		Shared<DescriptorBuffer> m_DescriptorBuffer = nullptr;
+		Shared<BindlessRegistry> m_BindlessRegistry = nullptr;
+		Shared<RenderTargetPool> m_RenderTargetPool = nullptr;
 	private:
 		inline void initCommandBufferHandler();
+		inline void initRenderTargetPool();
 		inline void initSwapchain();
 		inline void initQueueHandler();
 		inline void initPhysicalDevice(const std::vector<const char*>& deviceExtensions);
 		inline void initLogicalDevice(const std::vector<const char*>& deviceExtensions);
+		inline void initPipelineLayoutCache();
+		inline void initDescriptorBuffer();
+		inline void initBindlessRegistry();
 
 	};
 
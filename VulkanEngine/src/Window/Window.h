@@ -21,6 +21,7 @@ namespace vkEngine
 		inline GLFWwindow* getWindowGLFW() { return m_glfwWindow; }
 
 		inline bool shouldClose() const { return glfwWindowShouldClose(m_glfwWindow); };
+		inline void close() { glfwSetWindowShouldClose(m_glfwWindow, GLFW_TRUE); };
 		inline void setCursorPosition(float xPos, float yPos) { glfwSetCursorPos(m_glfwWindow, xPos, yPos); };
 		inline void setWindowTitle(const char* title);
 		VkSurfaceKHR getSurface() const { return m_Surface; }
@@ -2,15 +2,74 @@
 
 #include"Application.h"
 #include"Core.h"
+#include"Culling/CullingBenchmark.h"
+#include"Renderer/RenderQueueBenchmark.h"
 
 #include <exception>
 #include <iostream>
+#include <string>
+#include <cctype>
 
-int main()
+namespace
 {
+	const uint32_t DEFAULT_BENCHMARK_INSTANCES = 100000;
+	const uint32_t DEFAULT_CULL_BENCHMARK_OBJECTS = 1000000;
+	const uint32_t DEFAULT_OCCLUSION_BENCHMARK_OCCLUDERS = 10000;
+	const uint32_t DEFAULT_SORT_BENCHMARK_KEYS = 1000000;
+
+	// Optional count following a flag
+	uint32_t parseCount(int argc, char* argv[], int& i, uint32_t defaultCount)
+	{
+		if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])))
+			return static_cast<uint32_t>(std::stoul(argv[++i]));
+		return defaultCount;
+	}
+
+	// --benchmark [instanceCount], --cull-benchmark [objectCount], --occlusion-benchmark [occluderCount],
+	// --sort-benchmark [keyCount]
+	vkEngine::EngineOptions parseOptions(int argc, char* argv[])
+	{
+		vkEngine::EngineOptions options{};
+		for (int i = 1; i < argc; i++)
+		{
+			std::string argument = argv[i];
+			if (argument == "--benchmark")
+				options.benchmarkInstances = parseCount(argc, argv, i, DEFAULT_BENCHMARK_INSTANCES);
+			else if (argument == "--cull-benchmark")
+				options.cullBenchmarkObjects = parseCount(argc, argv, i, DEFAULT_CULL_BENCHMARK_OBJECTS);
+			else if (argument == "--occlusion-benchmark")
+				options.occlusionBenchmarkOccluders = parseCount(argc, argv, i, DEFAULT_OCCLUSION_BENCHMARK_OCCLUDERS);
+			else if (argument == "--sort-benchmark")
+				options.renderQueueBenchmarkKeys = parseCount(argc, argv, i, DEFAULT_SORT_BENCHMARK_KEYS);
+		}
+		return options;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	vkEngine::EngineOptions options = parseOptions(argc, argv);
+
+	// CPU only, runs without creating a window or a device
+	if (options.cullBenchmarkObjects > 0)
+	{
+		vkEngine::runCullingBenchmark(options.cullBenchmarkObjects);
+		return EXIT_SUCCESS;
+	}
+	if (options.occlusionBenchmarkOccluders > 0)
+	{
+		vkEngine::runOcclusionBenchmark(options.occlusionBenchmarkOccluders);
+		return EXIT_SUCCESS;
+	}
+	if (options.renderQueueBenchmarkKeys > 0)
+	{
+		vkEngine::runRenderQueueBenchmark(options.renderQueueBenchmarkKeys);
+		return EXIT_SUCCESS;
+	}
+
 	uint32_t width = 1000, height = 1000;
-	vkEngine::Application app(DEBUG_BUILD_CONFIGURATION, width, height, "VulkanEngine");
+	vkEngine::Application app(DEBUG_BUILD_CONFIGURATION, width, height, "VulkanEngine", options);
 	app.run();
 
 	return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -18,6 +18,7 @@ workspace "VulkanEngine"
     files{
         "VulkanEngine/shaders/src/**.vert",
         "VulkanEngine/shaders/src/**.frag",
+        "VulkanEngine/shaders/src/**.comp",
         "VulkanEngine/assets/**.*"
     }
     
@@ -42,7 +43,7 @@ workspace "VulkanEngine"
 rule "ShaderCompilation"
     location "VulkanEngine/shaders"
     display "Shader"
-    fileextension {".frag", ".vert"}
+    fileextension {".frag", ".vert", ".comp"}
     buildmessage 'Compiling %(Filename) with glslc'
     buildcommands { 'glslc.exe "%(FullPath)" -o "shaders/bin/%(Filename)%(Extension).spv"' }
     buildoutputs { "VulkanEngine/shaders/bin/%(Filename)%(Extension).spv" }